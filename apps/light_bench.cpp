@@ -0,0 +1,78 @@
+#include "color.h"
+#include "lights.h"
+#include "primitives.h"
+#include "scene.h"
+#include "world.h"
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+using raytrace::Color;
+using raytrace::pi;
+using raytrace::Point;
+using raytrace::PointLight;
+
+using std::chrono::duration_cast;
+using std::chrono::high_resolution_clock;
+using std::chrono::milliseconds;
+
+// Spread count lights over a ring above the scene, inside the walls,
+// splitting one white light's worth of intensity between them so images
+// stay comparable.
+auto ring_of_lights(int count, float range) -> std::vector<PointLight> {
+  auto lights = std::vector<PointLight>{};
+  auto intensity = Color{1.0f, 1.0f, 1.0f} * (1.0f / count);
+  for (int i = 0; i < count; ++i) {
+    auto angle = 2 * pi * i / count;
+    auto position =
+        Point{4.5f * std::cos(angle), 4.0f, 4.5f * std::sin(angle) - 2.0f};
+    lights.push_back(PointLight{position, intensity, range});
+  }
+  return lights;
+}
+
+// Usage: light_bench [width height [max_lights [range [light_samples]]]]
+// Renders the scene with 1, 2, 4, ... max_lights lights and reports how
+// long each render took.
+int main(int argc, char **argv) {
+  int x_size = 200;
+  int y_size = 100;
+  int max_lights = 128;
+  float range = std::numeric_limits<float>::infinity();
+  int light_samples = 0;
+
+  if (argc >= 3) {
+    x_size = std::stoi(std::string(argv[1]));
+    y_size = std::stoi(std::string(argv[2]));
+  }
+  if (argc >= 4) {
+    max_lights = std::stoi(std::string(argv[3]));
+  }
+  if (argc >= 5) {
+    range = std::stof(std::string(argv[4]));
+  }
+  if (argc >= 6) {
+    light_samples = std::stoi(std::string(argv[5]));
+  }
+
+  auto world = scene::define_scene();
+  world.light_samples(light_samples);
+  auto camera = scene::default_camera(x_size, y_size);
+
+  std::cout << "Image " << x_size << " x " << y_size << ", range " << range
+            << ", light samples " << light_samples << "\n";
+  for (int count = 1; count <= max_lights; count *= 2) {
+    world.lights(ring_of_lights(count, range));
+
+    auto begin = high_resolution_clock::now();
+    camera.render(world);
+    auto end = high_resolution_clock::now();
+
+    std::cout << count << " lights: "
+              << duration_cast<milliseconds>(end - begin).count() << "ms\n";
+  }
+}
@@ -0,0 +1,68 @@
+#include "canvas.h"
+#include "image_output.h"
+#include "partial_image.h"
+#include "ppm.h"
+#include "quantize.h"
+#include "thread_pool.h"
+
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using raytrace::PartialImage;
+using raytrace::Quantization;
+
+// Usage: merge_shards [--out file] [--exposure stops] [--srgb] [--dither]
+//                     shard_file...
+// Merges partial images written by raytracer --shard into one PPM on
+// stdout, or into file in the format its extension asks for. The shards
+// hold full precision pixels, so they're quantized here.
+int main(int argc, char **argv) {
+  auto out_file = std::string{};
+  auto quantization = Quantization{};
+  auto shard_files = std::vector<std::string>{};
+  for (int i = 1; i < argc; ++i) {
+    auto arg = std::string(argv[i]);
+    if (arg == "--out" && i + 1 < argc) {
+      out_file = argv[++i];
+    } else if (arg == "--exposure" && i + 1 < argc) {
+      quantization.exposure = std::stof(std::string(argv[++i]));
+    } else if (arg == "--srgb") {
+      quantization.srgb = true;
+    } else if (arg == "--dither") {
+      quantization.dither = true;
+    } else {
+      shard_files.push_back(arg);
+    }
+  }
+  if (shard_files.empty()) {
+    std::cerr << "Usage: merge_shards [--out file] [--exposure stops] "
+                 "[--srgb] [--dither] shard_file...\n";
+    return 1;
+  }
+
+  try {
+    auto parts = std::vector<PartialImage>{};
+    for (auto const &file : shard_files) {
+      auto is = std::ifstream{file, std::ios::binary};
+      if (!is) {
+        std::cerr << "Can't open " << file << "\n";
+        return 1;
+      }
+      parts.push_back(raytrace::read_partial(is));
+    }
+    auto image = raytrace::merge_partials(parts);
+    auto pool = raytrace::ThreadPool{};
+    if (out_file.empty()) {
+      std::cout << raytrace::encode_ppm(image, raytrace::PpmFormat::plain,
+                                        pool, quantization);
+    } else {
+      raytrace::write_image(out_file, image, pool, quantization);
+    }
+  } catch (std::exception const &e) {
+    std::cerr << e.what() << "\n";
+    return 1;
+  }
+}
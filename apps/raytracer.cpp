@@ -1,116 +1,526 @@
+#include "animation.h"
 #include "camera.h"
-#include "color.h"
-#include "materials.h"
-#include "matrix.h"
-#include "plane.h"
+#include "checkpoint.h"
+#include "image_output.h"
+#include "mapped_canvas.h"
+#include "partial_image.h"
 #include "primitives.h"
-#include "shape.h"
-#include "sphere.h"
-#include "transformations.h"
+#include "progressive.h"
+#include "quantize.h"
+#include "scene.h"
+#include "shared_framebuffer.h"
+#include "streaming.h"
+#include "thread_pool.h"
 #include "world.h"
+#include "y4m.h"
 
 #include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
 #include <iostream>
 #include <memory>
 #include <string>
+#include <vector>
 
-using raytrace::Camera;
-using raytrace::Color;
-using raytrace::identity_matrix;
-using raytrace::Material;
+using raytrace::CameraKey;
+using raytrace::CameraPath;
+using raytrace::Canvas;
 using raytrace::pi;
-using raytrace::Plane;
+using raytrace::Quantization;
 using raytrace::Point;
-using raytrace::Sphere;
+using raytrace::ThreadPool;
 using raytrace::Vector3;
-using raytrace::view_transform;
-using raytrace::World;
 
 using std::chrono::duration_cast;
 using std::chrono::high_resolution_clock;
 using std::chrono::milliseconds;
 
-World define_scene() {
-  auto world = World{};
-
-  auto floor = Plane{};
-  floor.material().specular(0.0f).color(Color{1.0f, 0.9f, 0.9f});
-  world.push_back(std::move(std::make_unique<Plane>(floor)));
-
-  auto left_wall = Plane{};
-  left_wall.transform(
-      identity_matrix().rotated_on_z(pi / 2).translated(-5.0f, 0.0f, 0.0f));
-  left_wall.material(floor.material());
-  world.push_back(std::move(std::make_unique<Plane>(left_wall)));
-
-  auto right_wall = Plane{};
-  right_wall.transform(
-      identity_matrix().rotated_on_x(pi / 2).translated(0.0f, 0.0f, 10.0f));
-  right_wall.material(floor.material());
-  world.push_back(std::move(std::make_unique<Plane>(right_wall)));
-
-  auto middle = Sphere{};
-  middle.transform(identity_matrix().translated(-0.5f, 1.0f, 0.5f));
-  middle.material().color(Color{0.1f, 1.0f, 0.5f}).diffuse(0.7f).specular(0.3f);
-  world.push_back(std::move(std::make_unique<Sphere>(middle)));
-
-  auto right = Sphere{};
-  right.transform(
-      identity_matrix().scaled(0.5f, 0.5f, 0.5f).translated(1.5f, 0.5f, -0.5f));
-  right.material().color(Color{0.5f, 1.0f, 0.1f}).diffuse(0.7f).specular(0.3f);
-  world.push_back(std::move(std::make_unique<Sphere>(right)));
-
-  auto left = Sphere{};
-  left.transform(identity_matrix()
-                     .scaled(0.33f, 0.33f, 0.33f)
-                     .translated(-1.5f, 0.33f, -0.75f));
-  left.material().color(Color{1.0f, 0.8f, 0.1f}).diffuse(0.7f).specular(0.3f);
-  world.push_back(std::move(std::make_unique<Sphere>(left)));
-
-  world.light().position = Point{-1.0f, 2.0f, -3.0f};
-  return world;
+// Swing the camera through a quarter turn around the scene
+CameraPath default_path() {
+  auto path = CameraPath{};
+  for (int i = 0; i <= 4; ++i) {
+    auto angle = (i - 2) * pi / 16;
+    auto from = Point{5.0f * std::sin(angle), 1.5f, -5.0f * std::cos(angle)};
+    path.add(CameraKey{static_cast<float>(i), from, Point{0.0f, 1.0f, 0.0f},
+                       Vector3{0.0f, 1.0f, 0.0f}, pi / 3});
+  }
+  return path;
+}
+
+// Write image to out_file, in the format its extension asks for, or as PPM
+// to stdout if there's no file
+void write_output(Canvas const &image, std::string const &out_file,
+                  ThreadPool &pool, Quantization const &quantization) {
+  if (out_file.empty()) {
+    std::cout << raytrace::encode_ppm(image, raytrace::PpmFormat::plain, pool,
+                                      quantization);
+    return;
+  }
+  raytrace::write_image(out_file, image, pool, quantization);
+}
+
+// Render frames along the camera path, either to numbered files
+// out_prefix0000.ppm, out_prefix0001.ppm, ... or, with no prefix, one after
+// another to stdout. A prefix like frame.png gives frame0000.png, ...
+// With y4m, or an out_prefix ending in .y4m, the frames go to stdout or
+// that file as one YUV4MPEG2 video stream instead.
+int render_animation(int x_size, int y_size, int frames,
+                     std::string const &path_file,
+                     std::string const &out_prefix, bool reproject, bool y4m,
+                     Quantization const &quantization) {
+  auto path = default_path();
+  if (!path_file.empty()) {
+    auto is = std::ifstream{path_file};
+    if (!is) {
+      std::cerr << "Can't open camera path " << path_file << "\n";
+      return 1;
+    }
+    path = raytrace::read_camera_path(is);
+    if (path.empty()) {
+      std::cerr << "Camera path " << path_file << " has no keys\n";
+      return 1;
+    }
+  }
+
+  auto world = scene::define_scene();
+  auto pool = ThreadPool{};
+
+  auto begin = high_resolution_clock::now();
+
+  auto stem = out_prefix;
+  auto extension = std::string{".ppm"};
+  auto dot = out_prefix.find_last_of("./");
+  if (dot != std::string::npos && out_prefix[dot] == '.') {
+    stem = out_prefix.substr(0, dot);
+    extension = out_prefix.substr(dot);
+  }
+
+  auto video_file = std::ofstream{};
+  auto video = std::unique_ptr<raytrace::Y4mWriter>{};
+  if (y4m || extension == ".y4m") {
+    auto options = raytrace::Y4mOptions{};
+    options.quantization = quantization;
+    auto *os = &std::cout;
+    if (!out_prefix.empty()) {
+      video_file.open(out_prefix, std::ios::binary);
+      os = &video_file;
+    }
+    video =
+        std::make_unique<raytrace::Y4mWriter>(*os, x_size, y_size, options);
+  }
+
+  auto write_frame = [&](int frame, Canvas &image) {
+    if (video) {
+      video->write_frame(image);
+      return;
+    }
+    if (out_prefix.empty()) {
+      write_output(image, out_prefix, pool, quantization);
+      return;
+    }
+    char number[16];
+    std::snprintf(number, sizeof number, "%04d", frame);
+    write_output(image, stem + number + extension, pool, quantization);
+  };
+
+  if (reproject) {
+    raytrace::render_sequence_reprojected(
+        world, path, frames, x_size, y_size, pool, 1.0f,
+        [&write_frame](int frame, Canvas &image,
+                       raytrace::ReprojectionStats stats) {
+          std::cerr << "Frame " << frame << ": reused the shading of "
+                    << static_cast<int>(stats.shading_reuse_rate() * 100)
+                    << "% of pixels, traced " << stats.primary_rays
+                    << " primary rays\n";
+          write_frame(frame, image);
+        });
+  } else {
+    raytrace::render_sequence(world, path, frames, x_size, y_size, pool,
+                              write_frame);
+  }
+
+  auto end = high_resolution_clock::now();
+
+  std::cerr << "\n" << frames << " frames " << x_size << " x " << y_size
+            << " on " << pool.size() << " threads took "
+            << duration_cast<milliseconds>(end - begin).count() << "ms.\n";
+  return 0;
+}
+
+// Render shard of shards, a band of rows, as a partial image to out_file,
+// or to stdout if there's no file. merge_shards puts them back together.
+int render_shard(int x_size, int y_size, int shard, int shards,
+                 std::string const &out_file) {
+  auto crop = raytrace::Tile{};
+  try {
+    crop = raytrace::shard_crop(x_size, y_size, shard, shards);
+  } catch (std::out_of_range const &e) {
+    std::cerr << "--shard " << shard << "/" << shards << ": " << e.what()
+              << "\n";
+    return 1;
+  }
+
+  auto world = scene::define_scene();
+  auto camera = scene::default_camera(x_size, y_size);
+
+  auto begin = high_resolution_clock::now();
+  auto part = raytrace::PartialImage{x_size, y_size, crop,
+                                     camera.render(world, crop)};
+  auto end = high_resolution_clock::now();
+
+  if (out_file.empty()) {
+    raytrace::write_partial(std::cout, part);
+  } else {
+    auto os = std::ofstream{out_file, std::ios::binary};
+    raytrace::write_partial(os, part);
+  }
+
+  std::cerr << "\nShard " << shard << " of " << shards << " (rows " << crop.y
+            << " to " << crop.y + crop.height - 1 << ") took "
+            << duration_cast<milliseconds>(end - begin).count() << "ms.\n";
+  return 0;
+}
+
+// Render as much as fits in deadline_ms, coarse to fine, and write the
+// best image so far to out_file or stdout
+int render_preview(int x_size, int y_size, int deadline_ms,
+                   std::string const &out_file,
+                   Quantization const &quantization) {
+  auto world = scene::define_scene();
+  auto camera = scene::default_camera(x_size, y_size);
+  auto pool = ThreadPool{};
+
+  auto begin = std::chrono::steady_clock::now();
+  auto result = raytrace::render_progressive(
+      camera, world, pool, begin + milliseconds{deadline_ms});
+  auto end = std::chrono::steady_clock::now();
+
+  write_output(result.image, out_file, pool, quantization);
+
+  std::cerr << "\nPreview traced " << result.traced << " of "
+            << x_size * y_size << " pixels (1 in "
+            << result.spacing * result.spacing << " grid complete) in "
+            << duration_cast<milliseconds>(end - begin).count() << "ms.\n";
+  return 0;
+}
+
+// Render to out_file or stdout, saving finished tiles to checkpoint_file as
+// it goes so that running it again after an interruption picks up where it
+// stopped
+int render_resumable(int x_size, int y_size,
+                     std::string const &checkpoint_file,
+                     std::string const &out_file,
+                     Quantization const &quantization) {
+  auto world = scene::define_scene();
+  auto camera = scene::default_camera(x_size, y_size);
+  auto pool = ThreadPool{};
+  auto options = raytrace::CheckpointOptions{};
+  options.path = checkpoint_file;
+
+  try {
+    auto begin = high_resolution_clock::now();
+    auto result = raytrace::render_checkpointed(camera, world, pool, options);
+    auto end = high_resolution_clock::now();
+
+    write_output(result.image, out_file, pool, quantization);
+
+    std::cerr << "\nResumed " << result.tiles_resumed << " tiles from "
+              << checkpoint_file << ", rendered " << result.tiles_rendered
+              << " in " << duration_cast<milliseconds>(end - begin).count()
+              << "ms.\n";
+  } catch (std::runtime_error const &e) {
+    std::cerr << e.what() << "\n";
+    return 1;
+  }
+  return 0;
+}
+
+// Render band_height rows at a time, writing each band to stdout as soon
+// as it's done, so the whole image is never held in memory
+int render_streaming(int x_size, int y_size, int band_height,
+                     Quantization const &quantization) {
+  auto world = scene::define_scene();
+  auto camera = scene::default_camera(x_size, y_size);
+  auto pool = ThreadPool{};
+  auto options = raytrace::StreamOptions{};
+  options.band_height = band_height;
+  options.quantization = quantization;
+
+  auto begin = high_resolution_clock::now();
+  raytrace::render_to_stream(camera, world, pool, std::cout, options);
+  auto end = high_resolution_clock::now();
+
+  std::cerr << "\nStreamed " << x_size << " x " << y_size << " in bands of "
+            << band_height << " rows in "
+            << duration_cast<milliseconds>(end - begin).count() << "ms.\n";
+  return 0;
+}
+
+// Render straight into out_file, mapped into memory: binary PPM, or a float
+// map if the name ends in .pfm. A PPM is quantized as asked; a float map,
+// like a .pfm written any other way, keeps the values as they are.
+int render_mapped(int x_size, int y_size, std::string const &out_file,
+                  Quantization const &quantization) {
+  auto world = scene::define_scene();
+  auto camera = scene::default_camera(x_size, y_size);
+  auto pool = ThreadPool{};
+
+  auto pfm =
+      raytrace::image_format_for(out_file) == raytrace::ImageFormat::pfm;
+  auto plain = pfm || (quantization.exposure == 0.0f && !quantization.srgb &&
+                       !quantization.dither);
+  auto begin = high_resolution_clock::now();
+  auto image = raytrace::map_image_file(
+      out_file, pfm ? raytrace::ImageFile::pfm : raytrace::ImageFile::ppm,
+      x_size, y_size);
+
+  world.commit();
+  raytrace::for_each_band(pool, y_size, [&](int y0, int y1) {
+    auto band = raytrace::Tile{0, y0, x_size, y1 - y0};
+    if (plain) {
+      camera.render_tile(world, image, band);
+      return;
+    }
+    // Otherwise each band is rendered in full precision and quantized into
+    // the file. It starts on a multiple of 4 rows, so the dither pattern
+    // lines up with the other bands'.
+    auto top = y0 - y0 % 4;
+    auto rows = Canvas{x_size, y1 - top};
+    camera.render_tile(world, rows, band, 0, top);
+    auto values = std::vector<unsigned char>{};
+    for (int y = y0; y < y1; ++y) {
+      raytrace::quantize_row(rows, y - top, values, quantization);
+      std::memcpy(image.row(y), values.data(), values.size());
+    }
+  });
+  auto end = high_resolution_clock::now();
+
+  std::cerr << "\nRendered " << x_size << " x " << y_size << " into "
+            << out_file << " in "
+            << duration_cast<milliseconds>(end - begin).count() << "ms.\n";
+  return 0;
+}
+
+// Render into the shared memory segment shm_name, where other processes can
+// watch the tiles arrive, then write the image to out_file or stdout
+int render_to_shared(int x_size, int y_size, std::string const &shm_name,
+                     std::string const &out_file,
+                     Quantization const &quantization) {
+  auto world = scene::define_scene();
+  auto camera = scene::default_camera(x_size, y_size);
+  auto pool = ThreadPool{};
+
+  // Full precision, so the image written afterwards loses nothing
+  auto framebuffer = raytrace::SharedFramebuffer::create(
+      shm_name, x_size, y_size, raytrace::PixelFormat::rgb_float);
+  auto begin = high_resolution_clock::now();
+  raytrace::render_shared(camera, world, pool, framebuffer);
+  auto end = high_resolution_clock::now();
+
+  write_output(framebuffer.canvas(), out_file, pool, quantization);
+
+  std::cerr << "\nRendered " << x_size << " x " << y_size << " into "
+            << shm_name << " in "
+            << duration_cast<milliseconds>(end - begin).count() << "ms.\n";
+  return 0;
+}
+
+// Render the whole image on pool and save it to out_file, in the format its
+// extension asks for: .png, .qoi, .pfm or PPM
+int render_to_file(int x_size, int y_size, std::string const &out_file,
+                   Quantization const &quantization) {
+  auto world = scene::define_scene();
+  auto camera = scene::default_camera(x_size, y_size);
+  auto pool = ThreadPool{};
+
+  auto begin = high_resolution_clock::now();
+  auto image = Canvas{x_size, y_size};
+  world.commit();
+  raytrace::for_each_band(pool, y_size, [&](int y0, int y1) {
+    camera.render_tile(world, image, raytrace::Tile{0, y0, x_size, y1 - y0});
+  });
+  auto rendered = high_resolution_clock::now();
+  raytrace::write_image(out_file, image, pool, quantization);
+  auto end = high_resolution_clock::now();
+
+  std::cerr << "\nImage " << x_size << " x " << y_size << " on "
+            << pool.size() << " threads\n";
+  std::cerr << "\nRendering took "
+            << duration_cast<milliseconds>(rendered - begin).count() << "ms.";
+  std::cerr << "\nWriting " << out_file << " took "
+            << duration_cast<milliseconds>(end - rendered).count()
+            << "ms.\n";
+  return 0;
 }
 
+// Usage: raytracer [width height] [--out file.png|.qoi|.pfm|.ppm]
+//                  [--frames N [--path file] [--out prefix] [--reproject]
+//                   [--y4m]]
+//                  [--shard K/N [--out file]]
+//                  [--preview ms [--out file]]
+//                  [--checkpoint file [--out file]]
+//                  [--stream band_rows]
+//                  [--map file.ppm|file.pfm]
+//                  [--shm /name [--out file]]
+//                  [--exposure stops] [--srgb] [--dither]
+// Only one of --frames, --shard, --preview, --checkpoint, --stream, --map
+// and --shm can be given. Shards are quantized by merge_shards, so --shard
+// takes none of --exposure, --srgb and --dither.
 int main(int argc, char **argv) {
   int x_size = 200;
   int y_size = 100;
+  int frames = 0;
+  auto path_file = std::string{};
+  auto out_prefix = std::string{};
+  auto reproject = false;
+  auto y4m = false;
+  int shard = -1;
+  int shards = 0;
+  bool sharding = false;
+  int preview_ms = -1;
+  auto checkpoint_file = std::string{};
+  int band_rows = 0;
+  auto mapped_file = std::string{};
+  auto shm_name = std::string{};
+  auto quantization = Quantization{};
 
-  if (argc > 1) {
-    if (argc == 3) {
-      x_size = std::stoi(std::string(argv[1]));
-      y_size = std::stoi(std::string(argv[2]));
+  auto positional = std::vector<std::string>{};
+  for (int i = 1; i < argc; ++i) {
+    auto arg = std::string(argv[i]);
+    if (arg == "--frames" && i + 1 < argc) {
+      frames = std::stoi(std::string(argv[++i]));
+    } else if (arg == "--path" && i + 1 < argc) {
+      path_file = argv[++i];
+    } else if (arg == "--out" && i + 1 < argc) {
+      out_prefix = argv[++i];
+    } else if (arg == "--preview" && i + 1 < argc) {
+      preview_ms = std::stoi(std::string(argv[++i]));
+    } else if (arg == "--checkpoint" && i + 1 < argc) {
+      checkpoint_file = argv[++i];
+    } else if (arg == "--stream" && i + 1 < argc) {
+      band_rows = std::stoi(std::string(argv[++i]));
+    } else if (arg == "--map" && i + 1 < argc) {
+      mapped_file = argv[++i];
+    } else if (arg == "--shm" && i + 1 < argc) {
+      shm_name = argv[++i];
+    } else if (arg == "--exposure" && i + 1 < argc) {
+      quantization.exposure = std::stof(std::string(argv[++i]));
+    } else if (arg == "--srgb") {
+      quantization.srgb = true;
+    } else if (arg == "--dither") {
+      quantization.dither = true;
+    } else if (arg == "--y4m") {
+      y4m = true;
+    } else if (arg == "--reproject") {
+      reproject = true;
+    } else if (arg == "--shard" && i + 1 < argc) {
+      auto spec = std::string(argv[++i]);
+      auto slash = spec.find('/');
+      if (slash == std::string::npos) {
+        std::cerr << "--shard expects K/N\n";
+        return 1;
+      }
+      shard = std::stoi(spec.substr(0, slash));
+      shards = std::stoi(spec.substr(slash + 1));
+      sharding = true;
+    } else {
+      positional.push_back(arg);
     }
   }
-  auto world = define_scene();
-  auto camera = Camera{x_size, y_size, pi / 3};
-  camera.transform(view_transform(Point{0.0f, 1.5f, -5.0f},
-                                  Point{0.0f, 1.0f, 0.0f},
-                                  Vector3{0.0f, 1.0f, 0.0f}));
+  if (positional.size() == 2) {
+    x_size = std::stoi(positional[0]);
+    y_size = std::stoi(positional[1]);
+  }
 
-  auto begin = high_resolution_clock::now();
+  auto modes = std::vector<std::string>{};
+  if (preview_ms >= 0) {
+    modes.push_back("--preview");
+  }
+  if (!mapped_file.empty()) {
+    modes.push_back("--map");
+  }
+  if (!shm_name.empty()) {
+    modes.push_back("--shm");
+  }
+  if (band_rows > 0) {
+    modes.push_back("--stream");
+  }
+  if (!checkpoint_file.empty()) {
+    modes.push_back("--checkpoint");
+  }
+  if (sharding) {
+    modes.push_back("--shard");
+  }
+  if (frames > 0) {
+    modes.push_back("--frames");
+  }
+  if (modes.size() > 1) {
+    std::cerr << modes[0] << " and " << modes[1]
+              << " can't be used together\n";
+    return 1;
+  }
 
-  auto canvas = camera.render(world);
+  if (preview_ms >= 0) {
+    return render_preview(x_size, y_size, preview_ms, out_prefix,
+                          quantization);
+  }
 
-  auto end_rendering = high_resolution_clock::now();
+  if (!mapped_file.empty()) {
+    return render_mapped(x_size, y_size, mapped_file, quantization);
+  }
 
-  auto ppm = canvas.to_ppm();
+  if (!shm_name.empty()) {
+    return render_to_shared(x_size, y_size, shm_name, out_prefix,
+                            quantization);
+  }
 
-  auto end_create_ppm = high_resolution_clock::now();
+  if (band_rows > 0) {
+    return render_streaming(x_size, y_size, band_rows, quantization);
+  }
 
-  std::cout << ppm;
+  if (!checkpoint_file.empty()) {
+    return render_resumable(x_size, y_size, checkpoint_file, out_prefix,
+                            quantization);
+  }
+
+  if (sharding) {
+    if (quantization.exposure != 0.0f || quantization.srgb ||
+        quantization.dither) {
+      std::cerr << "--shard writes full precision pixels; pass --exposure, "
+                   "--srgb and --dither to merge_shards instead\n";
+      return 1;
+    }
+    return render_shard(x_size, y_size, shard, shards, out_prefix);
+  }
 
-  auto end_write_ppm = high_resolution_clock::now();
+  if (frames > 0) {
+    return render_animation(x_size, y_size, frames, path_file, out_prefix,
+                            reproject, y4m, quantization);
+  }
 
-  std::cerr << "\nImage " << x_size << " x " << y_size << "\n";
-  std::cerr << "\nRendering took "
-            << duration_cast<milliseconds>(end_rendering - begin).count()
+  if (!out_prefix.empty()) {
+    return render_to_file(x_size, y_size, out_prefix, quantization);
+  }
+
+  auto world = scene::define_scene();
+  auto camera = scene::default_camera(x_size, y_size);
+
+  // Encoding and writing overlap with rendering, so the image is out soon
+  // after the last row is traced
+  auto pool = ThreadPool{};
+  auto options = raytrace::StreamOptions{};
+  options.quantization = quantization;
+  auto timing =
+      raytrace::render_pipelined(camera, world, pool, std::cout, options);
+
+  std::cerr << "\nImage " << x_size << " x " << y_size << " on "
+            << pool.size() << " threads\n";
+  std::cerr << "\nRendering took " << static_cast<long>(timing.rendered)
             << "ms.";
-  std::cerr
-      << "\nPPM generation took "
-      << duration_cast<milliseconds>(end_create_ppm - end_rendering).count()
-      << "ms.";
-  std::cerr
-      << "\nWriting PPM to stdout took "
-      << duration_cast<milliseconds>(end_write_ppm - end_create_ppm).count()
-      << "ms.\n";
-}
\ No newline at end of file
+  std::cerr << "\nPPM generation finished at "
+            << static_cast<long>(timing.encoded) << "ms.";
+  std::cerr << "\nWriting PPM to stdout finished at "
+            << static_cast<long>(timing.written) << "ms.\n";
+}
@@ -0,0 +1,199 @@
+#include "render_server.h"
+#include "scene.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#define RAYTRACE_HAVE_UNIX_SOCKETS 1
+#endif
+
+using raytrace::RenderServer;
+using raytrace::ThreadPool;
+
+#ifdef RAYTRACE_HAVE_UNIX_SOCKETS
+// Just enough of a stream buffer to run a session over a socket
+class SocketBuffer : public std::streambuf {
+public:
+  explicit SocketBuffer(int fd) : fd_(fd) {
+    setg(in_.data(), in_.data(), in_.data());
+    setp(out_.data(), out_.data() + out_.size());
+  }
+  ~SocketBuffer() override { sync(); }
+
+protected:
+  auto underflow() -> int_type override {
+    auto n = ::read(fd_, in_.data(), in_.size());
+    while (n < 0 && errno == EINTR) {
+      n = ::read(fd_, in_.data(), in_.size());
+    }
+    if (n <= 0) {
+      return traits_type::eof();
+    }
+    setg(in_.data(), in_.data(), in_.data() + n);
+    return traits_type::to_int_type(*gptr());
+  }
+
+  auto overflow(int_type c) -> int_type override {
+    if (sync() != 0) {
+      return traits_type::eof();
+    }
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+      *pptr() = traits_type::to_char_type(c);
+      pbump(1);
+    }
+    return traits_type::not_eof(c);
+  }
+
+  auto sync() -> int override {
+    auto *p = pbase();
+    while (p < pptr()) {
+      auto n = ::send(fd_, p, static_cast<std::size_t>(pptr() - p),
+                      send_flags);
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      if (n <= 0) {
+        // The client has gone; drop what's left so the session ends
+        setp(out_.data(), out_.data() + out_.size());
+        return -1;
+      }
+      p += n;
+    }
+    setp(out_.data(), out_.data() + out_.size());
+    return 0;
+  }
+
+private:
+#ifdef MSG_NOSIGNAL
+  static constexpr int send_flags = MSG_NOSIGNAL;
+#else
+  // SIGPIPE is ignored in main() instead
+  static constexpr int send_flags = 0;
+#endif
+
+  int fd_;
+  std::vector<char> in_ = std::vector<char>(4096);
+  std::vector<char> out_ = std::vector<char>(1 << 16);
+};
+
+// Serve connections accepted from listener one after another until it
+// fails
+void accept_sessions(RenderServer &server, int listener) {
+  for (;;) {
+    auto connection = ::accept(listener, nullptr, nullptr);
+    if (connection < 0) {
+      if (errno == EINTR || errno == ECONNABORTED) {
+        continue;
+      }
+      return;
+    }
+    {
+      auto buffer = SocketBuffer{connection};
+      auto stream = std::iostream{&buffer};
+      server.serve(stream, stream);
+    }
+    ::close(connection);
+  }
+}
+
+// Accept connections on a Unix domain socket at path, serving up to
+// max_sessions at once, each on one of a fixed set of threads; further
+// connections wait in the listen queue. Runs until the listening socket
+// fails.
+int serve_socket(RenderServer &server, std::string const &path,
+                 unsigned max_sessions) {
+  auto listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listener < 0) {
+    std::cerr << "Can't create socket: " << std::strerror(errno) << "\n";
+    return 1;
+  }
+  auto address = sockaddr_un{};
+  address.sun_family = AF_UNIX;
+  if (path.size() >= sizeof address.sun_path) {
+    std::cerr << "Socket path " << path << " is too long\n";
+    return 1;
+  }
+  std::strcpy(address.sun_path, path.c_str());
+  ::unlink(path.c_str());
+  if (::bind(listener, reinterpret_cast<sockaddr *>(&address),
+             sizeof address) != 0 ||
+      ::listen(listener, 16) != 0) {
+    std::cerr << "Can't listen on " << path << ": " << std::strerror(errno)
+              << "\n";
+    ::close(listener);
+    return 1;
+  }
+  std::cerr << "Listening on " << path << "\n";
+
+  auto sessions = std::vector<std::thread>{};
+  for (unsigned i = 0; i < std::max(1u, max_sessions); ++i) {
+    sessions.emplace_back(accept_sessions, std::ref(server), listener);
+  }
+  for (auto &s : sessions) {
+    s.join();
+  }
+  ::close(listener);
+  return 1;
+}
+#endif
+
+// Usage: render_server [--socket path [--max-sessions N]]
+//                      [--max-concurrent N] [--threads N]
+//
+// Keeps the scene loaded and renders requests, see RenderServer::serve(),
+// from stdin to stdout, or from up to max-sessions connections at a time
+// to a Unix domain socket.
+int main(int argc, char **argv) {
+  auto socket_path = std::string{};
+  unsigned max_concurrent = 1;
+  unsigned max_sessions = 16;
+  unsigned threads = 0;
+
+  for (int i = 1; i < argc; ++i) {
+    auto arg = std::string(argv[i]);
+    if (arg == "--socket" && i + 1 < argc) {
+      socket_path = argv[++i];
+    } else if (arg == "--max-concurrent" && i + 1 < argc) {
+      max_concurrent = static_cast<unsigned>(std::stoi(argv[++i]));
+    } else if (arg == "--max-sessions" && i + 1 < argc) {
+      max_sessions = static_cast<unsigned>(std::stoi(argv[++i]));
+    } else if (arg == "--threads" && i + 1 < argc) {
+      threads = static_cast<unsigned>(std::stoi(argv[++i]));
+    } else {
+      std::cerr << "Unknown argument " << arg << "\n";
+      return 1;
+    }
+  }
+
+  auto pool = ThreadPool{threads};
+  auto server = RenderServer{scene::define_scene(), pool, max_concurrent};
+
+  if (socket_path.empty()) {
+    std::ios::sync_with_stdio(false);
+    server.serve(std::cin, std::cout);
+    return 0;
+  }
+
+#ifdef RAYTRACE_HAVE_UNIX_SOCKETS
+  // A client hanging up mid-reply should end its session, not the server
+  std::signal(SIGPIPE, SIG_IGN);
+  return serve_socket(server, socket_path, max_sessions);
+#else
+  std::cerr << "Unix domain sockets aren't supported on this platform\n";
+  return 1;
+#endif
+}
@@ -0,0 +1,81 @@
+#ifndef RAYTRACE_APPS_SCENE_H_GUARD
+#define RAYTRACE_APPS_SCENE_H_GUARD
+
+#include "camera.h"
+#include "color.h"
+#include "matrix.h"
+#include "plane.h"
+#include "primitives.h"
+#include "sphere.h"
+#include "transformations.h"
+#include "world.h"
+
+#include <memory>
+
+// The scene the raytracer app, the render server and the light benchmark
+// draw: three spheres in the corner of a room
+namespace scene {
+
+using raytrace::Camera;
+using raytrace::Color;
+using raytrace::identity_matrix;
+using raytrace::pi;
+using raytrace::Plane;
+using raytrace::Point;
+using raytrace::Sphere;
+using raytrace::Vector3;
+using raytrace::view_transform;
+using raytrace::World;
+
+inline World define_scene() {
+  auto world = World{};
+
+  auto floor = Plane{};
+  floor.material().specular(0.0f).color(Color{1.0f, 0.9f, 0.9f});
+  world.push_back(std::move(std::make_unique<Plane>(floor)));
+
+  auto left_wall = Plane{};
+  left_wall.transform(
+      identity_matrix().rotated_on_z(pi / 2).translated(-5.0f, 0.0f, 0.0f));
+  left_wall.material(floor.material());
+  world.push_back(std::move(std::make_unique<Plane>(left_wall)));
+
+  auto right_wall = Plane{};
+  right_wall.transform(
+      identity_matrix().rotated_on_x(pi / 2).translated(0.0f, 0.0f, 10.0f));
+  right_wall.material(floor.material());
+  world.push_back(std::move(std::make_unique<Plane>(right_wall)));
+
+  auto middle = Sphere{};
+  middle.transform(identity_matrix().translated(-0.5f, 1.0f, 0.5f));
+  middle.material().color(Color{0.1f, 1.0f, 0.5f}).diffuse(0.7f).specular(0.3f);
+  world.push_back(std::move(std::make_unique<Sphere>(middle)));
+
+  auto right = Sphere{};
+  right.transform(
+      identity_matrix().scaled(0.5f, 0.5f, 0.5f).translated(1.5f, 0.5f, -0.5f));
+  right.material().color(Color{0.5f, 1.0f, 0.1f}).diffuse(0.7f).specular(0.3f);
+  world.push_back(std::move(std::make_unique<Sphere>(right)));
+
+  auto left = Sphere{};
+  left.transform(identity_matrix()
+                     .scaled(0.33f, 0.33f, 0.33f)
+                     .translated(-1.5f, 0.33f, -0.75f));
+  left.material().color(Color{1.0f, 0.8f, 0.1f}).diffuse(0.7f).specular(0.3f);
+  world.push_back(std::move(std::make_unique<Sphere>(left)));
+
+  world.light().position = Point{-1.0f, 2.0f, -3.0f};
+  return world;
+}
+
+// A width by height view of the scene from just above the floor
+inline Camera default_camera(int width, int height) {
+  auto camera = Camera{width, height, pi / 3};
+  camera.transform(view_transform(Point{0.0f, 1.5f, -5.0f},
+                                  Point{0.0f, 1.0f, 0.0f},
+                                  Vector3{0.0f, 1.0f, 0.0f}));
+  return camera;
+}
+
+} // namespace scene
+#endif
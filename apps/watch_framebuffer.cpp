@@ -0,0 +1,95 @@
+#include "canvas.h"
+#include "image_output.h"
+#include "shared_framebuffer.h"
+#include "thread_pool.h"
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using raytrace::Canvas;
+using raytrace::SharedFramebuffer;
+
+using std::chrono::milliseconds;
+
+namespace {
+// Keep trying to open name until the renderer has created it
+auto wait_for(std::string const &name, int timeout_ms) -> SharedFramebuffer {
+  auto deadline = std::chrono::steady_clock::now() + milliseconds{timeout_ms};
+  while (true) {
+    try {
+      return SharedFramebuffer::open(name);
+    } catch (std::runtime_error const &) {
+      if (std::chrono::steady_clock::now() >= deadline) {
+        throw;
+      }
+      std::this_thread::sleep_for(milliseconds{10});
+    }
+  }
+}
+} // namespace
+
+// Usage: watch_framebuffer [--out file] [--wait ms] /name
+// Follows a render published by raytracer --shm /name, copying each tile
+// as it's finished and reporting progress, until every tile is in. Then
+// writes the image as PPM to stdout, or to file in the format its
+// extension asks for.
+int main(int argc, char **argv) {
+  auto out_file = std::string{};
+  auto name = std::string{};
+  int wait_ms = 5000;
+  for (int i = 1; i < argc; ++i) {
+    auto arg = std::string(argv[i]);
+    if (arg == "--out" && i + 1 < argc) {
+      out_file = argv[++i];
+    } else if (arg == "--wait" && i + 1 < argc) {
+      wait_ms = std::stoi(std::string(argv[++i]));
+    } else {
+      name = arg;
+    }
+  }
+  if (name.empty()) {
+    std::cerr << "Usage: watch_framebuffer [--out file] [--wait ms] /name\n";
+    return 1;
+  }
+
+  try {
+    auto framebuffer = wait_for(name, wait_ms);
+    auto const &header = framebuffer.header();
+    auto image = Canvas{static_cast<int>(header.width),
+                        static_cast<int>(header.height)};
+
+    // The generation each tile had when it was last copied whole
+    auto seen = std::vector<std::uint32_t>(framebuffer.tile_count(), 0);
+    auto finished = std::size_t{0};
+    while (finished < seen.size()) {
+      for (std::size_t i = 0; i < seen.size(); ++i) {
+        auto generation = framebuffer.generation(i);
+        if (generation == seen[i] || generation % 2 != 0) {
+          continue;
+        }
+        if (framebuffer.read_tile(i, image)) {
+          finished += seen[i] == 0 ? 1 : 0;
+          seen[i] = generation;
+        }
+      }
+      std::cerr << "\r" << finished << " of " << seen.size() << " tiles";
+      std::this_thread::sleep_for(milliseconds{20});
+    }
+    std::cerr << "\n";
+
+    if (out_file.empty()) {
+      std::cout << image.to_ppm();
+    } else {
+      auto pool = raytrace::ThreadPool{};
+      raytrace::write_image(out_file, image, pool);
+    }
+  } catch (std::exception const &e) {
+    std::cerr << e.what() << "\n";
+    return 1;
+  }
+}
@@ -0,0 +1,72 @@
+#ifndef RAYTRACE_ANIMATION_H_GUARD
+#define RAYTRACE_ANIMATION_H_GUARD
+
+#include "camera.h"
+#include "canvas.h"
+#include "primitives.h"
+#include "reprojection.h"
+#include "thread_pool.h"
+#include "world.h"
+
+#include <functional>
+#include <istream>
+#include <vector>
+
+namespace raytrace {
+
+// Where the camera is at a moment in time, as view_transform() parameters
+// plus a field of view
+struct CameraKey {
+  float time;
+  Point from;
+  Point to;
+  Vector3 up;
+  float fov;
+};
+
+// A camera moving between keyframes, interpolated linearly
+class CameraPath {
+public:
+  // Keys can be added in any order
+  auto add(CameraKey key) -> CameraPath &;
+
+  auto empty() const -> bool { return keys_.empty(); }
+  auto size() const -> std::size_t { return keys_.size(); }
+  // Both throw std::out_of_range if the path has no keys
+  auto start_time() const -> float;
+  auto end_time() const -> float;
+
+  // The camera at time, held at the first or last key outside of them
+  auto at(float time) const -> CameraKey;
+
+  // A camera for frame of frames spread evenly from start to end time
+  auto camera(int frame, int frames, int h_size, int v_size) const -> Camera;
+
+private:
+  std::vector<CameraKey> keys_;
+};
+
+// Read a camera path, one key per line:
+//   time from.x from.y from.z to.x to.y to.z up.x up.y up.z fov
+// with fov in radians. Blank lines and lines starting with # are skipped.
+auto read_camera_path(std::istream &is) -> CameraPath;
+
+// Render frames spread evenly along path, in parallel on pool. The world is
+// committed once and shared by every frame. on_frame is called on the
+// calling thread with each finished frame, in frame order.
+void render_sequence(World &world, CameraPath const &path, int frames,
+                     int h_size, int v_size, ThreadPool &pool,
+                     std::function<void(int frame, Canvas &image)> on_frame);
+
+// Render frames along path one after another, each reusing what shading it
+// can from the frame before with render_reprojected(). Each frame's rows
+// are split across pool. on_frame also gets how much shading was reused
+// and how many rays were traced.
+void render_sequence_reprojected(
+    World &world, CameraPath const &path, int frames, int h_size, int v_size,
+    ThreadPool &pool, float tolerance,
+    std::function<void(int frame, Canvas &image, ReprojectionStats stats)>
+        on_frame);
+
+} // namespace raytrace
+#endif
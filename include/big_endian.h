@@ -0,0 +1,18 @@
+#ifndef RAYTRACE_BIG_ENDIAN_H_GUARD
+#define RAYTRACE_BIG_ENDIAN_H_GUARD
+
+#include <cstdint>
+#include <string>
+
+namespace raytrace {
+
+// Append v to out most significant byte first, as zlib, PNG and QOI all
+// store their 32 bit numbers
+inline void put_u32(std::string &out, std::uint32_t v) {
+  for (int shift = 24; shift >= 0; shift -= 8) {
+    out.push_back(static_cast<char>((v >> shift) & 0xff));
+  }
+}
+
+} // namespace raytrace
+#endif
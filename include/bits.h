@@ -0,0 +1,26 @@
+#ifndef RAYTRACE_BITS_H_GUARD
+#define RAYTRACE_BITS_H_GUARD
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace raytrace {
+
+// The bit pattern of f, for hashing floats or writing them out exactly
+inline auto bits_of(float f) -> std::uint32_t {
+  auto bits = std::uint32_t{};
+  std::memcpy(&bits, &f, sizeof bits);
+  return bits;
+}
+
+// Exactly equal, unlike operator==, which allows for rounding and so
+// misses small moves. Only for types made of floats, with no padding.
+template <typename T>
+auto same_bits(T const &lhs, T const &rhs) -> bool {
+  static_assert(std::is_trivially_copyable_v<T>);
+  return std::memcmp(&lhs, &rhs, sizeof(T)) == 0;
+}
+
+} // namespace raytrace
+#endif
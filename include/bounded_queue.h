@@ -0,0 +1,77 @@
+#ifndef RAYTRACE_BOUNDED_QUEUE_H_GUARD
+#define RAYTRACE_BOUNDED_QUEUE_H_GUARD
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+
+namespace raytrace {
+
+// A first in, first out queue between threads that holds at most capacity
+// items: push() waits for room and pop() waits for an item, so a fast
+// producer can't run away from a slow consumer.
+template <typename T> class BoundedQueue {
+public:
+  explicit BoundedQueue(std::size_t capacity) : capacity_(capacity) {
+    if (capacity == 0) {
+      throw std::invalid_argument("Queue capacity must be greater than zero");
+    }
+  }
+
+  BoundedQueue(BoundedQueue const &) = delete;
+  auto operator=(BoundedQueue const &) -> BoundedQueue & = delete;
+
+  // Returns false, dropping item, if the queue has been closed
+  auto push(T item) -> bool {
+    auto lock = std::unique_lock{mutex_};
+    not_full_.wait(lock,
+                   [this]() { return closed_ || items_.size() < capacity_; });
+    if (closed_) {
+      return false;
+    }
+    items_.push_back(std::move(item));
+    lock.unlock();
+    not_empty_.notify_one();
+    return true;
+  }
+
+  // The next item, or nothing once the queue is closed and empty
+  auto pop() -> std::optional<T> {
+    auto lock = std::unique_lock{mutex_};
+    not_empty_.wait(lock, [this]() { return closed_ || !items_.empty(); });
+    if (items_.empty()) {
+      return std::nullopt;
+    }
+    auto item = std::move(items_.front());
+    items_.pop_front();
+    lock.unlock();
+    not_full_.notify_one();
+    return item;
+  }
+
+  // No more pushes; pop() drains what's left
+  void close() {
+    {
+      auto lock = std::lock_guard{mutex_};
+      closed_ = true;
+    }
+    not_full_.notify_all();
+    not_empty_.notify_all();
+  }
+
+  auto capacity() const -> std::size_t { return capacity_; }
+
+private:
+  std::size_t capacity_;
+  std::deque<T> items_;
+  bool closed_{false};
+  std::mutex mutex_;
+  std::condition_variable not_full_;
+  std::condition_variable not_empty_;
+};
+
+} // namespace raytrace
+#endif
@@ -0,0 +1,53 @@
+#ifndef RAYTRACE_BOUNDS_H_GUARD
+#define RAYTRACE_BOUNDS_H_GUARD
+
+#include "matrix.h"
+#include "primitives.h"
+
+#include <algorithm>
+#include <array>
+
+namespace raytrace {
+
+// An axis aligned bounding box
+struct Bounds {
+  Point min{0, 0, 0};
+  Point max{0, 0, 0};
+
+  auto corners() const -> std::array<Point, 8> {
+    return {Point{min.x, min.y, min.z}, Point{min.x, min.y, max.z},
+            Point{min.x, max.y, min.z}, Point{min.x, max.y, max.z},
+            Point{max.x, min.y, min.z}, Point{max.x, min.y, max.z},
+            Point{max.x, max.y, min.z}, Point{max.x, max.y, max.z}};
+  }
+
+  auto include(Point p) -> Bounds & {
+    min = Point{std::min(min.x, p.x), std::min(min.y, p.y),
+                std::min(min.z, p.z)};
+    max = Point{std::max(max.x, p.x), std::max(max.y, p.y),
+                std::max(max.z, p.z)};
+    return *this;
+  }
+
+  // The box around this one after it's been transformed
+  auto transformed(Matrix4 const &m) const -> Bounds {
+    auto points = corners();
+    auto first = m * points[0];
+    auto result = Bounds{first, first};
+    for (auto const &p : points) {
+      result.include(m * p);
+    }
+    return result;
+  }
+
+  friend auto operator==(Bounds const &lhs, Bounds const &rhs) -> bool {
+    return lhs.min == rhs.min && lhs.max == rhs.max;
+  }
+
+  friend auto operator!=(Bounds const &lhs, Bounds const &rhs) -> bool {
+    return !(lhs == rhs);
+  }
+};
+
+} // namespace raytrace
+#endif
@@ -7,9 +7,20 @@
 #include "world.h"
 
 #include <cmath>
+#include <cstddef>
+#include <optional>
+#include <vector>
 
 namespace raytrace {
 
+// Where a point lands in the image, in pixels: pixel (x, y) covers
+// [x, x + 1) x [y, y + 1). depth is its distance in front of the camera.
+struct ScreenPoint {
+  float x;
+  float y;
+  float depth;
+};
+
 class Camera {
 public:
   Camera(int h_size, int v_size, float fov,
@@ -33,6 +44,58 @@ public:
 
   auto render(World &world) const -> Canvas;
 
+  // Render just the pixels in crop, into a canvas the size of crop whose
+  // pixel (0, 0) is the image's pixel (crop.x, crop.y). The pixels come out
+  // exactly as they do in a full render.
+  auto render(World &world, Tile crop) const -> Canvas;
+
+  // Render into image, which may be a view over memory someone else owns,
+  // in any pixel format, without allocating a canvas of its own. Throws
+  // std::invalid_argument if image isn't the camera's size.
+  void render_into(World &world, Canvas &image) const;
+
+  // Render into the caller's buffer at data: h_size() x v_size() pixels in
+  // format, with rows stride bytes apart. Throws std::invalid_argument if
+  // width and height aren't the camera's, or the rows overlap.
+  void render_into(World &world, unsigned char *data, int width, int height,
+                   std::ptrdiff_t stride,
+                   PixelFormat format = PixelFormat::rgb_float) const;
+
+  static constexpr int default_tile_size = 16;
+
+  // The image split into tile_size squares, left to right, top to bottom.
+  // Tiles on the right and bottom edges may be smaller. Throws
+  // std::invalid_argument unless tile_size is greater than zero.
+  auto tiles(int tile_size = default_tile_size) const -> std::vector<Tile>;
+
+  // Render just the pixels in tile into image, whose pixel (0, 0) is the
+  // camera's pixel (origin_x, origin_y). The world should already be
+  // committed.
+  void render_tile(World const &world, Canvas &image, Tile tile,
+                   int origin_x = 0, int origin_y = 0) const;
+
+  // Bring image, rendered earlier with this camera when the world looked
+  // like since, up to date with the world by re-rendering only the tiles
+  // that its changed shapes, and their shadows, could touch. Falls back to
+  // the whole image when the lights changed, since is empty or a shape's
+  // bounds can't be projected, e.g. for planes. since is then updated to
+  // match image. Returns the number of tiles rendered.
+  auto render_changes(World &world, Canvas &image, WorldSnapshot &since,
+                      int tile_size = default_tile_size) const -> std::size_t;
+
+  // Where p lands in the image, or nothing if it's not in front of the
+  // camera
+  auto project(Point p) const -> std::optional<ScreenPoint>;
+
+  friend auto operator==(Camera const &lhs, Camera const &rhs) -> bool {
+    return lhs.h_size_ == rhs.h_size_ && lhs.v_size_ == rhs.v_size_ &&
+           lhs.fov_ == rhs.fov_ && lhs.transform_ == rhs.transform_;
+  }
+
+  friend auto operator!=(Camera const &lhs, Camera const &rhs) -> bool {
+    return !(lhs == rhs);
+  }
+
 private:
   int h_size_;
   int v_size_;
@@ -43,6 +106,11 @@ private:
   float pixel_size_;
 
   void compute_pixel_size();
+
+  // The pixels that change could have touched, or nothing if they can't be
+  // worked out
+  auto changed_region(World &world, ShapeChange const &change) const
+      -> std::optional<Tile>;
 };
 
 } // namespace raytrace
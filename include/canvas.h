@@ -2,7 +2,13 @@
 #define RAYTRACE_CANVAS_H_GUARD
 
 #include "color.h"
+#include "half.h"
+#include "ppm.h"
 
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
 #include <stdexcept>
 #include <string>
 #include <vector>
@@ -14,41 +20,159 @@ struct Coordinate {
   int y;
 };
 
+// A rectangle of pixels
+struct Tile {
+  int x;
+  int y;
+  int width;
+  int height;
+
+  friend auto operator==(Tile lhs, Tile rhs) -> bool {
+    return lhs.x == rhs.x && lhs.y == rhs.y && lhs.width == rhs.width &&
+           lhs.height == rhs.height;
+  }
+
+  friend auto operator!=(Tile lhs, Tile rhs) -> bool { return !(lhs == rhs); }
+};
+
+// How a canvas stores each pixel
+enum class PixelFormat {
+  // Three floats, r g b
+  rgb_float,
+  // Three bytes, quantized as PPM files are
+  rgb8,
+  // Four bytes, quantized as PPM files are, with alpha always opaque
+  rgba8,
+  // Three half precision floats, for high dynamic range in half the space
+  rgb_half,
+};
+
+// Bytes per pixel in format
+constexpr auto pixel_size(PixelFormat format) -> std::size_t {
+  switch (format) {
+  case PixelFormat::rgb8:
+    return 3;
+  case PixelFormat::rgba8:
+    return 4;
+  case PixelFormat::rgb_half:
+    return 3 * sizeof(std::uint16_t);
+  case PixelFormat::rgb_float:
+    break;
+  }
+  return 3 * sizeof(float);
+}
+
 class Canvas {
 public:
-  Canvas(int width, int height) : m_width(width), m_height(height) {
-    if (width <= 0 || height <= 0) {
-      throw std::out_of_range("height and width must be greater than zero");
-    }
-    m_pixels = std::vector<Color>(static_cast<size_t>(width) *
-                                      static_cast<size_t>(height),
-                                  Color{0, 0, 0});
-  }
+  Canvas(int width, int height, PixelFormat format = PixelFormat::rgb_float);
 
-  Color pixel_at(int x, int y) {
-    if (x < 0 || y < 0) {
-      throw std::out_of_range("Pixel coordinates must be non-negative");
-    }
-    return m_pixels.at(x + static_cast<size_t>(y) * m_width);
+  // A canvas over pixels in memory it doesn't own, with the start of each
+  // row stride bytes after the one before; a negative stride stores the
+  // rows bottom up. owner is kept alive as long as the canvas is. Copies of
+  // the canvas get pixels of their own.
+  Canvas(int width, int height, PixelFormat format, unsigned char *data,
+         std::ptrdiff_t stride, std::shared_ptr<void> owner);
+
+  Canvas(Canvas const &other);
+  Canvas(Canvas &&other) noexcept = default;
+  auto operator=(Canvas const &other) -> Canvas &;
+  auto operator=(Canvas &&other) noexcept -> Canvas & = default;
+  ~Canvas() = default;
+
+  Color pixel_at(int x, int y) const {
+    return read(pixel_address(x, y));
   }
 
   auto write_pixel(int x, int y, Color c) -> Canvas & {
-    if (x < 0 || y < 0) {
-      throw std::out_of_range("Pixel coordinates must be non-negative");
-    }
-    m_pixels.at(x + static_cast<size_t>(y) * m_width) = c;
+    write(pixel_address(x, y), c);
     return *this;
   }
 
-  auto width() -> int { return m_width; }
-  auto height() -> int { return m_height; }
+  auto width() const -> int { return m_width; }
+  auto height() const -> int { return m_height; }
+  auto format() const -> PixelFormat { return m_format; }
+  auto stride() const -> std::ptrdiff_t { return m_stride; }
 
-  auto to_ppm() -> std::string;
+  // The first byte of row y
+  auto row(int y) -> unsigned char * { return m_data + y * m_stride; }
+  auto row(int y) const -> unsigned char const * {
+    return m_data + y * m_stride;
+  }
+
+  // A copy of the image stored as format
+  auto converted(PixelFormat format) const -> Canvas;
+
+  auto to_ppm() const -> std::string;
+
+  // The same image as binary PPM (P6), one byte per channel, quantized
+  // exactly as to_ppm() does
+  auto to_ppm_binary() const -> std::string;
 
 private:
   int m_width;
   int m_height;
-  std::vector<Color> m_pixels;
+  PixelFormat m_format;
+  std::ptrdiff_t m_stride;
+  unsigned char *m_data;
+  std::vector<unsigned char> m_pixels;
+  std::shared_ptr<void> m_owner;
+
+  auto pixel_address(int x, int y) const -> unsigned char * {
+    if (x < 0 || y < 0) {
+      throw std::out_of_range("Pixel coordinates must be non-negative");
+    }
+    if (x >= m_width || y >= m_height) {
+      throw std::out_of_range("Pixel coordinates must be inside the canvas");
+    }
+    return m_data + y * m_stride +
+           static_cast<std::ptrdiff_t>(x * pixel_size(m_format));
+  }
+
+  auto read(unsigned char const *pixel) const -> Color {
+    switch (m_format) {
+    case PixelFormat::rgb8:
+    case PixelFormat::rgba8:
+      return Color{pixel[0] / 255.0f, pixel[1] / 255.0f, pixel[2] / 255.0f};
+    case PixelFormat::rgb_half: {
+      std::uint16_t rgb[3];
+      std::memcpy(rgb, pixel, sizeof rgb);
+      return Color{from_half(rgb[0]), from_half(rgb[1]), from_half(rgb[2])};
+    }
+    case PixelFormat::rgb_float:
+      break;
+    }
+    float rgb[3];
+    std::memcpy(rgb, pixel, sizeof rgb);
+    return Color{rgb[0], rgb[1], rgb[2]};
+  }
+
+  friend void convert(Canvas const &from, Canvas &to);
+
+  void write(unsigned char *pixel, Color c) {
+    switch (m_format) {
+    case PixelFormat::rgba8:
+      pixel[3] = 255;
+      [[fallthrough]];
+    case PixelFormat::rgb8:
+      pixel[0] = static_cast<unsigned char>(ppm_value(c.r));
+      pixel[1] = static_cast<unsigned char>(ppm_value(c.g));
+      pixel[2] = static_cast<unsigned char>(ppm_value(c.b));
+      return;
+    case PixelFormat::rgb_half: {
+      std::uint16_t const rgb[3] = {to_half(c.r), to_half(c.g), to_half(c.b)};
+      std::memcpy(pixel, rgb, sizeof rgb);
+      return;
+    }
+    case PixelFormat::rgb_float:
+      break;
+    }
+    float const rgb[3] = {c.r, c.g, c.b};
+    std::memcpy(pixel, rgb, sizeof rgb);
+  }
 };
+
+// Copy from's pixels into to, converting between their formats. Throws
+// std::invalid_argument if they're different sizes.
+void convert(Canvas const &from, Canvas &to);
 } // namespace raytrace
 #endif // ! CANVAS_H
@@ -0,0 +1,51 @@
+#ifndef RAYTRACE_CHECKPOINT_H_GUARD
+#define RAYTRACE_CHECKPOINT_H_GUARD
+
+#include "camera.h"
+#include "canvas.h"
+#include "thread_pool.h"
+#include "world.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace raytrace {
+
+// A fingerprint of everything in the world that affects how it renders:
+// the shapes' kinds, transforms and materials and all the lights
+auto scene_hash(World &world) -> std::uint64_t;
+
+struct CheckpointOptions {
+  // The checkpoint file, created if it doesn't exist
+  std::string path;
+  // How often finished tiles are written out
+  std::chrono::milliseconds interval{1000};
+  int tile_size{Camera::default_tile_size};
+};
+
+struct CheckpointedRender {
+  Canvas image;
+  // Tiles read back from the checkpoint, and tiles rendered this time
+  std::size_t tiles_resumed;
+  std::size_t tiles_rendered;
+};
+
+// Render on pool, saving finished tiles to a checkpoint file as it goes.
+// The file starts with a manifest of the scene hash, camera and tile size.
+// If it already holds a checkpoint with the same manifest, the tiles in it
+// are reused and only the rest are rendered; otherwise it's started over.
+// Tiles are handed to a writer thread that appends them to the file every
+// interval, so the render threads never wait on the disk. A tile cut off
+// part way through being written is rendered again. The finished file
+// holds the whole image and is left in place. Throws std::runtime_error if
+// the checkpoint can't be written, stopping the render early if it fails
+// part way through. If a tile fails to render the rest are skipped, the
+// tiles already finished are still saved, and the error is rethrown.
+auto render_checkpointed(Camera const &camera, World &world, ThreadPool &pool,
+                         CheckpointOptions const &options)
+    -> CheckpointedRender;
+
+} // namespace raytrace
+#endif
@@ -0,0 +1,29 @@
+#ifndef RAYTRACE_DEFLATE_H_GUARD
+#define RAYTRACE_DEFLATE_H_GUARD
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace raytrace {
+
+class ThreadPool;
+
+// CRC-32 of size bytes at data, continuing from crc, as PNG chunks use
+auto crc32(unsigned char const *data, std::size_t size,
+           std::uint32_t crc = 0) -> std::uint32_t;
+
+// Adler-32 of size bytes at data, continuing from adler, as zlib uses
+auto adler32(unsigned char const *data, std::size_t size,
+             std::uint32_t adler = 1) -> std::uint32_t;
+
+// size bytes at data compressed as a zlib stream (RFC 1950 and 1951).
+// The data is cut into fixed size blocks that are compressed at the same
+// time on pool, each able to refer back into the one before it, and the
+// results joined, so the output doesn't depend on how many threads there
+// are.
+auto zlib_compress(unsigned char const *data, std::size_t size,
+                   ThreadPool &pool) -> std::string;
+
+} // namespace raytrace
+#endif
@@ -0,0 +1,15 @@
+#ifndef RAYTRACE_ELAPSED_H_GUARD
+#define RAYTRACE_ELAPSED_H_GUARD
+
+#include <chrono>
+
+namespace raytrace {
+
+// Milliseconds from begin to end, keeping the fraction
+inline auto ms_between(std::chrono::steady_clock::time_point begin,
+                       std::chrono::steady_clock::time_point end) -> double {
+  return std::chrono::duration<double, std::milli>(end - begin).count();
+}
+
+} // namespace raytrace
+#endif
@@ -0,0 +1,57 @@
+#ifndef RAYTRACE_HALF_H_GUARD
+#define RAYTRACE_HALF_H_GUARD
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace raytrace {
+
+// IEEE 754 half precision floats, stored as their bits
+
+// Rounded to nearest even; too big becomes infinity
+inline auto to_half(float f) -> std::uint16_t {
+  auto bits = std::uint32_t{};
+  std::memcpy(&bits, &f, sizeof bits);
+  auto sign = static_cast<std::uint16_t>((bits >> 16) & 0x8000u);
+  auto magnitude = bits & 0x7fffffffu;
+
+  if (magnitude >= 0x7f800000u) {
+    // Infinity stays infinity, NaN stays NaN
+    return static_cast<std::uint16_t>(
+        sign | (magnitude > 0x7f800000u ? 0x7e00u : 0x7c00u));
+  }
+  if (magnitude >= 0x477ff000u) {
+    // 65520 and up round past the largest half, 65504
+    return static_cast<std::uint16_t>(sign | 0x7c00u);
+  }
+  if (magnitude < 0x38800000u) {
+    // Below the smallest normal half: a multiple of 2^-24
+    auto steps = std::nearbyint(std::fabs(f) * 16777216.0f);
+    return static_cast<std::uint16_t>(sign | static_cast<std::uint32_t>(steps));
+  }
+  auto half = (magnitude >> 13) - (112u << 10);
+  auto rest = magnitude & 0x1fffu;
+  if (rest > 0x1000u || (rest == 0x1000u && (half & 1u))) {
+    ++half;
+  }
+  return static_cast<std::uint16_t>(sign | half);
+}
+
+inline auto from_half(std::uint16_t h) -> float {
+  auto sign = static_cast<std::uint32_t>(h & 0x8000u) << 16;
+  auto exponent = (h >> 10) & 0x1fu;
+  auto mantissa = static_cast<std::uint32_t>(h & 0x3ffu);
+  if (exponent == 0) {
+    auto f = static_cast<float>(mantissa) / 16777216.0f;
+    return sign ? -f : f;
+  }
+  auto bits = sign | (mantissa << 13) |
+              (exponent == 0x1fu ? 0x7f800000u : (exponent + 112u) << 23);
+  auto f = 0.0f;
+  std::memcpy(&f, &bits, sizeof f);
+  return f;
+}
+
+} // namespace raytrace
+#endif
@@ -0,0 +1,40 @@
+#ifndef RAYTRACE_IMAGE_OUTPUT_H_GUARD
+#define RAYTRACE_IMAGE_OUTPUT_H_GUARD
+
+#include "quantize.h"
+
+#include <string>
+
+namespace raytrace {
+
+class Canvas;
+class ThreadPool;
+
+// The file formats a finished image can be saved as
+enum class ImageFormat {
+  // Plain text PPM (P3)
+  ppm,
+  // Quite OK Image, lossless and quick
+  qoi,
+  // PNG, lossless and smaller
+  png,
+  // Portable float map, the linear floats as rendered
+  pfm,
+};
+
+// The format for a file named path, going by its extension: .qoi, .png or
+// .pfm, in any case, and PPM for anything else
+auto image_format_for(std::string const &path) -> ImageFormat;
+
+// image encoded as format. Every format but PFM, which keeps the floats as
+// they are, is quantized to 8 bits by quantization.
+auto encode_image(Canvas const &image, ImageFormat format, ThreadPool &pool,
+                  Quantization const &quantization = {}) -> std::string;
+
+// Save image to path in the format its extension asks for. Throws
+// std::runtime_error if the file can't be written.
+void write_image(std::string const &path, Canvas const &image,
+                 ThreadPool &pool, Quantization const &quantization = {});
+
+} // namespace raytrace
+#endif
@@ -3,17 +3,30 @@
 
 #include "color.h"
 #include "primitives.h"
+#include "sampling.h"
 
+#include <limits>
 #include <ostream>
+#include <stdexcept>
+#include <vector>
 
 namespace raytrace {
 
 struct PointLight {
   Point position{0.0f, 0.0f, 0.0f};
   Color intensity{colors::white};
+  // Points farther than this from the light get nothing from it, not even
+  // ambient, so shading can skip the light entirely.
+  float range{std::numeric_limits<float>::infinity()};
+
+  auto reaches(Point p) const -> bool {
+    auto v = p - position;
+    return v.dot(v) <= range * range;
+  }
 
   friend auto operator==(PointLight lhs, PointLight rhs) {
-    return lhs.position == rhs.position && lhs.intensity == rhs.intensity;
+    return lhs.position == rhs.position && lhs.intensity == rhs.intensity &&
+           lhs.range == rhs.range;
   }
 
   friend auto operator!=(PointLight lhs, PointLight rhs) {
@@ -27,5 +40,92 @@ inline auto operator<<(std::ostream &os, PointLight const &val)
   return os;
 }
 
+// A light with extent, which casts soft shadows. It's shaded by spreading
+// its intensity over samples() points on its surface, one in each of a set of
+// strata, and tracing a shadow ray toward each.
+class AreaLight {
+public:
+  enum class Kind { rectangle, sphere };
+
+  auto kind() const -> Kind { return kind_; }
+  auto intensity() const -> Color { return intensity_; }
+  auto center() const -> Point;
+  auto samples() const -> int { return usteps_ * vsteps_; }
+
+  // Once this many shadow rays all agree, fully lit or fully shadowed, stop
+  // tracing and use the samples taken so far. 0 always traces every sample.
+  auto adaptive_samples() const -> int { return adaptive_samples_; }
+  auto adaptive_samples(int samples) -> AreaLight & {
+    if (samples < 0) {
+      throw std::out_of_range("Adaptive samples must be non-negative");
+    }
+    adaptive_samples_ = samples;
+    return *this;
+  }
+
+  // With jitter off, every sample sits in the middle of its stratum
+  auto jitter() const -> bool { return jitter_; }
+  auto jitter(bool jitter) -> AreaLight & {
+    jitter_ = jitter;
+    return *this;
+  }
+
+  // Sample i lies in stratum order(i). Consecutive samples are spread
+  // across the light, so stopping early still covers all of it.
+  auto order(int i) const -> int { return (i * stride_) % samples(); }
+
+  // The position of sample i, seen from point p (a sphere light is sampled
+  // on the hemisphere facing p)
+  auto point_on_light(int i, Rng &rng, Point p) const -> Point;
+
+  // The corners of the light's extent
+  auto extent() const -> std::vector<Point>;
+
+  friend auto operator==(AreaLight const &lhs, AreaLight const &rhs) -> bool {
+    return lhs.kind_ == rhs.kind_ && lhs.corner_ == rhs.corner_ &&
+           lhs.uvec_ == rhs.uvec_ && lhs.usteps_ == rhs.usteps_ &&
+           lhs.vvec_ == rhs.vvec_ && lhs.vsteps_ == rhs.vsteps_ &&
+           lhs.radius_ == rhs.radius_ && lhs.intensity_ == rhs.intensity_ &&
+           lhs.adaptive_samples_ == rhs.adaptive_samples_ &&
+           lhs.jitter_ == rhs.jitter_;
+  }
+
+  friend auto operator!=(AreaLight const &lhs, AreaLight const &rhs) -> bool {
+    return !(lhs == rhs);
+  }
+
+  friend auto rectangle_light(Point corner, Vector3 full_uvec, int usteps,
+                              Vector3 full_vvec, int vsteps, Color intensity)
+      -> AreaLight;
+  friend auto sphere_light(Point center, float radius, int samples,
+                           Color intensity) -> AreaLight;
+
+private:
+  AreaLight(Kind kind, Point corner, Vector3 uvec, int usteps, Vector3 vvec,
+            int vsteps, float radius, Color intensity);
+
+  Kind kind_;
+  Point corner_;
+  Vector3 uvec_;
+  int usteps_;
+  Vector3 vvec_;
+  int vsteps_;
+  float radius_;
+  Color intensity_;
+  int adaptive_samples_{0};
+  bool jitter_{true};
+  int stride_{1};
+};
+
+// A rectangle with one corner at corner and sides full_uvec and full_vvec,
+// split into usteps x vsteps cells with one sample each
+auto rectangle_light(Point corner, Vector3 full_uvec, int usteps,
+                     Vector3 full_vvec, int vsteps, Color intensity)
+    -> AreaLight;
+
+// A sphere sampled at samples points, stratified by latitude
+auto sphere_light(Point center, float radius, int samples, Color intensity)
+    -> AreaLight;
+
 } // namespace raytrace
 #endif
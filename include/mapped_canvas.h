@@ -0,0 +1,30 @@
+#ifndef RAYTRACE_MAPPED_CANVAS_H_GUARD
+#define RAYTRACE_MAPPED_CANVAS_H_GUARD
+
+#include "canvas.h"
+
+#include <string>
+
+namespace raytrace {
+
+enum class ImageFile {
+  // Binary PPM (P6), 8 bits per channel
+  ppm,
+  // Portable float map, 32 bit floats in the machine's byte order, stored
+  // bottom row first
+  pfm,
+};
+
+// Create the image file path, width x height, with its header written, and
+// return a canvas whose pixels are the file's own bytes, mapped into
+// memory. Pixels written to the canvas are written to the file, so there's
+// nothing to encode or copy once it's rendered, and the OS pages frames
+// bigger than memory in and out as needed. The mapping is released with
+// the canvas (and whatever it's moved to); copies are ordinary in-memory
+// canvases. Throws std::runtime_error if the file can't be created or
+// mapped.
+auto map_image_file(std::string const &path, ImageFile format, int width,
+                    int height) -> Canvas;
+
+} // namespace raytrace
+#endif
@@ -0,0 +1,102 @@
+#ifndef RAYTRACE_MATERIAL_TABLE_H_GUARD
+#define RAYTRACE_MATERIAL_TABLE_H_GUARD
+
+#include "color.h"
+#include "lights.h"
+#include "materials.h"
+#include "primitives.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace raytrace {
+
+// A material prepared for shading with a fixed set of point lights. The
+// light colors it's multiplied by are worked out once, and the diffuse and
+// specular terms are computed by a function picked for the material, so
+// e.g. a material with no specular never calls std::pow.
+class CompiledMaterial {
+public:
+  CompiledMaterial(Material const &material,
+                   std::vector<PointLight> const &lights);
+
+  auto material() const -> Material const & { return material_; }
+
+  // The same as ambient_lighting() with point light i
+  auto ambient(std::size_t light) const -> Color { return ambient_[light]; }
+
+  // The same as direct_lighting() with point light i, given the unit vector
+  // from the point toward it
+  auto direct(std::size_t light, Vector3 to_light, Vector3 eye,
+              Vector3 normal) const -> Color {
+    return direct_(*this, light, to_light, eye, normal);
+  }
+
+private:
+  using DirectFn = auto (*)(CompiledMaterial const &, std::size_t, Vector3,
+                            Vector3, Vector3) -> Color;
+
+  Material material_;
+  std::vector<Color> ambient_;
+  std::vector<Color> diffuse_;
+  std::vector<Color> specular_;
+  int int_shininess_{0};
+  DirectFn direct_;
+
+  static auto direct_none(CompiledMaterial const &, std::size_t, Vector3,
+                          Vector3, Vector3) -> Color;
+  static auto direct_diffuse(CompiledMaterial const &m, std::size_t light,
+                             Vector3 to_light, Vector3 eye, Vector3 normal)
+      -> Color;
+  static auto direct_int_shininess(CompiledMaterial const &m,
+                                   std::size_t light, Vector3 to_light,
+                                   Vector3 eye, Vector3 normal) -> Color;
+  static auto direct_general(CompiledMaterial const &m, std::size_t light,
+                             Vector3 to_light, Vector3 eye, Vector3 normal)
+      -> Color;
+};
+
+// Every distinct material in a world, stored once and referred to by index
+class MaterialTable {
+public:
+  using size_type = std::vector<Material>::size_type;
+
+  // Add material unless one with bit for bit the same values is already
+  // there. Either way, return its index.
+  auto insert(Material const &material) -> size_type;
+
+  // Prepare every material for shading with lights
+  void compile(std::vector<PointLight> const &lights);
+
+  auto size() const -> size_type { return materials_.size(); }
+  auto empty() const -> bool { return materials_.empty(); }
+  void clear() {
+    materials_.clear();
+    compiled_.clear();
+    index_.clear();
+  }
+
+  // Only valid after compile()
+  auto operator[](size_type i) const -> CompiledMaterial const & {
+    return compiled_[i];
+  }
+
+private:
+  // A material's values as bits, so that materials are told apart exactly:
+  // -0 isn't 0, and a NaN matches itself
+  using Key = std::array<std::uint32_t, 7>;
+  struct KeyHash {
+    auto operator()(Key const &key) const -> std::size_t;
+  };
+  static auto key_of(Material const &material) -> Key;
+
+  std::vector<Material> materials_;
+  std::vector<CompiledMaterial> compiled_;
+  std::unordered_map<Key, size_type, KeyHash> index_;
+};
+
+} // namespace raytrace
+#endif
@@ -13,7 +13,7 @@ public:
   Material() = default;
   Material(Color color) : color_(color){};
 
-  auto color() -> Color const { return color_; }
+  auto color() const -> Color { return color_; }
   auto color(Color color) -> Material & {
     color_ = color;
     return *this;
@@ -78,8 +78,19 @@ private:
   float shininess_{200.0f};
 };
 
-auto lighting(Material material, PointLight light, Point point, Vector3 eye,
-              Vector3 normal, bool in_shadow = false) -> Color;
+// The ambient term of the Phong model, which is added whether or not the
+// light can see the point.
+auto ambient_lighting(Material const &material, PointLight const &light)
+    -> Color;
+
+// The diffuse and specular terms, assuming nothing blocks the light. Black
+// when the light is behind the surface or the material reflects none of it,
+// in which case there is no point in tracing a shadow ray toward the light.
+auto direct_lighting(Material const &material, PointLight const &light,
+                     Point point, Vector3 eye, Vector3 normal) -> Color;
+
+auto lighting(Material const &material, PointLight const &light, Point point,
+              Vector3 eye, Vector3 normal, bool in_shadow = false) -> Color;
 
 } // namespace raytrace
 #endif
@@ -0,0 +1,48 @@
+#ifndef RAYTRACE_PARTIAL_IMAGE_H_GUARD
+#define RAYTRACE_PARTIAL_IMAGE_H_GUARD
+
+#include "canvas.h"
+
+#include <istream>
+#include <ostream>
+#include <vector>
+
+namespace raytrace {
+
+// A piece of a larger image, e.g. one shard of a render split between
+// processes
+struct PartialImage {
+  // The largest full image read_partial accepts, since merging allocates
+  // all of it
+  static constexpr int max_dimension = 65536;
+  static constexpr long long max_pixels = 16384LL * 16384LL;
+
+  int full_width;
+  int full_height;
+  Tile crop;
+  Canvas pixels;
+};
+
+// The crop window for shard of shards, a band of at least one whole row.
+// Together the shards cover the image exactly once. Throws
+// std::out_of_range if shard isn't in [0, shards) or there are more shards
+// than rows.
+auto shard_crop(int width, int height, int shard, int shards) -> Tile;
+
+// Write part in a compact binary form: a short text header followed by the
+// raw float pixels, so merging loses nothing. The floats are always
+// little endian, so shards can be merged on a machine other than the one
+// that rendered them.
+void write_partial(std::ostream &os, PartialImage const &part);
+
+// Throws std::runtime_error if is doesn't hold a partial image, its crop
+// doesn't lie inside the full image, or the full image is bigger than
+// max_dimension across or down or max_pixels in all
+auto read_partial(std::istream &is) -> PartialImage;
+
+// Put parts of the same image back together. Throws std::invalid_argument
+// if they disagree on the image size, overlap, or leave gaps.
+auto merge_partials(std::vector<PartialImage> const &parts) -> Canvas;
+
+} // namespace raytrace
+#endif
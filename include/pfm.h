@@ -0,0 +1,28 @@
+#ifndef RAYTRACE_PFM_H_GUARD
+#define RAYTRACE_PFM_H_GUARD
+
+#include <ostream>
+#include <string>
+
+namespace raytrace {
+
+class Canvas;
+
+// The header of a colour portable float map, width x height, whose floats
+// are in the machine's byte order
+auto pfm_header(int width, int height) -> std::string;
+
+// Append rows [y0, y1) of image to out as PFM, unquantized linear floats.
+// PFM stores the bottom row first, so the rows go from y1 - 1 up to y0,
+// and an image encoded a band at a time is joined bottom band first.
+void append_pfm_rows(std::string &out, Canvas const &image, int y0, int y1);
+
+// The whole of image as a PFM file
+auto encode_pfm(Canvas const &image) -> std::string;
+
+// Write the whole of image to os as a PFM file. A float canvas's rows are
+// written straight from its pixels, with nothing converted or copied.
+void write_pfm(std::ostream &os, Canvas const &image);
+
+} // namespace raytrace
+#endif
@@ -13,6 +13,8 @@ class Plane : public Shape {
 public:
   using Shape::Shape;
 
+  auto kind() const -> char const * override { return "plane"; }
+
   auto local_normal_at(Point /* unused */) const -> Vector3 override {
     return Vector3{0.0f, 1.0f, 0.0f};
   }
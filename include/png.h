@@ -0,0 +1,20 @@
+#ifndef RAYTRACE_PNG_H_GUARD
+#define RAYTRACE_PNG_H_GUARD
+
+#include "quantize.h"
+
+#include <string>
+
+namespace raytrace {
+
+class Canvas;
+class ThreadPool;
+
+// image as a PNG file, 8 bit RGB. Each row is
+// filtered with whichever PNG filter leaves the smallest differences, and the
+// filtered rows compressed a block at a time on pool.
+auto encode_png(Canvas const &image, ThreadPool &pool,
+                Quantization const &quantization = {}) -> std::string;
+
+} // namespace raytrace
+#endif
@@ -0,0 +1,39 @@
+#ifndef RAYTRACE_PPM_H_GUARD
+#define RAYTRACE_PPM_H_GUARD
+
+#include "quantize.h"
+
+#include <cmath>
+#include <string>
+
+namespace raytrace {
+
+class Canvas;
+class ThreadPool;
+
+// PPM comes as plain text (P3) or raw bytes (P6)
+enum class PpmFormat { plain, raw };
+
+// A channel as a PPM value: scaled to 0-255, rounded up and clamped.
+// Clamping comes first so huge values can't overflow; NaN comes out 0.
+inline auto ppm_value(float channel) -> int {
+  auto v = channel * 255;
+  v = v > 0.0f ? v : 0.0f;
+  v = v < 255.0f ? v : 255.0f;
+  return static_cast<int>(std::ceil(v));
+}
+
+auto ppm_header(PpmFormat format, int width, int height) -> std::string;
+
+// Append rows [y0, y1) of image to out. Every row starts on a new line, so
+// an image can be encoded a band of rows at a time and the pieces joined.
+void append_ppm_rows(std::string &out, PpmFormat format, Canvas const &image,
+                     int y0, int y1, Quantization const &quantization = {});
+
+// The whole of image as a PPM file, encoded a chunk of rows per task on
+// pool. The same bytes as encoding it in one go.
+auto encode_ppm(Canvas const &image, PpmFormat format, ThreadPool &pool,
+                Quantization const &quantization = {}) -> std::string;
+
+} // namespace raytrace
+#endif
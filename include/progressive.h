@@ -0,0 +1,48 @@
+#ifndef RAYTRACE_PROGRESSIVE_H_GUARD
+#define RAYTRACE_PROGRESSIVE_H_GUARD
+
+#include "camera.h"
+#include "canvas.h"
+#include "thread_pool.h"
+#include "world.h"
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+
+namespace raytrace {
+
+// How the pixels a pass hasn't reached yet are filled in
+enum class Upsample { nearest, bilinear };
+
+struct ProgressiveOptions {
+  // Spacing of the first pass's pixels, a power of two: 4 traces 1 pixel
+  // in 16, then 1 in 4, then the rest
+  int coarsest{4};
+  Upsample upsample{Upsample::bilinear};
+  // Called with the filled in image after each pass that finishes, and
+  // the spacing of that pass
+  std::function<void(Canvas const &image, int spacing)> on_pass;
+};
+
+struct ProgressiveImage {
+  Canvas image;
+  // Spacing of the finest pass that finished; 1 when every pixel was traced
+  int spacing;
+  // Pixels actually traced, including any from a pass cut short
+  std::size_t traced;
+
+  auto complete() const -> bool { return spacing == 1; }
+};
+
+// Render coarse to fine, each pass tracing only the pixels on its grid that
+// earlier passes haven't, and filling the gaps from the finest finished
+// grid. Stops at deadline with the best image so far. The first pass
+// always finishes, however late, so there's always a whole image.
+auto render_progressive(Camera const &camera, World &world, ThreadPool &pool,
+                        std::chrono::steady_clock::time_point deadline,
+                        ProgressiveOptions const &options = {})
+    -> ProgressiveImage;
+
+} // namespace raytrace
+#endif
@@ -0,0 +1,18 @@
+#ifndef RAYTRACE_QOI_H_GUARD
+#define RAYTRACE_QOI_H_GUARD
+
+#include "quantize.h"
+
+#include <string>
+
+namespace raytrace {
+
+class Canvas;
+
+// image as a QOI file ("Quite OK Image" format): lossless 8 bit RGB, and
+// much quicker to write than PNG
+auto encode_qoi(Canvas const &image, Quantization const &quantization = {})
+    -> std::string;
+
+} // namespace raytrace
+#endif
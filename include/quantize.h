@@ -0,0 +1,32 @@
+#ifndef RAYTRACE_QUANTIZE_H_GUARD
+#define RAYTRACE_QUANTIZE_H_GUARD
+
+#include <vector>
+
+namespace raytrace {
+
+class Canvas;
+
+// How float channels are turned into 8 bit values for output. The default
+// is exactly what PPM files have always held: each channel scaled to 0-255,
+// rounded up and clamped, as ppm_value() does.
+struct Quantization {
+  // Stops of exposure: channels are scaled by 2^exposure first
+  float exposure{0.0f};
+  // Encode with the sRGB transfer curve rather than writing linear values
+  bool srgb{false};
+  // Add a 4x4 ordered dither, so smooth gradients don't band. Values then
+  // round to nearest on average rather than up.
+  bool dither{false};
+};
+
+// Row y of image as 8 bit values in values, r g b for each pixel. The
+// whole row is converted in one vectorized pass. 8 bit canvases are
+// already quantized and are copied as they are. Shared by every encoder
+// that writes 8 bit channels.
+void quantize_row(Canvas const &image, int y,
+                  std::vector<unsigned char> &values,
+                  Quantization const &quantization = {});
+
+} // namespace raytrace
+#endif
@@ -0,0 +1,98 @@
+#ifndef RAYTRACE_RELIGHT_H_GUARD
+#define RAYTRACE_RELIGHT_H_GUARD
+
+#include "camera.h"
+#include "canvas.h"
+#include "matrix.h"
+#include "world.h"
+
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
+namespace raytrace {
+
+// The primary hit of every pixel, kept so the image can be shaded again
+// without recasting camera rays. Pixels whose ray missed hold nothing.
+class GBuffer {
+public:
+  GBuffer(int width, int height) : width_(width), height_(height) {
+    if (width <= 0 || height <= 0) {
+      throw std::out_of_range("height and width must be greater than zero");
+    }
+    hits_.resize(static_cast<size_t>(width) * static_cast<size_t>(height));
+  }
+
+  auto width() const -> int { return width_; }
+  auto height() const -> int { return height_; }
+
+  auto at(int x, int y) const -> std::optional<PreComps> const & {
+    return hits_.at(index(x, y));
+  }
+  auto set(int x, int y, std::optional<PreComps> hit) -> GBuffer & {
+    hits_.at(index(x, y)) = hit;
+    return *this;
+  }
+
+private:
+  int width_;
+  int height_;
+  std::vector<std::optional<PreComps>> hits_;
+
+  auto index(int x, int y) const -> size_t {
+    if (x < 0 || y < 0) {
+      throw std::out_of_range("Pixel coordinates must be non-negative");
+    }
+    return x + static_cast<size_t>(y) * width_;
+  }
+};
+
+// Cast the camera's primary rays and record what each one hits
+auto render_gbuffer(Camera const &camera, World &world) -> GBuffer;
+
+// Shade every recorded hit with the world's current lights and materials.
+// Only shadow rays are traced.
+auto shade_gbuffer(World &world, GBuffer const &gbuffer) -> Canvas;
+
+// Renders a world repeatedly, for when only lights and materials change
+// between renders. The primary hits are cached, and are only recast when
+// the world, its shapes, their transforms or the camera differ in any way
+// from the previous render.
+class Relighter {
+public:
+  Relighter(Camera camera) : camera_(camera) {}
+
+  auto camera() const -> Camera const & { return camera_; }
+  auto camera(Camera camera) -> Relighter & {
+    camera_ = camera;
+    return *this;
+  }
+
+  auto render(World &world) -> Canvas;
+
+  // Whether the last render reused the cached primary hits
+  auto reused() const -> bool { return reused_; }
+
+private:
+  // A shape as it was when the G-buffer was cast. The G-buffer's hits
+  // point at the shapes, so they have to be the very same ones.
+  struct CastShape {
+    Shape const *shape;
+    unsigned id;
+    Matrix4 transform;
+  };
+
+  Camera camera_;
+  std::optional<GBuffer> gbuffer_;
+  std::optional<Camera> gbuffer_camera_;
+  unsigned gbuffer_world_{0};
+  std::vector<CastShape> gbuffer_shapes_;
+  bool reused_{false};
+
+  static auto shapes_of(World &world) -> std::vector<CastShape>;
+  auto can_reuse(World const &world,
+                 std::vector<CastShape> const &shapes) const -> bool;
+};
+
+} // namespace raytrace
+#endif
@@ -0,0 +1,71 @@
+#ifndef RAYTRACE_RENDER_JOB_H_GUARD
+#define RAYTRACE_RENDER_JOB_H_GUARD
+
+#include "camera.h"
+#include "canvas.h"
+#include "thread_pool.h"
+#include "world.h"
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+
+namespace raytrace {
+
+// Called as each tile of an asynchronous render finishes, with the image
+// it's being rendered into. Only the pixels in tile, and in tiles passed
+// to earlier calls, are finished; the rest may still be being written.
+// Calls are made one at a time from a thread the job starts for them, so
+// a slow callback delays wait() but not the rendering on the pool.
+using TileCallback = std::function<void(Tile tile, Canvas const &image)>;
+
+// A render running in the background on a thread pool. Every member but
+// the destructor throws std::logic_error on a job that's been moved from.
+class RenderJob {
+public:
+  RenderJob(RenderJob &&) = default;
+  auto operator=(RenderJob &&) -> RenderJob & = default;
+
+  // Cancels the render if it's still going and waits for it to stop
+  ~RenderJob();
+
+  // Block until every tile is rendered, or skipped after cancel(), and
+  // return the image. Rethrows the first exception thrown rendering a tile
+  // or by a tile callback, which also cancels the rest of the render.
+  auto wait() -> Canvas const &;
+
+  // Stop rendering: tiles that haven't started are skipped, ones in
+  // progress finish. Returns immediately; call wait() before touching the
+  // world again.
+  void cancel();
+
+  auto cancelled() const -> bool;
+  auto done() const -> bool;
+
+  // Tiles fully rendered so far, out of tile_count()
+  auto tiles_completed() const -> std::size_t;
+  auto tile_count() const -> std::size_t;
+
+private:
+  struct State;
+  std::shared_ptr<State> state_;
+
+  auto state() const -> State &;
+
+  explicit RenderJob(std::shared_ptr<State> state)
+      : state_(std::move(state)) {}
+
+  friend auto render_async(Camera const &camera, World &world,
+                           ThreadPool &pool, TileCallback on_tile,
+                           int tile_size) -> RenderJob;
+};
+
+// Start rendering world through camera on pool, one task per tile, and
+// return without waiting. The world is committed first, and must be left
+// alone until the job is finished.
+auto render_async(Camera const &camera, World &world, ThreadPool &pool,
+                  TileCallback on_tile = {},
+                  int tile_size = Camera::default_tile_size) -> RenderJob;
+
+} // namespace raytrace
+#endif
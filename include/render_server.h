@@ -0,0 +1,107 @@
+#ifndef RAYTRACE_RENDER_SERVER_H_GUARD
+#define RAYTRACE_RENDER_SERVER_H_GUARD
+
+#include "camera.h"
+#include "primitives.h"
+#include "thread_pool.h"
+#include "world.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <istream>
+#include <mutex>
+#include <ostream>
+#include <string>
+
+namespace raytrace {
+
+// One image to render: its size and a camera, as view_transform()
+// parameters plus a field of view in radians
+struct RenderRequest {
+  int width;
+  int height;
+  Point from;
+  Point to;
+  Vector3 up;
+  float fov;
+
+  // The biggest image a request can ask for, so that one request can't
+  // make the server allocate without bound
+  static constexpr int max_dimension = 8192;
+  static constexpr long long max_pixels = 4096LL * 4096LL;
+
+  auto camera() const -> Camera;
+};
+
+// Parse the arguments of a render command:
+//   width height from.x from.y from.z to.x to.y to.z up.x up.y up.z fov
+// Throws std::invalid_argument if any are missing, the size is empty or
+// the image is bigger than RenderRequest allows.
+auto parse_render_request(std::string const &args) -> RenderRequest;
+
+// How long a request spent in each stage, in milliseconds
+struct RenderTiming {
+  double queued;
+  double rendered;
+  double encoded;
+};
+
+struct RenderResponse {
+  // A binary (P6) PPM
+  std::string image;
+  RenderTiming timing;
+};
+
+// Renders requests against a scene that stays loaded between them. The
+// world is committed once up front, so each request only pays for tracing
+// its own pixels. At most max_concurrent requests render at once, their
+// tiles sharing the pool; the rest wait their turn.
+class RenderServer {
+public:
+  RenderServer(World world, ThreadPool &pool, unsigned max_concurrent = 1);
+
+  RenderServer(RenderServer const &) = delete;
+  auto operator=(RenderServer const &) -> RenderServer & = delete;
+
+  auto max_concurrent() const -> unsigned { return max_concurrent_; }
+
+  // Safe to call from several threads at once
+  auto render(RenderRequest const &request) -> RenderResponse;
+
+  // Answer commands read from is, one per line, until quit or the end of
+  // the input:
+  //   render <request>  ->  image <width> <height> <bytes> <queued ms>
+  //                         <render ms> <encode ms>\n followed by the bytes
+  //   quit
+  // Anything else, or a bad request, gets error <message>\n and the
+  // session carries on. A line longer than max_line_length gets an error
+  // and ends the session, as does failing to write to os.
+  void serve(std::istream &is, std::ostream &os);
+
+  static constexpr std::size_t max_line_length = 1024;
+
+private:
+  World world_;
+  ThreadPool &pool_;
+  unsigned max_concurrent_;
+
+  std::mutex mutex_;
+  std::condition_variable slot_free_;
+  unsigned active_{0};
+
+  // Holds one of the max_concurrent render slots while it's alive
+  class Slot {
+  public:
+    explicit Slot(RenderServer &server);
+    ~Slot();
+
+    Slot(Slot const &) = delete;
+    auto operator=(Slot const &) -> Slot & = delete;
+
+  private:
+    RenderServer &server_;
+  };
+};
+
+} // namespace raytrace
+#endif
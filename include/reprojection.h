@@ -0,0 +1,109 @@
+#ifndef RAYTRACE_REPROJECTION_H_GUARD
+#define RAYTRACE_REPROJECTION_H_GUARD
+
+#include "camera.h"
+#include "canvas.h"
+#include "color.h"
+#include "primitives.h"
+#include "thread_pool.h"
+#include "world.h"
+
+#include <cstddef>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace raytrace {
+
+// What render_reprojected() saved. Every pixel still traces its primary
+// ray to check what it sees, so only shading is ever reused.
+struct ReprojectionStats {
+  // Pixels whose color came from the previous frame, and pixels shaded
+  // afresh
+  std::size_t shading_reused{0};
+  std::size_t shaded{0};
+  // Primary rays traced, one for every pixel
+  std::size_t primary_rays{0};
+
+  auto shading_reuse_rate() const -> float {
+    auto total = shading_reused + shaded;
+    return total > 0 ? static_cast<float>(shading_reused) / total : 0.0f;
+  }
+};
+
+// A rendered frame plus, for each pixel, the shape its ray hit and where,
+// so the next frame of an animation can reuse it
+class FrameHistory {
+public:
+  FrameHistory(int width, int height)
+      : width_(width), height_(height), image_(width, height),
+        positions_(static_cast<size_t>(width) * static_cast<size_t>(height)),
+        shape_ids_(positions_.size(), no_shape) {}
+
+  // Marks a pixel whose ray hit nothing
+  static constexpr unsigned no_shape = 0;
+
+  auto width() const -> int { return width_; }
+  auto height() const -> int { return height_; }
+  auto image() -> Canvas & { return image_; }
+  auto image() const -> Canvas const & { return image_; }
+
+  // How the frame was made
+  auto stats() const -> ReprojectionStats { return stats_; }
+  void stats(ReprojectionStats stats) { stats_ = stats; }
+
+  // The world as it was rendered
+  auto snapshot() const -> WorldSnapshot const & { return snapshot_; }
+  void snapshot(WorldSnapshot snapshot) { snapshot_ = std::move(snapshot); }
+
+  auto shape_id(int x, int y) const -> unsigned {
+    return shape_ids_.at(index(x, y));
+  }
+  auto position(int x, int y) const -> Point {
+    return positions_.at(index(x, y));
+  }
+  auto color(int x, int y) const -> Color { return image_.pixel_at(x, y); }
+
+  void record(int x, int y, Color color, unsigned shape_id, Point position) {
+    image_.write_pixel(x, y, color);
+    shape_ids_.at(index(x, y)) = shape_id;
+    positions_.at(index(x, y)) = position;
+  }
+
+private:
+  int width_;
+  int height_;
+  Canvas image_;
+  std::vector<Point> positions_;
+  std::vector<unsigned> shape_ids_;
+  ReprojectionStats stats_;
+  WorldSnapshot snapshot_;
+
+  auto index(int x, int y) const -> size_t {
+    if (x < 0 || y < 0) {
+      throw std::out_of_range("Pixel coordinates must be non-negative");
+    }
+    return x + static_cast<size_t>(y) * width_;
+  }
+};
+
+// Render a frame from scratch, recording its history
+auto render_history(Camera const &camera, World &world, ThreadPool &pool)
+    -> FrameHistory;
+
+// Render a frame by reusing the previous one where possible. Each of the
+// previous frame's hits is projected into the new camera. A pixel reuses
+// the color that lands on it if the nearest hit of its own ray is on the
+// same shape, within tolerance pixel widths of that hit. Every pixel's
+// primary ray is still traced to check that, so only the shading is
+// saved, and the stats count both. Every other pixel is shaded afresh.
+// Only the camera may move between frames; if the world changed since
+// previous was rendered, every pixel is shaded. Shading is view
+// dependent, so reused specular highlights lag a little behind the
+// camera.
+auto render_reprojected(Camera const &camera, World &world,
+                        FrameHistory const &previous, ThreadPool &pool,
+                        float tolerance = 1.0f) -> FrameHistory;
+
+} // namespace raytrace
+#endif
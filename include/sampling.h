@@ -0,0 +1,70 @@
+#ifndef RAYTRACE_SAMPLING_H_GUARD
+#define RAYTRACE_SAMPLING_H_GUARD
+
+#include "primitives.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace raytrace {
+
+// Small, fast PCG32 generator. Cheap enough to create one per shading point,
+// which keeps sampling deterministic no matter which thread shades a pixel.
+class Rng {
+public:
+  explicit Rng(std::uint64_t seed) : state_(0) {
+    next();
+    state_ += seed;
+    next();
+  }
+
+  auto next() -> std::uint32_t {
+    auto old = state_;
+    state_ = old * 6364136223846793005ULL + 1442695040888963407ULL;
+    auto xorshifted = static_cast<std::uint32_t>(((old >> 18u) ^ old) >> 27u);
+    auto rot = static_cast<std::uint32_t>(old >> 59u);
+    return (xorshifted >> rot) | (xorshifted << ((32 - rot) & 31));
+  }
+
+  // Uniform in [0, 1)
+  auto next_float() -> float {
+    return static_cast<float>(next() >> 8) * (1.0f / 16777216.0f);
+  }
+
+private:
+  std::uint64_t state_;
+};
+
+// Seed derived from a point's exact coordinates, so the same point always
+// draws the same samples.
+auto seed_for(Point p) -> std::uint64_t;
+
+// Walker's alias method: after an O(n) build, draws index i with probability
+// weights[i] / sum(weights) in constant time.
+class AliasTable {
+public:
+  AliasTable() = default;
+  explicit AliasTable(std::vector<float> const &weights);
+
+  // Empty if there were no weights or they were all zero
+  auto empty() const -> bool { return thresholds_.empty(); }
+  auto size() const -> std::size_t { return thresholds_.size(); }
+
+  auto probability(std::size_t i) const -> float { return probabilities_[i]; }
+
+  // u1 and u2 are independent uniform numbers in [0, 1)
+  auto sample(float u1, float u2) const -> std::size_t {
+    auto i = std::min(static_cast<std::size_t>(u1 * thresholds_.size()),
+                      thresholds_.size() - 1);
+    return u2 < thresholds_[i] ? i : aliases_[i];
+  }
+
+private:
+  std::vector<float> probabilities_;
+  std::vector<float> thresholds_;
+  std::vector<std::size_t> aliases_;
+};
+
+} // namespace raytrace
+#endif
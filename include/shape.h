@@ -2,11 +2,13 @@
 #define RAYTRACE_SHAPE_H_GUARD
 
 #include <atomic>
+#include <cstddef>
 #include <cstdint>
 #include <optional>
 #include <ostream>
 #include <vector>
 
+#include "bounds.h"
 #include "materials.h"
 #include "matrix.h"
 #include "primitives.h"
@@ -24,6 +26,14 @@ private:
   Matrix4 transform_;
   unsigned id_;
 
+  // Bumped by everything that can edit the material
+  std::uint64_t material_version_{0};
+  // The World that last committed the shape, where it put the material in
+  // its table, and the material's version then
+  unsigned committed_world_{0};
+  std::size_t material_index_{0};
+  std::uint64_t committed_material_version_{0};
+
 public:
   Shape(Material material, Matrix4 transform)
       : material_(material), transform_(transform) {
@@ -37,17 +47,58 @@ public:
   virtual auto local_normal_at(Point p) const -> Vector3 = 0;
   virtual void local_intersect(Ray r, Intersections &xs) = 0;
 
+  // A name for the kind of shape, the same from one build to the next
+  virtual auto kind() const -> char const * { return "shape"; }
+
+  // A box around the shape in object space, or nothing if it's unbounded
+  virtual auto local_bounds() const -> std::optional<Bounds> {
+    return std::nullopt;
+  }
+
   auto transform() -> Matrix4 & { return transform_; }
+  auto transform() const -> Matrix4 const & { return transform_; }
   void transform(Matrix4 transform) { transform_ = transform; }
 
-  auto material() -> Material & { return material_; }
-  void material(Material material) { material_ = material; }
+  auto material() -> Material & {
+    ++material_version_;
+    return material_;
+  }
+  auto material() const -> Material const & { return material_; }
+  void material(Material material) {
+    ++material_version_;
+    material_ = material;
+  }
+
+  // Where the shape's material sits in the material table of the World
+  // that last committed it. Set by World::commit().
+  auto material_index() const -> std::size_t { return material_index_; }
+  void committed(unsigned world_id, std::size_t material_index) {
+    committed_world_ = world_id;
+    material_index_ = material_index;
+    committed_material_version_ = material_version_;
+  }
+
+  // Whether World world_id committed the shape, and the material hasn't
+  // been handed out for editing since
+  auto committed_to(unsigned world_id) const -> bool {
+    return committed_world_ == world_id &&
+           committed_material_version_ == material_version_;
+  }
 
   auto id() const -> unsigned { return id_; }
   auto is(Shape const &s) const -> bool { return s.id() == id_; }
 
   auto normal_at(Point point) const -> Vector3;
 
+  // A box around the shape in world space, as it is now or as it would be
+  // with the given transform
+  auto bounds() const -> std::optional<Bounds> { return bounds(transform_); }
+  auto bounds(Matrix4 const &transform) const -> std::optional<Bounds> {
+    auto local = local_bounds();
+    return local ? std::optional<Bounds>{local->transformed(transform)}
+                 : std::nullopt;
+  }
+
   auto intersect(Ray r, Intersections &xs) -> Intersections;
   auto intersect(Ray ray) -> Intersections;
 
@@ -0,0 +1,105 @@
+#ifndef RAYTRACE_SHARED_FRAMEBUFFER_H_GUARD
+#define RAYTRACE_SHARED_FRAMEBUFFER_H_GUARD
+
+#include "camera.h"
+#include "canvas.h"
+#include "thread_pool.h"
+#include "world.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace raytrace {
+
+// The start of a shared framebuffer segment. Right after it come the tile
+// generation counters, one std::atomic<std::uint32_t> per tile, in rows of
+// tiles_across from the top left; the pixels start pixel_offset bytes in,
+// rows stride bytes apart.
+struct FramebufferHeader {
+  // "RTFRAME1"
+  char magic[8];
+  std::uint32_t width;
+  std::uint32_t height;
+  // A PixelFormat
+  std::uint32_t format;
+  std::uint32_t tile_size;
+  std::uint32_t tiles_across;
+  std::uint32_t tiles_down;
+  std::uint64_t stride;
+  std::uint64_t pixel_offset;
+};
+
+// A canvas in a POSIX shared memory segment, so that other processes on the
+// machine can watch a render as it happens by mapping the same memory, with
+// no copies and no sockets. Each tile has a generation counter that's odd
+// while the tile is being written and even once it's finished, so a viewer
+// can tell which tiles have changed and whether what it read was whole.
+class SharedFramebuffer {
+public:
+  // Create the segment name, which should look like "/name", holding a
+  // width x height canvas in format split into tiles of tile_size. An
+  // existing segment of that name is replaced. The creator removes the
+  // name again when it's destroyed; viewers that have it mapped keep it
+  // until they're done. Throws std::runtime_error if the segment can't be
+  // created.
+  static auto create(std::string const &name, int width, int height,
+                     PixelFormat format = PixelFormat::rgba8,
+                     int tile_size = Camera::default_tile_size)
+      -> SharedFramebuffer;
+
+  // Map the existing segment name read only, as a viewer does; it mustn't
+  // write to the canvas or call begin_write(). Throws std::runtime_error
+  // if it doesn't exist or isn't a framebuffer.
+  static auto open(std::string const &name) -> SharedFramebuffer;
+
+  auto header() const -> FramebufferHeader const & { return *header_; }
+
+  // The shared pixels. Writing to them outside begin_write() and
+  // end_write() leaves viewers none the wiser.
+  auto canvas() -> Canvas & { return canvas_; }
+  auto canvas() const -> Canvas const & { return canvas_; }
+
+  auto tile_count() const -> std::size_t;
+  auto tile(std::size_t index) const -> Tile;
+  // The tile holding pixel x, y
+  auto tile_index(int x, int y) const -> std::size_t;
+
+  // Times tile index has been written, twice over, plus one while it's
+  // being written
+  auto generation(std::size_t index) const -> std::uint32_t;
+
+  // Bracket writing the pixels of tile index. One writer per tile at a
+  // time.
+  void begin_write(std::size_t index);
+  void end_write(std::size_t index);
+
+  // Copy tile index into the same place in image, which should be the
+  // framebuffer's size. Returns false, having copied something torn, if
+  // the tile was being written before or during the copy.
+  auto read_tile(std::size_t index, Canvas &image) const -> bool;
+
+private:
+  SharedFramebuffer(std::shared_ptr<void> mapping,
+                    std::shared_ptr<void> name);
+
+  // Keeps the segment mapped, and for the creator, named
+  std::shared_ptr<void> mapping_;
+  std::shared_ptr<void> name_;
+  FramebufferHeader const *header_;
+  std::atomic<std::uint32_t> *generations_;
+  Canvas canvas_;
+};
+
+// Render world through camera into framebuffer on pool, a task per tile,
+// publishing each tile as it's finished. Throws std::invalid_argument if
+// the camera isn't the framebuffer's size. If a tile fails to render, its
+// write is still closed, and the first exception is rethrown once every
+// tile has been tried.
+void render_shared(Camera const &camera, World &world, ThreadPool &pool,
+                   SharedFramebuffer &framebuffer);
+
+} // namespace raytrace
+#endif
@@ -3,6 +3,7 @@
 
 #include "shape.h"
 
+#include <optional>
 #include <ostream>
 
 namespace raytrace {
@@ -11,8 +12,13 @@ class Sphere : public Shape {
 public:
   using Shape::Shape;
 
+  auto kind() const -> char const * override { return "sphere"; }
+
   auto local_normal_at(Point point) const -> Vector3 override;
   void local_intersect(Ray ray, Intersections &xs) override;
+  auto local_bounds() const -> std::optional<Bounds> override {
+    return Bounds{Point{-1.0f, -1.0f, -1.0f}, Point{1.0f, 1.0f, 1.0f}};
+  }
 
 }; // namespace raytrace
 
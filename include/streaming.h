@@ -0,0 +1,50 @@
+#ifndef RAYTRACE_STREAMING_H_GUARD
+#define RAYTRACE_STREAMING_H_GUARD
+
+#include "camera.h"
+#include "ppm.h"
+#include "thread_pool.h"
+#include "world.h"
+
+#include <ostream>
+
+namespace raytrace {
+
+struct StreamOptions {
+  PpmFormat format{PpmFormat::plain};
+  Quantization quantization;
+  // Rows rendered and written at a time
+  int band_height{16};
+  // Bands in flight between the stages of render_pipelined()
+  int queue_depth{4};
+};
+
+// Render straight to os as PPM, a band of rows at a time, for images too
+// big to hold whole. The next band's rows are queued on pool behind this
+// band's, so it's rendered while this one finishes and is encoded and
+// written. Memory is two bands plus the encoded text of one, however big
+// the image. The output is the same as camera.render(world)
+// followed by to_ppm() or to_ppm_binary().
+void render_to_stream(Camera const &camera, World &world, ThreadPool &pool,
+                      std::ostream &os, StreamOptions const &options = {});
+
+// When render_pipelined() finished each stage, in milliseconds from when
+// it started
+struct PipelineTiming {
+  double rendered;
+  double encoded;
+  double written;
+};
+
+// Like render_to_stream(), but with encoding and writing on threads of
+// their own. Bands go from the pool to an encoder thread to a writer
+// thread through queues queue_depth bands deep, so all three stages run at
+// once and the last byte is written soon after the last pixel is traced.
+// Up to queue_depth bands are rendered at once, so the pool never waits
+// for the end of one band before starting the next.
+auto render_pipelined(Camera const &camera, World &world, ThreadPool &pool,
+                      std::ostream &os, StreamOptions const &options = {})
+    -> PipelineTiming;
+
+} // namespace raytrace
+#endif
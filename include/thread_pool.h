@@ -0,0 +1,99 @@
+#ifndef RAYTRACE_THREAD_POOL_H_GUARD
+#define RAYTRACE_THREAD_POOL_H_GUARD
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace raytrace {
+
+// A fixed set of worker threads running tasks in the order they're
+// submitted
+class ThreadPool {
+public:
+  // 0 uses one thread per hardware thread
+  explicit ThreadPool(unsigned threads = 0);
+  ~ThreadPool();
+
+  ThreadPool(ThreadPool const &) = delete;
+  auto operator=(ThreadPool const &) -> ThreadPool & = delete;
+
+  auto size() const -> std::size_t { return workers_.size(); }
+
+  template <typename F>
+  auto submit(F task) -> std::future<std::invoke_result_t<F>> {
+    using result_type = std::invoke_result_t<F>;
+    auto packaged =
+        std::make_shared<std::packaged_task<result_type()>>(std::move(task));
+    auto result = packaged->get_future();
+    {
+      auto lock = std::lock_guard{mutex_};
+      tasks_.emplace([packaged]() { (*packaged)(); });
+    }
+    ready_.notify_one();
+    return result;
+  }
+
+private:
+  std::vector<std::thread> workers_;
+  std::queue<std::function<void()>> tasks_;
+  std::mutex mutex_;
+  std::condition_variable ready_;
+  bool stopping_{false};
+
+  void work();
+};
+
+// Wait for every task in done to finish, without taking their results or
+// exceptions. Tasks that use the caller's locals have to be finished
+// before an exception unwinds past them.
+template <typename T>
+void settle(std::vector<std::future<T>> &done) {
+  for (auto &d : done) {
+    if (d.valid()) {
+      d.wait();
+    }
+  }
+}
+
+// Wait for every task in done to finish, then rethrow the first exception
+// any of them threw
+inline void wait_all(std::vector<std::future<void>> &done) {
+  settle(done);
+  for (auto &d : done) {
+    if (d.valid()) {
+      d.get();
+    }
+  }
+}
+
+// Split rows [0, height) into bands, run rows(y0, y1) for each on pool and
+// wait for them all. If any band throws, the others still finish before
+// the first exception is rethrown.
+template <typename F>
+void for_each_band(ThreadPool &pool, int height, F rows) {
+  auto bands = static_cast<int>(pool.size()) * 4;
+  auto band_height = std::max(1, (height + bands - 1) / bands);
+  auto done = std::vector<std::future<void>>{};
+  try {
+    for (int y = 0; y < height; y += band_height) {
+      auto y1 = std::min(height, y + band_height);
+      done.push_back(pool.submit([&rows, y, y1]() { rows(y, y1); }));
+    }
+  } catch (...) {
+    wait_all(done);
+    throw;
+  }
+  wait_all(done);
+}
+
+} // namespace raytrace
+#endif
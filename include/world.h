@@ -3,15 +3,21 @@
 
 #include "intersections.h"
 #include "lights.h"
+#include "material_table.h"
+#include "matrix.h"
 #include "primitives.h"
 #include "ray.h"
+#include "sampling.h"
 
 #include "shape.h"
 
 #include <algorithm>
 #include <cstddef>
+#include <cstdint>
 #include <iterator>
 #include <memory>
+#include <optional>
+#include <stdexcept>
 #include <vector>
 
 namespace raytrace {
@@ -49,10 +55,50 @@ private:
   constexpr static float bias = epsilon * 50;
 };
 
+// A shape that's changed since the world was last rendered
+struct ShapeChange {
+  Shape *shape;
+  // Its transform when the world was last rendered; nothing if it's new
+  std::optional<Matrix4> old_transform;
+};
+
+// What a world looked like at one moment, kept with an image of it so
+// that what has changed since that image was rendered can be found later.
+// An empty snapshot, as default constructed, has seen nothing.
+class WorldSnapshot {
+private:
+  friend class World;
+  bool taken_{false};
+  std::vector<Matrix4> transforms_;
+  std::vector<Material> materials_;
+  std::vector<PointLight> lights_;
+  std::vector<AreaLight> area_lights_;
+};
+
 class World {
 private:
-  PointLight light_;
+  std::vector<PointLight> lights_{PointLight{}};
+  std::vector<AreaLight> area_lights_;
   std::vector<std::unique_ptr<Shape>> objects_;
+  int light_samples_{0};
+  AliasTable light_table_;
+  MaterialTable materials_;
+  bool committed_{false};
+  // Tells the shapes this world committed from those of any other
+  unsigned id_;
+
+  // Bumped whenever the point lights are handed out for editing, and
+  // recorded by commit(), to tell whether the light table is up to date
+  std::uint64_t lights_version_{0};
+  std::uint64_t committed_lights_version_{0};
+
+  auto compiled_material(Shape const &shape) const
+      -> CompiledMaterial const *;
+  auto shade_light(PreComps const &comps, Material const &material,
+                   CompiledMaterial const *compiled, std::size_t light) const
+      -> Color;
+  auto shade_area_light(PreComps const &comps, Material const &material,
+                        AreaLight const &light, Rng &rng) const -> Color;
 
 public:
   using shape_container = decltype(objects_);
@@ -62,7 +108,7 @@ public:
   using reference = value_type &;
   using size_type = shape_container::size_type;
 
-  World() = default;
+  World();
   World(World &&other) = default;
 
   class ShapeIterator {
@@ -145,6 +191,9 @@ public:
 
   auto size() const -> size_type { return objects_.size(); }
 
+  // Unique to this world among those created by the program
+  auto id() const -> unsigned { return id_; }
+
   auto empty() const -> bool { return objects_.empty(); }
 
   auto begin() -> ShapeIterator { return ShapeIterator(objects_.begin()); }
@@ -153,12 +202,70 @@ public:
 
   auto operator[](size_type i) -> reference { return *objects_[i]; }
 
-  auto light() -> PointLight & { return light_; }
+  // The first light, for scenes with just one. Setting it replaces every
+  // light in the world.
+  auto light() -> PointLight & {
+    ++lights_version_;
+    return lights_.at(0);
+  }
   auto light(PointLight light) -> World & {
-    light_ = light;
+    ++lights_version_;
+    lights_ = {light};
+    return *this;
+  }
+
+  auto lights() const -> std::vector<PointLight> const & { return lights_; }
+  auto lights() -> std::vector<PointLight> & {
+    ++lights_version_;
+    return lights_;
+  }
+  auto lights(std::vector<PointLight> lights) -> World & {
+    ++lights_version_;
+    lights_ = std::move(lights);
     return *this;
   }
 
+  // Area lights are shaded in addition to the point lights, and always all
+  // of them: light_samples() only applies to point lights.
+  auto area_lights() -> std::vector<AreaLight> & { return area_lights_; }
+  auto area_lights(std::vector<AreaLight> lights) -> World & {
+    area_lights_ = std::move(lights);
+    return *this;
+  }
+
+  // Number of lights sampled per shading point, picked in proportion to
+  // their intensity. 0, the default, shades with every light.
+  auto light_samples() const -> int { return light_samples_; }
+  auto light_samples(int samples) -> World & {
+    if (samples < 0) {
+      throw std::out_of_range("Light samples must be non-negative");
+    }
+    light_samples_ = samples;
+    return *this;
+  }
+
+  // Rebuild the data derived from the lights and materials: the light
+  // sampling table and the compiled material table. Camera::render calls
+  // this. Outside of a render, call it again after editing lights or
+  // materials. Until then, lights edited since, through light() or
+  // lights(), are all shaded rather than sampled, and shapes whose
+  // material or lights were edited are shaded from scratch. Edits through
+  // a reference taken before the commit aren't noticed.
+  void commit();
+
+  auto materials() const -> MaterialTable const & { return materials_; }
+
+  // The world as it is now, to compare against later
+  auto snapshot() const -> WorldSnapshot;
+
+  // Whether any light differs from when since was taken. True if since is
+  // empty. Values are compared bit for bit, so no change is too small.
+  auto lights_changed(WorldSnapshot const &since) const -> bool;
+
+  // Shapes added, moved or given a new material since since was taken,
+  // compared bit for bit
+  auto changed_shapes(WorldSnapshot const &since) -> std::vector<ShapeChange>;
+
   auto intersect(Ray r) const -> Intersections;
 
   auto shade_hit(PreComps comps) const -> Color;
@@ -166,6 +273,7 @@ public:
   auto color_at(Ray r) const -> Color;
 
   auto is_shadowed(Point p) const -> bool;
+  auto is_shadowed(Point p, PointLight const &light) const -> bool;
 };
 
 inline auto operator-(World::ShapeIterator iter,
@@ -0,0 +1,48 @@
+#ifndef RAYTRACE_Y4M_H_GUARD
+#define RAYTRACE_Y4M_H_GUARD
+
+#include "quantize.h"
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace raytrace {
+
+class Canvas;
+
+struct Y4mOptions {
+  // Frames per second
+  int fps{24};
+  Quantization quantization;
+};
+
+// Writes frames to an ostream as a YUV4MPEG2 stream, which video encoders
+// read straight from a pipe. Each frame is quantized to 8 bit RGB and
+// converted to BT.601 limited range YUV with 4:2:0 chroma, each chroma
+// sample the average of a 2x2 block of pixels.
+class Y4mWriter {
+public:
+  // Start a stream of width x height frames on os by writing its header.
+  // Throws std::out_of_range if either size isn't positive.
+  Y4mWriter(std::ostream &os, int width, int height,
+            Y4mOptions const &options = {});
+
+  // Convert frame and write it. Throws std::invalid_argument if it isn't
+  // the stream's size.
+  void write_frame(Canvas const &frame);
+
+  auto frames() const -> int { return frames_; }
+
+private:
+  std::ostream &os_;
+  int width_;
+  int height_;
+  Quantization quantization_;
+  int frames_{0};
+  std::string frame_;
+  std::vector<unsigned char> rows_[2];
+};
+
+} // namespace raytrace
+#endif
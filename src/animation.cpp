@@ -0,0 +1,156 @@
+#include "animation.h"
+
+#include "transformations.h"
+
+#include <algorithm>
+#include <deque>
+#include <future>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+namespace raytrace {
+
+namespace {
+auto lerp(float a, float b, float t) -> float { return a + (b - a) * t; }
+
+auto lerp(Point a, Point b, float t) -> Point { return a + (b - a) * t; }
+
+auto lerp(Vector3 a, Vector3 b, float t) -> Vector3 { return a + (b - a) * t; }
+} // namespace
+
+auto CameraPath::add(CameraKey key) -> CameraPath & {
+  auto i = std::upper_bound(
+      keys_.begin(), keys_.end(), key,
+      [](CameraKey const &a, CameraKey const &b) { return a.time < b.time; });
+  keys_.insert(i, key);
+  return *this;
+}
+
+auto CameraPath::start_time() const -> float {
+  if (keys_.empty()) {
+    throw std::out_of_range("Camera path has no keys");
+  }
+  return keys_.front().time;
+}
+
+auto CameraPath::end_time() const -> float {
+  if (keys_.empty()) {
+    throw std::out_of_range("Camera path has no keys");
+  }
+  return keys_.back().time;
+}
+
+auto CameraPath::at(float time) const -> CameraKey {
+  if (keys_.empty()) {
+    throw std::out_of_range("Camera path has no keys");
+  }
+  if (time <= keys_.front().time) {
+    return keys_.front();
+  }
+  if (time >= keys_.back().time) {
+    return keys_.back();
+  }
+
+  auto next = std::upper_bound(
+      keys_.begin(), keys_.end(), time,
+      [](float t, CameraKey const &key) { return t < key.time; });
+  auto const &a = *(next - 1);
+  auto const &b = *next;
+  auto t = (time - a.time) / (b.time - a.time);
+  return CameraKey{time, lerp(a.from, b.from, t), lerp(a.to, b.to, t),
+                   lerp(a.up, b.up, t), lerp(a.fov, b.fov, t)};
+}
+
+auto CameraPath::camera(int frame, int frames, int h_size, int v_size) const
+    -> Camera {
+  auto t = frames > 1 ? static_cast<float>(frame) / (frames - 1) : 0.0f;
+  auto key = at(lerp(start_time(), end_time(), t));
+  return Camera{h_size, v_size, key.fov,
+                view_transform(key.from, key.to, key.up)};
+}
+
+auto read_camera_path(std::istream &is) -> CameraPath {
+  auto path = CameraPath{};
+  auto line = std::string{};
+  while (std::getline(is, line)) {
+    auto first = line.find_first_not_of(" \t\r");
+    if (first == std::string::npos || line[first] == '#') {
+      continue;
+    }
+    auto fields = std::istringstream{line};
+    auto key = CameraKey{};
+    fields >> key.time >> key.from.x >> key.from.y >> key.from.z >>
+        key.to.x >> key.to.y >> key.to.z >> key.up.x >> key.up.y >>
+        key.up.z >> key.fov;
+    if (!fields) {
+      throw std::invalid_argument("Bad camera path line: " + line);
+    }
+    path.add(key);
+  }
+  return path;
+}
+
+void render_sequence(World &world, CameraPath const &path, int frames,
+                     int h_size, int v_size, ThreadPool &pool,
+                     std::function<void(int frame, Canvas &image)> on_frame) {
+  world.commit();
+  World const &prepared = world;
+
+  // Keep a few frames per thread in flight, so threads stay busy without
+  // holding every frame in memory at once
+  auto const max_in_flight = pool.size() * 2;
+  auto in_flight = std::deque<std::future<Canvas>>{};
+  auto next_to_deliver = 0;
+
+  auto deliver_oldest = [&]() {
+    auto image = in_flight.front().get();
+    in_flight.pop_front();
+    on_frame(next_to_deliver++, image);
+  };
+
+  try {
+    for (int frame = 0; frame < frames; ++frame) {
+      auto camera = path.camera(frame, frames, h_size, v_size);
+      in_flight.push_back(pool.submit([camera, &prepared]() {
+        auto image = Canvas{camera.h_size(), camera.v_size()};
+        camera.render_tile(prepared, image,
+                           Tile{0, 0, camera.h_size(), camera.v_size()});
+        return image;
+      }));
+      if (in_flight.size() >= max_in_flight) {
+        deliver_oldest();
+      }
+    }
+    while (!in_flight.empty()) {
+      deliver_oldest();
+    }
+  } catch (...) {
+    // The frames still in flight use the world, so they have to finish
+    // before the caller can be allowed to change or destroy it
+    for (auto &f : in_flight) {
+      if (f.valid()) {
+        f.wait();
+      }
+    }
+    throw;
+  }
+}
+
+void render_sequence_reprojected(
+    World &world, CameraPath const &path, int frames, int h_size, int v_size,
+    ThreadPool &pool, float tolerance,
+    std::function<void(int frame, Canvas &image, ReprojectionStats stats)>
+        on_frame) {
+  auto history = std::optional<FrameHistory>{};
+  for (int frame = 0; frame < frames; ++frame) {
+    auto camera = path.camera(frame, frames, h_size, v_size);
+    history = history ? render_reprojected(camera, world, *history, pool,
+                                           tolerance)
+                      : render_history(camera, world, pool);
+    on_frame(frame, history->image(), history->stats());
+  }
+}
+
+} // namespace raytrace
@@ -1,8 +1,13 @@
 #include "camera.h"
 
+#include "bounds.h"
 #include "canvas.h"
 #include "primitives.h"
 
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
 namespace raytrace {
 
 void Camera::compute_pixel_size() {
@@ -34,17 +39,208 @@ auto Camera::ray_for_pixel(int x, int y) const -> Ray {
   return Ray{origin, direction};
 }
 
-auto Camera::render(World &world) const -> Canvas {
-  auto image = Canvas{h_size_, v_size_};
+auto Camera::project(Point p) const -> std::optional<ScreenPoint> {
+  // The inverse of ray_for_pixel: into camera space, onto the z = -1
+  // plane, then from there into pixels
+  auto q = transform_ * p;
+  if (q.z >= -epsilon) {
+    return std::nullopt;
+  }
+  auto world_x = q.x / -q.z;
+  auto world_y = q.y / -q.z;
+  return ScreenPoint{(half_width_ - world_x) / pixel_size_,
+                     (half_height_ - world_y) / pixel_size_, -q.z};
+}
 
-  for (int y = 0; y < v_size_; ++y) {
-    for (int x = 0; x < h_size_; ++x) {
+auto Camera::tiles(int tile_size) const -> std::vector<Tile> {
+  if (tile_size <= 0) {
+    throw std::invalid_argument("Tile size must be greater than zero");
+  }
+  auto tiles = std::vector<Tile>{};
+  for (int y = 0; y < v_size_; y += tile_size) {
+    for (int x = 0; x < h_size_; x += tile_size) {
+      tiles.push_back(Tile{x, y, std::min(tile_size, h_size_ - x),
+                           std::min(tile_size, v_size_ - y)});
+    }
+  }
+  return tiles;
+}
+
+void Camera::render_tile(World const &world, Canvas &image, Tile tile,
+                         int origin_x, int origin_y) const {
+  for (int y = tile.y; y < tile.y + tile.height; ++y) {
+    for (int x = tile.x; x < tile.x + tile.width; ++x) {
       auto ray = ray_for_pixel(x, y);
-      image.write_pixel(x, y, world.color_at(ray));
+      image.write_pixel(x - origin_x, y - origin_y, world.color_at(ray));
     }
   }
+}
+
+auto Camera::render(World &world) const -> Canvas {
+  auto image = Canvas{h_size_, v_size_};
+  render_into(world, image);
+  return image;
+}
+
+void Camera::render_into(World &world, Canvas &image) const {
+  if (image.width() != h_size_ || image.height() != v_size_) {
+    throw std::invalid_argument("Image and camera sizes differ");
+  }
+  world.commit();
+
+  render_tile(world, image, Tile{0, 0, h_size_, v_size_});
+}
 
+void Camera::render_into(World &world, unsigned char *data, int width,
+                         int height, std::ptrdiff_t stride,
+                         PixelFormat format) const {
+  auto image = Canvas{width, height, format, data, stride, nullptr};
+  render_into(world, image);
+}
+
+auto Camera::render(World &world, Tile crop) const -> Canvas {
+  if (crop.x < 0 || crop.y < 0 || crop.width <= 0 || crop.height <= 0 ||
+      crop.x + crop.width > h_size_ || crop.y + crop.height > v_size_) {
+    throw std::out_of_range("Crop window must lie within the image");
+  }
+  auto image = Canvas{crop.width, crop.height};
+  world.commit();
+
+  render_tile(world, image, crop, crop.x, crop.y);
   return image;
 }
 
+auto Camera::changed_region(World &world, ShapeChange const &change) const
+    -> std::optional<Tile> {
+  auto &shape = *change.shape;
+
+  // Where the shape is now and where it was; both need redrawing
+  auto boxes = std::vector<Bounds>{};
+  for (auto const &transform : {std::optional<Matrix4>{shape.transform()},
+                                change.old_transform}) {
+    if (!transform) {
+      continue;
+    }
+    auto box = shape.bounds(*transform);
+    if (!box) {
+      return std::nullopt;
+    }
+    boxes.push_back(*box);
+  }
+
+  auto min_x = std::numeric_limits<float>::max();
+  auto min_y = std::numeric_limits<float>::max();
+  auto max_x = std::numeric_limits<float>::lowest();
+  auto max_y = std::numeric_limits<float>::lowest();
+  auto include = [&](float x, float y) {
+    min_x = std::min(min_x, x);
+    min_y = std::min(min_y, y);
+    max_x = std::max(max_x, x);
+    max_y = std::max(max_y, y);
+  };
+
+  for (auto const &box : boxes) {
+    for (auto const &corner : box.corners()) {
+      auto p = project(corner);
+      if (!p) {
+        return std::nullopt;
+      }
+      include(p->x, p->y);
+    }
+  }
+
+  // A material change doesn't move any shadows
+  auto moved =
+      !change.old_transform || *change.old_transform != shape.transform();
+  if (moved) {
+    auto light_points = std::vector<Point>{};
+    for (auto const &light : world.lights()) {
+      light_points.push_back(light.position);
+    }
+    for (auto const &light : world.area_lights()) {
+      auto extent = light.extent();
+      light_points.insert(light_points.end(), extent.begin(), extent.end());
+    }
+
+    // The shadow is inside the box swept away from each light point to
+    // infinity. On screen, each swept corner runs toward the vanishing
+    // point of its direction, which only exists if it heads away from the
+    // camera.
+    for (auto const &box : boxes) {
+      for (auto const &corner : box.corners()) {
+        for (auto const &light_point : light_points) {
+          auto away = corner - light_point;
+          if (away.magnitude() < epsilon) {
+            return std::nullopt;
+          }
+          auto d = transform_ * away;
+          if (d.z >= -epsilon) {
+            return std::nullopt;
+          }
+          include((half_width_ - d.x / -d.z) / pixel_size_,
+                  (half_height_ - d.y / -d.z) / pixel_size_);
+        }
+      }
+    }
+  }
+
+  // Round outward with a pixel to spare, and clip to the image
+  auto clip = [](float v, int size) {
+    return std::clamp(v, -1.0f, size + 1.0f);
+  };
+  auto x0 = static_cast<int>(std::floor(clip(min_x, h_size_))) - 1;
+  auto y0 = static_cast<int>(std::floor(clip(min_y, v_size_))) - 1;
+  auto x1 = static_cast<int>(std::ceil(clip(max_x, h_size_))) + 1;
+  auto y1 = static_cast<int>(std::ceil(clip(max_y, v_size_))) + 1;
+  x0 = std::max(x0, 0);
+  y0 = std::max(y0, 0);
+  x1 = std::min(x1, h_size_);
+  y1 = std::min(y1, v_size_);
+  if (x1 <= x0 || y1 <= y0) {
+    return Tile{0, 0, 0, 0};
+  }
+  return Tile{x0, y0, x1 - x0, y1 - y0};
+}
+
+auto Camera::render_changes(World &world, Canvas &image,
+                            WorldSnapshot &since, int tile_size) const
+    -> std::size_t {
+  auto all_tiles = tiles(tile_size);
+  auto dirty = std::vector<bool>(all_tiles.size(), false);
+
+  auto everything = image.width() != h_size_ || image.height() != v_size_ ||
+                    world.lights_changed(since);
+  if (!everything) {
+    for (auto const &change : world.changed_shapes(since)) {
+      auto region = changed_region(world, change);
+      if (!region) {
+        everything = true;
+        break;
+      }
+      for (std::size_t i = 0; i < all_tiles.size(); ++i) {
+        auto const &t = all_tiles[i];
+        if (t.x < region->x + region->width && region->x < t.x + t.width &&
+            t.y < region->y + region->height && region->y < t.y + t.height) {
+          dirty[i] = true;
+        }
+      }
+    }
+  }
+
+  if (everything && (image.width() != h_size_ || image.height() != v_size_)) {
+    image = Canvas{h_size_, v_size_};
+  }
+
+  world.commit();
+  auto rendered = std::size_t{0};
+  for (std::size_t i = 0; i < all_tiles.size(); ++i) {
+    if (everything || dirty[i]) {
+      render_tile(world, image, all_tiles[i]);
+      ++rendered;
+    }
+  }
+  since = world.snapshot();
+  return rendered;
+}
+
 } // namespace raytrace
@@ -1,51 +1,104 @@
 #include "canvas.h"
 
-#include <algorithm>
-#include <array>
-#include <sstream>
+#include "ppm.h"
+
+#include <cstring>
 #include <string>
 
 namespace raytrace {
 
-auto Canvas::to_ppm() -> std::string {
-  constexpr auto max_ppm_line_len = 70;
-  auto ppm = std::ostringstream{};
+Canvas::Canvas(int width, int height, PixelFormat format)
+    : m_width(width), m_height(height), m_format(format) {
+  if (width <= 0 || height <= 0) {
+    throw std::out_of_range("height and width must be greater than zero");
+  }
+  m_stride = static_cast<std::ptrdiff_t>(width * pixel_size(format));
+  m_pixels = std::vector<unsigned char>(static_cast<size_t>(m_stride) *
+                                        static_cast<size_t>(height));
+  m_data = m_pixels.data();
+  if (format == PixelFormat::rgba8) {
+    for (auto i = std::size_t{3}; i < m_pixels.size(); i += 4) {
+      m_pixels[i] = 255;
+    }
+  }
+}
 
-  // Add PPM header
-  ppm << "P3\n"
-      << m_width << " " << m_height << "\n"
-      << "255\n";
+Canvas::Canvas(int width, int height, PixelFormat format, unsigned char *data,
+               std::ptrdiff_t stride, std::shared_ptr<void> owner)
+    : m_width(width), m_height(height), m_format(format), m_stride(stride),
+      m_data(data), m_owner(std::move(owner)) {
+  if (width <= 0 || height <= 0) {
+    throw std::out_of_range("height and width must be greater than zero");
+  }
+  auto row_size = static_cast<std::ptrdiff_t>(width * pixel_size(format));
+  if (data == nullptr || (stride < row_size && -stride < row_size)) {
+    throw std::invalid_argument("rows must not overlap");
+  }
+}
 
-  auto line = std::string{};
+Canvas::Canvas(Canvas const &other)
+    : Canvas(other.m_width, other.m_height, other.m_format) {
+  auto row_size = static_cast<std::size_t>(m_stride);
   for (int y = 0; y < m_height; ++y) {
-    for (int x = 0; x < m_width; ++x) {
-      auto c = pixel_at(x, y);
-      std::array<int, 3> color_values{static_cast<int>(std::ceil(c.r * 255)),
-                                      static_cast<int>(std::ceil(c.g * 255)),
-                                      static_cast<int>(std::ceil(c.b * 255))};
-
-      for (int i = 0; i < 3; ++i) {
-        auto s = std::to_string(
-            std::clamp(color_values[static_cast<size_t>(i)], 0, 255));
-
-        // PPM lines should be <= 70 chars
-        if (line.size() + s.size() + 1 > max_ppm_line_len) {
-          ppm << line << "\n";
-          line.clear();
-        }
-        if (line.size() > 0) {
-          line.append(" ");
+    std::memcpy(row(y), other.row(y), row_size);
+  }
+}
+
+auto Canvas::operator=(Canvas const &other) -> Canvas & {
+  if (this != &other) {
+    *this = Canvas{other};
+  }
+  return *this;
+}
+
+auto Canvas::converted(PixelFormat format) const -> Canvas {
+  auto result = Canvas{m_width, m_height, format};
+  convert(*this, result);
+  return result;
+}
+
+void convert(Canvas const &from, Canvas &to) {
+  if (from.m_width != to.m_width || from.m_height != to.m_height) {
+    throw std::invalid_argument("Can't convert between canvas sizes");
+  }
+  auto width = static_cast<std::size_t>(from.m_width);
+  auto from_size = pixel_size(from.m_format);
+  auto to_size = pixel_size(to.m_format);
+
+  for (int y = 0; y < from.m_height; ++y) {
+    auto const *source = from.row(y);
+    auto *target = to.row(y);
+    if (from.m_format == to.m_format) {
+      std::memcpy(target, source, width * from_size);
+    } else if ((from.m_format == PixelFormat::rgb8 ||
+                from.m_format == PixelFormat::rgba8) &&
+               (to.m_format == PixelFormat::rgb8 ||
+                to.m_format == PixelFormat::rgba8)) {
+      // Already quantized, so just shuffle the bytes
+      for (std::size_t x = 0; x < width; ++x) {
+        std::memcpy(target + x * to_size, source + x * from_size, 3);
+        if (to_size == 4) {
+          target[x * 4 + 3] = 255;
         }
-        line.append(s);
       }
-    }
-    if (line.size() > 0) {
-      ppm << line << "\n";
-      line.clear();
+    } else {
+      for (std::size_t x = 0; x < width; ++x) {
+        to.write(target + x * to_size, from.read(source + x * from_size));
+      }
     }
   }
+}
+
+auto Canvas::to_ppm() const -> std::string {
+  auto ppm = ppm_header(PpmFormat::plain, m_width, m_height);
+  append_ppm_rows(ppm, PpmFormat::plain, *this, 0, m_height);
+  return ppm;
+}
 
-  return ppm.str();
+auto Canvas::to_ppm_binary() const -> std::string {
+  auto ppm = ppm_header(PpmFormat::raw, m_width, m_height);
+  append_ppm_rows(ppm, PpmFormat::raw, *this, 0, m_height);
+  return ppm;
 }
 
 } // namespace raytrace
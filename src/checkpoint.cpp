@@ -0,0 +1,317 @@
+#include "checkpoint.h"
+
+#include "bits.h"
+#include "lights.h"
+#include "materials.h"
+#include "matrix.h"
+#include "shape.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace raytrace {
+
+namespace {
+// 64 bit FNV-1a
+class Hasher {
+public:
+  auto add(void const *data, std::size_t size) -> Hasher & {
+    auto const *bytes = static_cast<unsigned char const *>(data);
+    for (std::size_t i = 0; i < size; ++i) {
+      hash_ = (hash_ ^ bytes[i]) * 0x100000001b3ULL;
+    }
+    return *this;
+  }
+
+  auto add(float f) -> Hasher & { return add(&f, sizeof f); }
+  auto add(int i) -> Hasher & { return add(&i, sizeof i); }
+  auto add(std::string const &s) -> Hasher & { return add(s.data(), s.size()); }
+  auto add(Color c) -> Hasher & { return add(c.r).add(c.g).add(c.b); }
+  auto add(Point p) -> Hasher & { return add(p.x).add(p.y).add(p.z); }
+
+  auto add(Matrix4 const &m) -> Hasher & {
+    for (int r = 0; r < 4; ++r) {
+      for (int c = 0; c < 4; ++c) {
+        add(m(r, c));
+      }
+    }
+    return *this;
+  }
+
+  auto add(Material const &m) -> Hasher & {
+    return add(m.color())
+        .add(m.ambient())
+        .add(m.diffuse())
+        .add(m.specular())
+        .add(m.shininess());
+  }
+
+  auto value() const -> std::uint64_t { return hash_; }
+
+private:
+  std::uint64_t hash_{0xcbf29ce484222325ULL};
+};
+
+// The manifest at the start of a checkpoint file. Floats are written as
+// their bits so a resumed render only matches exactly the same camera.
+auto manifest(std::uint64_t hash, Camera const &camera, int tile_size)
+    -> std::string {
+  auto os = std::ostringstream{};
+  os << "RTCHECKPOINT1\n"
+     << "scene " << std::hex << std::setw(16) << std::setfill('0') << hash
+     << std::dec << "\n"
+     << "camera " << camera.h_size() << " " << camera.v_size() << " "
+     << bits_of(camera.fov());
+  auto transform = camera.transform();
+  for (int r = 0; r < 4; ++r) {
+    for (int c = 0; c < 4; ++c) {
+      os << " " << bits_of(transform(r, c));
+    }
+  }
+  os << "\ntile_size " << tile_size << "\n";
+  return os.str();
+}
+
+struct FinishedTile {
+  Tile tile;
+  std::vector<Color> pixels;
+};
+
+auto copy_tile(Canvas const &image, Tile tile) -> FinishedTile {
+  auto t = FinishedTile{tile, {}};
+  t.pixels.reserve(static_cast<std::size_t>(tile.width) * tile.height);
+  for (int y = tile.y; y < tile.y + tile.height; ++y) {
+    for (int x = tile.x; x < tile.x + tile.width; ++x) {
+      t.pixels.push_back(image.pixel_at(x, y));
+    }
+  }
+  return t;
+}
+
+void write_tile(std::ostream &os, FinishedTile const &t) {
+  os << "tile " << t.tile.x << " " << t.tile.y << " " << t.tile.width << " "
+     << t.tile.height << "\n";
+  os.write(reinterpret_cast<char const *>(t.pixels.data()),
+           static_cast<std::streamsize>(t.pixels.size() * sizeof(Color)));
+}
+
+// Read the tiles saved after the manifest into image, stopping at the
+// first one that's incomplete, whose offset is left in end. Returns which
+// of tiles were found.
+auto read_tiles(std::istream &is, Canvas &image,
+                std::vector<Tile> const &tiles, std::streamoff &end)
+    -> std::vector<bool> {
+  auto found = std::vector<bool>(tiles.size(), false);
+  end = is.tellg();
+  auto word = std::string{};
+  auto tile = Tile{};
+  while (is >> word >> tile.x >> tile.y >> tile.width >> tile.height &&
+         word == "tile" && is.get() == '\n') {
+    auto known = std::find(tiles.begin(), tiles.end(), tile);
+    if (known == tiles.end()) {
+      break;
+    }
+    auto pixels =
+        std::vector<Color>(static_cast<std::size_t>(tile.width) * tile.height);
+    is.read(reinterpret_cast<char *>(pixels.data()),
+            static_cast<std::streamsize>(pixels.size() * sizeof(Color)));
+    if (!is) {
+      break;
+    }
+    auto p = pixels.begin();
+    for (int y = tile.y; y < tile.y + tile.height; ++y) {
+      for (int x = tile.x; x < tile.x + tile.width; ++x) {
+        image.write_pixel(x, y, *p++);
+      }
+    }
+    found[static_cast<std::size_t>(known - tiles.begin())] = true;
+    end = is.tellg();
+  }
+  return found;
+}
+
+// Appends finished tiles to the checkpoint on its own thread, every
+// interval and once more when it's finished. Once a write fails nothing
+// more is written.
+class CheckpointWriter {
+public:
+  CheckpointWriter(std::ofstream os, std::chrono::milliseconds interval)
+      : os_(std::move(os)), interval_(interval),
+        thread_([this]() { run(); }) {}
+
+  ~CheckpointWriter() {
+    if (thread_.joinable()) {
+      finish();
+    }
+  }
+
+  void push(FinishedTile tile) {
+    auto lock = std::lock_guard{mutex_};
+    pending_.push_back(std::move(tile));
+  }
+
+  auto failed() const -> bool { return failed_; }
+
+  // Write out the last tiles and stop. Returns whether every tile pushed
+  // made it to the file.
+  auto finish() -> bool {
+    {
+      auto lock = std::lock_guard{mutex_};
+      stopping_ = true;
+    }
+    wake_.notify_one();
+    thread_.join();
+    return !failed_;
+  }
+
+private:
+  std::ofstream os_;
+  std::chrono::milliseconds interval_;
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::vector<FinishedTile> pending_;
+  bool stopping_{false};
+  std::atomic<bool> failed_{false};
+  std::thread thread_;
+
+  void run() {
+    auto batch = std::vector<FinishedTile>{};
+    for (auto last = false; !last;) {
+      {
+        auto lock = std::unique_lock{mutex_};
+        wake_.wait_for(lock, interval_, [this]() { return stopping_; });
+        last = stopping_;
+        batch.swap(pending_);
+      }
+      for (auto const &tile : batch) {
+        if (!os_) {
+          break;
+        }
+        write_tile(os_, tile);
+      }
+      os_.flush();
+      failed_ = failed_ || !os_;
+      batch.clear();
+    }
+  }
+};
+} // namespace
+
+auto scene_hash(World &world) -> std::uint64_t {
+  auto h = Hasher{};
+  h.add(static_cast<int>(world.size()));
+  // Read only, so that hashing doesn't count as editing the materials
+  for (Shape const &shape : world) {
+    h.add(std::string{shape.kind()})
+        .add(shape.transform())
+        .add(shape.material());
+  }
+  h.add(static_cast<int>(world.lights().size()));
+  for (auto const &light : world.lights()) {
+    h.add(light.position).add(light.intensity).add(light.range);
+  }
+  h.add(static_cast<int>(world.area_lights().size()));
+  for (auto const &light : world.area_lights()) {
+    h.add(static_cast<int>(light.kind()))
+        .add(light.intensity())
+        .add(light.samples())
+        .add(light.adaptive_samples())
+        .add(light.jitter() ? 1 : 0);
+    for (auto p : light.extent()) {
+      h.add(p);
+    }
+  }
+  h.add(world.light_samples());
+  return h.value();
+}
+
+auto render_checkpointed(Camera const &camera, World &world, ThreadPool &pool,
+                         CheckpointOptions const &options)
+    -> CheckpointedRender {
+  if (options.path.empty()) {
+    throw std::invalid_argument("Checkpoint needs a file to write to");
+  }
+  auto tiles = camera.tiles(options.tile_size);
+  auto image = Canvas{camera.h_size(), camera.v_size()};
+  auto header = manifest(scene_hash(world), camera, options.tile_size);
+
+  auto found = std::vector<bool>(tiles.size(), false);
+  auto end = std::streamoff{0};
+  {
+    auto is = std::ifstream{options.path, std::ios::binary};
+    auto existing = std::string(header.size(), '\0');
+    if (is &&
+        is.read(existing.data(),
+                static_cast<std::streamsize>(existing.size())) &&
+        existing == header) {
+      found = read_tiles(is, image, tiles, end);
+    }
+  }
+
+  // Carry on from the last whole tile, or start the file afresh
+  auto os = std::ofstream{};
+  if (end > 0) {
+    std::filesystem::resize_file(options.path,
+                                 static_cast<std::uintmax_t>(end));
+    os.open(options.path, std::ios::binary | std::ios::app);
+  } else {
+    os.open(options.path, std::ios::binary | std::ios::trunc);
+    os << header << std::flush;
+  }
+  if (!os) {
+    throw std::runtime_error("Can't write checkpoint " + options.path);
+  }
+  auto resumed =
+      static_cast<std::size_t>(std::count(found.begin(), found.end(), true));
+
+  world.commit();
+  World const &prepared = world;
+  {
+    auto writer = CheckpointWriter{std::move(os), options.interval};
+    auto tile_failed = std::atomic<bool>{false};
+    auto done = std::vector<std::future<void>>{};
+    try {
+      for (std::size_t i = 0; i < tiles.size(); ++i) {
+        if (found[i]) {
+          continue;
+        }
+        done.push_back(pool.submit([&, tile = tiles[i]]() {
+          // No point rendering tiles that can't be saved or used
+          if (writer.failed() || tile_failed) {
+            return;
+          }
+          try {
+            camera.render_tile(prepared, image, tile);
+          } catch (...) {
+            tile_failed = true;
+            throw;
+          }
+          writer.push(copy_tile(image, tile));
+        }));
+      }
+    } catch (...) {
+      wait_all(done);
+      throw;
+    }
+    // Every task is finished before the writer and image go, and the
+    // writer still saves the tiles that were finished
+    wait_all(done);
+    if (!writer.finish()) {
+      throw std::runtime_error("Can't write checkpoint " + options.path);
+    }
+  }
+  return CheckpointedRender{std::move(image), resumed, tiles.size() - resumed};
+}
+
+} // namespace raytrace
@@ -0,0 +1,503 @@
+#include "deflate.h"
+
+#include "big_endian.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <array>
+#include <functional>
+#include <future>
+#include <queue>
+#include <utility>
+#include <vector>
+
+namespace raytrace {
+
+namespace {
+constexpr auto window_size = std::size_t{32768};
+constexpr auto min_match = std::size_t{3};
+constexpr auto max_match = std::size_t{258};
+// Earlier positions with the same hash tried for each match; more finds
+// longer matches, more slowly
+constexpr auto max_chain = 32;
+constexpr auto hash_bits = 15;
+// Bytes compressed by each task
+constexpr auto block_size = std::size_t{1} << 18;
+// Symbols in each deflate block, which gets Huffman codes of its own
+constexpr auto symbols_per_block = std::size_t{1} << 15;
+
+constexpr auto literal_codes = std::size_t{286};
+constexpr auto distance_codes = std::size_t{30};
+constexpr auto end_of_block = 256;
+
+constexpr auto make_crc_table() -> std::array<std::uint32_t, 256> {
+  auto table = std::array<std::uint32_t, 256>{};
+  for (std::uint32_t n = 0; n < 256; ++n) {
+    auto c = n;
+    for (int k = 0; k < 8; ++k) {
+      c = (c & 1) != 0 ? 0xedb88320U ^ (c >> 1) : c >> 1;
+    }
+    table[n] = c;
+  }
+  return table;
+}
+
+constexpr auto crc_table = make_crc_table();
+
+// The smallest length or distance each code stands for, and how many extra
+// bits follow it to give the rest
+constexpr std::uint16_t length_base[29] = {
+    3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+    31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+constexpr std::uint8_t length_extra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1,
+                                           1, 1, 2, 2, 2, 2, 3, 3, 3, 3,
+                                           4, 4, 4, 4, 5, 5, 5, 5, 0};
+constexpr std::uint16_t distance_base[30] = {
+    1,    2,    3,    4,    5,    7,     9,     13,    17,  25,
+    33,   49,   65,   97,   129,  193,   257,   385,   513, 769,
+    1025, 1537, 2049, 3073, 4097, 6145,  8193,  12289, 16385, 24577};
+constexpr std::uint8_t distance_extra[30] = {0, 0, 0,  0,  1,  1,  2,  2,
+                                             3, 3, 4,  4,  5,  5,  6,  6,
+                                             7, 7, 8,  8,  9,  9,  10, 10,
+                                             11, 11, 12, 12, 13, 13};
+
+// The order the code length code's own lengths are written in
+constexpr std::uint8_t code_length_order[19] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+template <typename T, std::size_t N>
+auto code_for(T const (&base)[N], std::size_t value) -> std::size_t {
+  return static_cast<std::size_t>(
+      std::upper_bound(std::begin(base), std::end(base), value) -
+      std::begin(base) - 1);
+}
+
+// A literal byte, or a match of length bytes distance back
+struct Symbol {
+  std::uint16_t length;
+  std::uint16_t distance;
+};
+
+struct Code {
+  std::uint16_t bits;
+  std::uint8_t length;
+};
+
+// Writes bits least significant first, as deflate packs them
+class BitWriter {
+public:
+  explicit BitWriter(std::string &out) : out_(out) {}
+
+  void put(std::uint32_t bits, int count) {
+    buffer_ |= static_cast<std::uint64_t>(bits) << count_;
+    count_ += count;
+    while (count_ >= 8) {
+      out_.push_back(static_cast<char>(buffer_ & 0xff));
+      buffer_ >>= 8;
+      count_ -= 8;
+    }
+  }
+
+  void put(Code code) { put(code.bits, code.length); }
+
+  // Pad with zeros to a whole byte
+  void align() {
+    if (count_ > 0) {
+      put(0, 8 - count_);
+    }
+  }
+
+private:
+  std::string &out_;
+  std::uint64_t buffer_{0};
+  int count_{0};
+};
+
+// Huffman code lengths for symbols used freqs times, none longer than
+// limit. Symbols that aren't used get no code.
+auto huffman_lengths(std::vector<std::uint32_t> freqs, int limit)
+    -> std::vector<std::uint8_t> {
+  auto n = freqs.size();
+  // A code needs at least two symbols, even if fewer are used
+  auto used = static_cast<std::size_t>(
+      std::count_if(freqs.begin(), freqs.end(), [](auto f) { return f > 0; }));
+  for (std::size_t s = 0; used < 2; ++s) {
+    if (freqs[s] == 0) {
+      freqs[s] = 1;
+      ++used;
+    }
+  }
+
+  auto lengths = std::vector<std::uint8_t>(n, 0);
+  for (;;) {
+    // Nodes are the symbols then, in the order they're made, the internal
+    // nodes, so every node's parent comes after it
+    using Entry = std::pair<std::uint64_t, std::size_t>;
+    auto heap =
+        std::priority_queue<Entry, std::vector<Entry>, std::greater<>>{};
+    auto parent = std::vector<std::size_t>(n, 0);
+    for (std::size_t s = 0; s < n; ++s) {
+      if (freqs[s] > 0) {
+        heap.push({freqs[s], s});
+      }
+    }
+    while (heap.size() > 1) {
+      auto a = heap.top();
+      heap.pop();
+      auto b = heap.top();
+      heap.pop();
+      auto node = parent.size();
+      parent.push_back(0);
+      parent[a.second] = node;
+      parent[b.second] = node;
+      heap.push({a.first + b.first, node});
+    }
+
+    auto root = parent.size() - 1;
+    auto depth = std::vector<int>(parent.size(), 0);
+    for (auto node = root; node-- > 0;) {
+      depth[node] = depth[parent[node]] + 1;
+    }
+    auto longest = 0;
+    for (std::size_t s = 0; s < n; ++s) {
+      if (freqs[s] > 0) {
+        longest = std::max(longest, depth[s]);
+      }
+    }
+    if (longest <= limit) {
+      for (std::size_t s = 0; s < n; ++s) {
+        lengths[s] = static_cast<std::uint8_t>(freqs[s] > 0 ? depth[s] : 0);
+      }
+      return lengths;
+    }
+    // Flatten the frequencies, and so the tree, until it fits
+    for (auto &f : freqs) {
+      if (f > 0) {
+        f = f / 2 + 1;
+      }
+    }
+  }
+}
+
+// The canonical codes for lengths, bit reversed ready for BitWriter
+auto canonical_codes(std::vector<std::uint8_t> const &lengths)
+    -> std::vector<Code> {
+  int count[16] = {};
+  for (auto l : lengths) {
+    ++count[l];
+  }
+  count[0] = 0;
+  int next[16] = {};
+  for (int bits = 1, code = 0; bits < 16; ++bits) {
+    code = (code + count[bits - 1]) << 1;
+    next[bits] = code;
+  }
+
+  auto codes = std::vector<Code>(lengths.size(), Code{0, 0});
+  for (std::size_t s = 0; s < lengths.size(); ++s) {
+    auto length = lengths[s];
+    if (length == 0) {
+      continue;
+    }
+    auto code = next[length]++;
+    auto reversed = 0;
+    for (int i = 0; i < length; ++i) {
+      reversed = (reversed << 1) | ((code >> i) & 1);
+    }
+    codes[s] = Code{static_cast<std::uint16_t>(reversed), length};
+  }
+  return codes;
+}
+
+// A code length, or a run of them, as a code length code and its extra
+// bits
+struct LengthRun {
+  std::uint8_t symbol;
+  std::uint8_t extra;
+};
+
+auto run_length_encode(std::vector<std::uint8_t> const &lengths)
+    -> std::vector<LengthRun> {
+  auto runs = std::vector<LengthRun>{};
+  auto emit = [&runs](std::size_t symbol, std::size_t extra) {
+    runs.push_back(LengthRun{static_cast<std::uint8_t>(symbol),
+                             static_cast<std::uint8_t>(extra)});
+  };
+  for (std::size_t i = 0; i < lengths.size();) {
+    auto length = lengths[i];
+    auto run = std::size_t{1};
+    while (i + run < lengths.size() && lengths[i + run] == length) {
+      ++run;
+    }
+    i += run;
+    if (length == 0) {
+      while (run >= 11) {
+        auto n = std::min<std::size_t>(run, 138);
+        emit(18, n - 11);
+        run -= n;
+      }
+      if (run >= 3) {
+        emit(17, run - 3);
+        run = 0;
+      }
+    } else {
+      emit(length, 0);
+      --run;
+      while (run >= 3) {
+        auto n = std::min<std::size_t>(run, 6);
+        emit(16, n - 3);
+        run -= n;
+      }
+    }
+    for (; run > 0; --run) {
+      emit(length, 0);
+    }
+  }
+  return runs;
+}
+
+// One deflate block with dynamic Huffman codes made for its symbols
+void write_block(BitWriter &bits, Symbol const *symbols, std::size_t count,
+                 bool final) {
+  auto literal_freqs = std::vector<std::uint32_t>(literal_codes, 0);
+  auto distance_freqs = std::vector<std::uint32_t>(distance_codes, 0);
+  for (std::size_t i = 0; i < count; ++i) {
+    auto s = symbols[i];
+    if (s.distance == 0) {
+      ++literal_freqs[s.length];
+    } else {
+      ++literal_freqs[257 + code_for(length_base, s.length)];
+      ++distance_freqs[code_for(distance_base, s.distance)];
+    }
+  }
+  literal_freqs[end_of_block] = 1;
+
+  auto literal_lengths = huffman_lengths(literal_freqs, 15);
+  auto distance_lengths = huffman_lengths(distance_freqs, 15);
+  auto literals = literal_codes;
+  while (literals > 257 && literal_lengths[literals - 1] == 0) {
+    --literals;
+  }
+  auto distances = distance_codes;
+  while (distances > 1 && distance_lengths[distances - 1] == 0) {
+    --distances;
+  }
+
+  // Both sets of code lengths are sent together, run length encoded with
+  // a Huffman code of their own
+  auto all_lengths = std::vector<std::uint8_t>(
+      literal_lengths.begin(),
+      literal_lengths.begin() + static_cast<std::ptrdiff_t>(literals));
+  all_lengths.insert(all_lengths.end(), distance_lengths.begin(),
+                     distance_lengths.begin() +
+                         static_cast<std::ptrdiff_t>(distances));
+  auto runs = run_length_encode(all_lengths);
+  auto length_freqs = std::vector<std::uint32_t>(19, 0);
+  for (auto r : runs) {
+    ++length_freqs[r.symbol];
+  }
+  auto length_lengths = huffman_lengths(length_freqs, 7);
+  auto length_count = std::size_t{19};
+  while (length_count > 4 &&
+         length_lengths[code_length_order[length_count - 1]] == 0) {
+    --length_count;
+  }
+
+  bits.put(final ? 1 : 0, 1);
+  bits.put(2, 2);
+  bits.put(static_cast<std::uint32_t>(literals - 257), 5);
+  bits.put(static_cast<std::uint32_t>(distances - 1), 5);
+  bits.put(static_cast<std::uint32_t>(length_count - 4), 4);
+  for (std::size_t i = 0; i < length_count; ++i) {
+    bits.put(length_lengths[code_length_order[i]], 3);
+  }
+  auto length_code = canonical_codes(length_lengths);
+  for (auto r : runs) {
+    bits.put(length_code[r.symbol]);
+    if (r.symbol == 16) {
+      bits.put(r.extra, 2);
+    } else if (r.symbol == 17) {
+      bits.put(r.extra, 3);
+    } else if (r.symbol == 18) {
+      bits.put(r.extra, 7);
+    }
+  }
+
+  auto literal_code = canonical_codes(literal_lengths);
+  auto distance_code = canonical_codes(distance_lengths);
+  for (std::size_t i = 0; i < count; ++i) {
+    auto s = symbols[i];
+    if (s.distance == 0) {
+      bits.put(literal_code[s.length]);
+      continue;
+    }
+    auto l = code_for(length_base, s.length);
+    bits.put(literal_code[257 + l]);
+    bits.put(s.length - length_base[l], length_extra[l]);
+    auto d = code_for(distance_base, s.distance);
+    bits.put(distance_code[d]);
+    bits.put(s.distance - distance_base[d], distance_extra[d]);
+  }
+  bits.put(literal_code[end_of_block]);
+}
+
+auto hash(unsigned char const *p) -> std::size_t {
+  auto v = static_cast<std::uint32_t>(p[0]) << 16 |
+           static_cast<std::uint32_t>(p[1]) << 8 | p[2];
+  return (v * 2654435761U) >> (32 - hash_bits);
+}
+
+// Bytes [begin, end) of data as literals and matches. Matches may reach
+// back before begin but never past end.
+auto find_matches(unsigned char const *data, std::size_t begin,
+                  std::size_t end) -> std::vector<Symbol> {
+  auto history = begin > window_size ? begin - window_size : 0;
+  auto head = std::vector<std::int32_t>(std::size_t{1} << hash_bits, -1);
+  auto prev = std::vector<std::int32_t>(end - history, -1);
+  auto insert = [&](std::size_t pos) {
+    if (pos + min_match <= end) {
+      auto &h = head[hash(data + pos)];
+      prev[pos - history] = h;
+      h = static_cast<std::int32_t>(pos - history);
+    }
+  };
+  for (auto pos = history; pos < begin; ++pos) {
+    insert(pos);
+  }
+
+  auto symbols = std::vector<Symbol>{};
+  symbols.reserve((end - begin) / 2);
+  for (auto pos = begin; pos < end;) {
+    auto best_length = std::size_t{0};
+    auto best_distance = std::size_t{0};
+    if (pos + min_match <= end) {
+      auto limit = std::min(max_match, end - pos);
+      auto candidate = head[hash(data + pos)];
+      for (int tries = 0; candidate >= 0 && tries < max_chain; ++tries) {
+        auto from = history + static_cast<std::size_t>(candidate);
+        auto distance = pos - from;
+        if (distance > window_size) {
+          break;
+        }
+        if (data[from + best_length] == data[pos + best_length]) {
+          auto length = std::size_t{0};
+          while (length < limit && data[from + length] == data[pos + length]) {
+            ++length;
+          }
+          if (length > best_length) {
+            best_length = length;
+            best_distance = distance;
+            if (length == limit) {
+              break;
+            }
+          }
+        }
+        candidate = prev[static_cast<std::size_t>(candidate)];
+      }
+    }
+
+    if (best_length >= min_match) {
+      symbols.push_back(Symbol{static_cast<std::uint16_t>(best_length),
+                               static_cast<std::uint16_t>(best_distance)});
+      for (auto i = pos; i < pos + best_length; ++i) {
+        insert(i);
+      }
+      pos += best_length;
+    } else {
+      symbols.push_back(Symbol{data[pos], 0});
+      insert(pos);
+      ++pos;
+    }
+  }
+  return symbols;
+}
+
+// Bytes [begin, end) of data as deflate blocks ending on a byte boundary,
+// so that the pieces for consecutive ranges can simply be joined. Only the
+// last range's final block is marked as the end of the stream.
+auto compress_range(unsigned char const *data, std::size_t begin,
+                    std::size_t end, bool last) -> std::string {
+  auto symbols = find_matches(data, begin, end);
+  auto out = std::string{};
+  auto bits = BitWriter{out};
+  auto i = std::size_t{0};
+  do {
+    auto count = std::min(symbols_per_block, symbols.size() - i);
+    write_block(bits, symbols.data() + i, count,
+                last && i + count == symbols.size());
+    i += count;
+  } while (i < symbols.size());
+
+  if (!last) {
+    // An empty stored block pads to a byte boundary
+    bits.put(0, 3);
+    bits.align();
+    out.append("\x00\x00\xff\xff", 4);
+  }
+  bits.align();
+  return out;
+}
+} // namespace
+
+auto crc32(unsigned char const *data, std::size_t size, std::uint32_t crc)
+    -> std::uint32_t {
+  crc = ~crc;
+  for (std::size_t i = 0; i < size; ++i) {
+    crc = crc_table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+auto adler32(unsigned char const *data, std::size_t size,
+             std::uint32_t adler) -> std::uint32_t {
+  constexpr auto modulus = 65521U;
+  // The most bytes that can be summed before b could overflow
+  constexpr auto run = std::size_t{5552};
+  auto a = adler & 0xffff;
+  auto b = adler >> 16;
+  while (size > 0) {
+    auto n = std::min(size, run);
+    size -= n;
+    for (; n > 0; --n) {
+      a += *data++;
+      b += a;
+    }
+    a %= modulus;
+    b %= modulus;
+  }
+  return b << 16 | a;
+}
+
+auto zlib_compress(unsigned char const *data, std::size_t size,
+                   ThreadPool &pool) -> std::string {
+  auto ranges = std::max<std::size_t>(1, (size + block_size - 1) / block_size);
+  auto pieces = std::vector<std::future<std::string>>{};
+  pieces.reserve(ranges);
+  try {
+    for (std::size_t r = 0; r < ranges; ++r) {
+      auto begin = r * block_size;
+      auto end = std::min(size, begin + block_size);
+      auto last = r + 1 == ranges;
+      pieces.push_back(pool.submit([data, begin, end, last]() {
+        return compress_range(data, begin, end, last);
+      }));
+    }
+  } catch (...) {
+    settle(pieces);
+    throw;
+  }
+
+  // Every block finishes before one that failed is rethrown, since they
+  // all read from data
+  settle(pieces);
+
+  // Deflate with a 32K window, default compression
+  auto out = std::string{"\x78\x9c"};
+  for (auto &p : pieces) {
+    out += p.get();
+  }
+  put_u32(out, adler32(data, size));
+  return out;
+}
+
+} // namespace raytrace
@@ -0,0 +1,67 @@
+#include "image_output.h"
+
+#include "canvas.h"
+#include "pfm.h"
+#include "png.h"
+#include "ppm.h"
+#include "qoi.h"
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <stdexcept>
+
+namespace raytrace {
+
+auto image_format_for(std::string const &path) -> ImageFormat {
+  auto dot = path.find_last_of("./");
+  if (dot == std::string::npos || path[dot] != '.') {
+    return ImageFormat::ppm;
+  }
+  auto extension = path.substr(dot + 1);
+  std::transform(extension.begin(), extension.end(), extension.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+  if (extension == "qoi") {
+    return ImageFormat::qoi;
+  }
+  if (extension == "png") {
+    return ImageFormat::png;
+  }
+  if (extension == "pfm") {
+    return ImageFormat::pfm;
+  }
+  return ImageFormat::ppm;
+}
+
+auto encode_image(Canvas const &image, ImageFormat format, ThreadPool &pool,
+                  Quantization const &quantization) -> std::string {
+  switch (format) {
+  case ImageFormat::qoi:
+    return encode_qoi(image, quantization);
+  case ImageFormat::png:
+    return encode_png(image, pool, quantization);
+  case ImageFormat::pfm:
+    return encode_pfm(image);
+  case ImageFormat::ppm:
+    break;
+  }
+  return encode_ppm(image, PpmFormat::plain, pool, quantization);
+}
+
+void write_image(std::string const &path, Canvas const &image,
+                 ThreadPool &pool, Quantization const &quantization) {
+  auto format = image_format_for(path);
+  auto os = std::ofstream{path, std::ios::binary};
+  if (format == ImageFormat::pfm) {
+    // Floats go to the file as they are, with no copy to encode into
+    write_pfm(os, image);
+  } else {
+    auto bytes = encode_image(image, format, pool, quantization);
+    os.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+  }
+  if (!os.flush()) {
+    throw std::runtime_error("Can't write image " + path);
+  }
+}
+
+} // namespace raytrace
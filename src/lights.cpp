@@ -0,0 +1,96 @@
+#include "lights.h"
+
+#include "bounds.h"
+
+#include <cmath>
+#include <numeric>
+
+namespace raytrace {
+
+AreaLight::AreaLight(Kind kind, Point corner, Vector3 uvec, int usteps,
+                     Vector3 vvec, int vsteps, float radius, Color intensity)
+    : kind_(kind), corner_(corner), uvec_(uvec), usteps_(usteps),
+      vvec_(vvec), vsteps_(vsteps), radius_(radius), intensity_(intensity) {
+  if (usteps <= 0 || vsteps <= 0) {
+    throw std::out_of_range("Area lights need at least one sample");
+  }
+
+  // Step through the strata by roughly the golden ratio of their count; any
+  // stride coprime with the count visits each stratum exactly once.
+  auto n = samples();
+  stride_ = std::max(1, static_cast<int>(n * 0.618034f));
+  while (std::gcd(stride_, n) != 1) {
+    ++stride_;
+  }
+}
+
+auto AreaLight::center() const -> Point {
+  if (kind_ == Kind::sphere) {
+    return corner_;
+  }
+  return corner_ + uvec_ * (usteps_ / 2.0f) + vvec_ * (vsteps_ / 2.0f);
+}
+
+auto AreaLight::extent() const -> std::vector<Point> {
+  if (kind_ == Kind::sphere) {
+    auto r = Vector3{radius_, radius_, radius_};
+    auto box = Bounds{corner_ - r, corner_ + r}.corners();
+    return std::vector<Point>(box.begin(), box.end());
+  }
+  auto u = uvec_ * static_cast<float>(usteps_);
+  auto v = vvec_ * static_cast<float>(vsteps_);
+  return {corner_, corner_ + u, corner_ + v, corner_ + u + v};
+}
+
+auto AreaLight::point_on_light(int i, Rng &rng, Point p) const -> Point {
+  auto stratum = order(i);
+  auto ju = jitter_ ? rng.next_float() : 0.5f;
+  auto jv = jitter_ ? rng.next_float() : 0.5f;
+
+  if (kind_ == Kind::rectangle) {
+    auto u = stratum % usteps_;
+    auto v = stratum / usteps_;
+    return corner_ + uvec_ * (u + ju) + vvec_ * (v + jv);
+  }
+
+  // Uniform on the sphere's surface: z is uniform in [-1, 1], which is
+  // stratified, and the azimuth winds around by the golden angle.
+  constexpr auto golden_angle = 2.39996323f;
+  auto z = 1 - 2 * (stratum + jv) / samples();
+  auto r = std::sqrt(std::max(0.0f, 1 - z * z));
+  auto phi = golden_angle * stratum + 2 * pi * ju;
+  auto offset = Vector3{r * std::cos(phi), r * std::sin(phi), z};
+
+  // Only the half of the sphere facing p can light it
+  if (offset.dot(p - corner_) < 0) {
+    offset = -offset;
+  }
+  return corner_ + offset * radius_;
+}
+
+auto rectangle_light(Point corner, Vector3 full_uvec, int usteps,
+                     Vector3 full_vvec, int vsteps, Color intensity)
+    -> AreaLight {
+  return AreaLight{AreaLight::Kind::rectangle,
+                   corner,
+                   full_uvec / static_cast<float>(usteps),
+                   usteps,
+                   full_vvec / static_cast<float>(vsteps),
+                   vsteps,
+                   0.0f,
+                   intensity};
+}
+
+auto sphere_light(Point center, float radius, int samples, Color intensity)
+    -> AreaLight {
+  return AreaLight{AreaLight::Kind::sphere,
+                   center,
+                   Vector3{},
+                   samples,
+                   Vector3{},
+                   1,
+                   radius,
+                   intensity};
+}
+
+} // namespace raytrace
@@ -0,0 +1,82 @@
+#include "mapped_canvas.h"
+
+#include "pfm.h"
+#include "ppm.h"
+
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cerrno>
+#define RAYTRACE_HAVE_MMAP 1
+#endif
+
+namespace raytrace {
+
+namespace {
+auto header(ImageFile format, int width, int height) -> std::string {
+  if (format == ImageFile::ppm) {
+    return ppm_header(PpmFormat::raw, width, height);
+  }
+  return pfm_header(width, height);
+}
+} // namespace
+
+auto map_image_file(std::string const &path, ImageFile format, int width,
+                    int height) -> Canvas {
+  if (width <= 0 || height <= 0) {
+    throw std::out_of_range("height and width must be greater than zero");
+  }
+  auto pixels = format == ImageFile::ppm ? PixelFormat::rgb8
+                                         : PixelFormat::rgb_float;
+  auto head = header(format, width, height);
+  auto row_size = static_cast<std::size_t>(width) * pixel_size(pixels);
+  auto file_size = head.size() + row_size * static_cast<std::size_t>(height);
+
+#ifdef RAYTRACE_HAVE_MMAP
+  auto fail = [&path](char const *what, int error) {
+    return std::runtime_error(std::string{what} + " " + path + ": " +
+                              std::strerror(error));
+  };
+
+  auto fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    throw fail("Can't create", errno);
+  }
+  if (::ftruncate(fd, static_cast<off_t>(file_size)) != 0) {
+    auto error = fail("Can't size", errno);
+    ::close(fd);
+    throw error;
+  }
+  auto *base = ::mmap(nullptr, file_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                      fd, 0);
+  // Closing the file can change errno, so keep mmap's
+  auto map_error = errno;
+  ::close(fd);
+  if (base == MAP_FAILED) {
+    throw fail("Can't map", map_error);
+  }
+  auto mapping = std::shared_ptr<void>(
+      base, [file_size](void *p) { ::munmap(p, file_size); });
+
+  auto *bytes = static_cast<unsigned char *>(base);
+  std::memcpy(bytes, head.data(), head.size());
+  auto *data = bytes + head.size();
+  auto stride = static_cast<std::ptrdiff_t>(row_size);
+  if (format == ImageFile::pfm) {
+    data += row_size * static_cast<std::size_t>(height - 1);
+    stride = -stride;
+  }
+  return Canvas{width, height, pixels, data, stride, std::move(mapping)};
+#else
+  (void)file_size;
+  throw std::runtime_error("Can't map " + path +
+                           ": memory-mapped files aren't supported here");
+#endif
+}
+
+} // namespace raytrace
@@ -0,0 +1,139 @@
+#include "material_table.h"
+
+#include <cmath>
+#include <cstring>
+
+namespace raytrace {
+
+namespace {
+// Shininess up to this is raised by repeated squaring rather than std::pow
+constexpr auto max_int_shininess = 1024;
+
+auto pow_int(float base, int exponent) -> float {
+  auto result = 1.0f;
+  while (exponent > 0) {
+    if (exponent & 1) {
+      result *= base;
+    }
+    base *= base;
+    exponent >>= 1;
+  }
+  return result;
+}
+} // namespace
+
+CompiledMaterial::CompiledMaterial(Material const &material,
+                                   std::vector<PointLight> const &lights)
+    : material_(material) {
+  ambient_.reserve(lights.size());
+  diffuse_.reserve(lights.size());
+  specular_.reserve(lights.size());
+  for (auto const &light : lights) {
+    auto effective_material_color = material.color() * light.intensity;
+    ambient_.push_back(material.ambient() * effective_material_color);
+    diffuse_.push_back(effective_material_color * material.diffuse());
+    specular_.push_back(light.intensity * material.specular());
+  }
+
+  auto shininess = material.shininess();
+  if (material.diffuse() == 0 && material.specular() == 0) {
+    direct_ = direct_none;
+  } else if (material.specular() == 0) {
+    direct_ = direct_diffuse;
+  } else if (shininess <= max_int_shininess &&
+             shininess == std::floor(shininess)) {
+    int_shininess_ = static_cast<int>(shininess);
+    direct_ = direct_int_shininess;
+  } else {
+    direct_ = direct_general;
+  }
+}
+
+auto CompiledMaterial::direct_none(CompiledMaterial const &, std::size_t,
+                                   Vector3, Vector3, Vector3) -> Color {
+  return colors::black;
+}
+
+auto CompiledMaterial::direct_diffuse(CompiledMaterial const &m,
+                                      std::size_t light, Vector3 to_light,
+                                      Vector3, Vector3 normal) -> Color {
+  auto light_dot_normal = to_light.dot(normal);
+  if (light_dot_normal < 0) {
+    return colors::black;
+  }
+  return m.diffuse_[light] * light_dot_normal;
+}
+
+auto CompiledMaterial::direct_int_shininess(CompiledMaterial const &m,
+                                            std::size_t light,
+                                            Vector3 to_light, Vector3 eye,
+                                            Vector3 normal) -> Color {
+  auto light_dot_normal = to_light.dot(normal);
+  if (light_dot_normal < 0) {
+    return colors::black;
+  }
+  auto color = m.diffuse_[light] * light_dot_normal;
+  auto reflect_dot_eye = (-to_light).reflect(normal).dot(eye);
+  if (reflect_dot_eye > 0) {
+    color += m.specular_[light] * pow_int(reflect_dot_eye, m.int_shininess_);
+  }
+  return color;
+}
+
+auto CompiledMaterial::direct_general(CompiledMaterial const &m,
+                                      std::size_t light, Vector3 to_light,
+                                      Vector3 eye, Vector3 normal) -> Color {
+  auto light_dot_normal = to_light.dot(normal);
+  if (light_dot_normal < 0) {
+    return colors::black;
+  }
+  auto color = m.diffuse_[light] * light_dot_normal;
+  auto reflect_dot_eye = (-to_light).reflect(normal).dot(eye);
+  if (reflect_dot_eye > 0) {
+    color += m.specular_[light] *
+             std::pow(reflect_dot_eye, m.material_.shininess());
+  }
+  return color;
+}
+
+auto MaterialTable::key_of(Material const &material) -> Key {
+  auto c = material.color();
+  auto values = std::array<float, 7>{c.r,
+                                     c.g,
+                                     c.b,
+                                     material.ambient(),
+                                     material.diffuse(),
+                                     material.specular(),
+                                     material.shininess()};
+  auto key = Key{};
+  std::memcpy(key.data(), values.data(), sizeof key);
+  return key;
+}
+
+auto MaterialTable::KeyHash::operator()(Key const &key) const
+    -> std::size_t {
+  // FNV-1a over the words
+  auto h = std::uint64_t{14695981039346656037u};
+  for (auto word : key) {
+    h = (h ^ word) * 1099511628211u;
+  }
+  return static_cast<std::size_t>(h);
+}
+
+auto MaterialTable::insert(Material const &material) -> size_type {
+  auto [at, added] = index_.try_emplace(key_of(material), materials_.size());
+  if (added) {
+    materials_.push_back(material);
+  }
+  return at->second;
+}
+
+void MaterialTable::compile(std::vector<PointLight> const &lights) {
+  compiled_.clear();
+  compiled_.reserve(materials_.size());
+  for (auto const &material : materials_) {
+    compiled_.emplace_back(material, lights);
+  }
+}
+
+} // namespace raytrace
@@ -0,0 +1,159 @@
+#include "partial_image.h"
+
+#include "bits.h"
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace raytrace {
+
+namespace {
+// Version 2 fixed the byte order of the pixels to little endian
+constexpr auto magic = "RTPART2";
+
+void put_float(unsigned char *out, float v) {
+  auto bits = bits_of(v);
+  for (int i = 0; i < 4; ++i) {
+    out[i] = static_cast<unsigned char>(bits >> (8 * i));
+  }
+}
+
+auto get_float(unsigned char const *in) -> float {
+  auto bits = std::uint32_t{0};
+  for (int i = 0; i < 4; ++i) {
+    bits |= static_cast<std::uint32_t>(in[i]) << (8 * i);
+  }
+  auto v = 0.0f;
+  std::memcpy(&v, &bits, sizeof v);
+  return v;
+}
+} // namespace
+
+auto shard_crop(int width, int height, int shard, int shards) -> Tile {
+  if (shards <= 0 || shard < 0 || shard >= shards) {
+    throw std::out_of_range("Shard must be in [0, shards)");
+  }
+  if (shards > height) {
+    throw std::out_of_range("Can't split " + std::to_string(height) +
+                            " rows into " + std::to_string(shards) +
+                            " shards");
+  }
+  auto y0 = static_cast<int>(static_cast<long long>(height) * shard / shards);
+  auto y1 =
+      static_cast<int>(static_cast<long long>(height) * (shard + 1) / shards);
+  return Tile{0, y0, width, y1 - y0};
+}
+
+void write_partial(std::ostream &os, PartialImage const &part) {
+  os << magic << "\n"
+     << part.full_width << " " << part.full_height << "\n"
+     << part.crop.x << " " << part.crop.y << " " << part.crop.width << " "
+     << part.crop.height << "\n";
+
+  auto row =
+      std::vector<unsigned char>(static_cast<size_t>(part.crop.width) * 12);
+  for (int y = 0; y < part.crop.height; ++y) {
+    for (int x = 0; x < part.crop.width; ++x) {
+      auto c = part.pixels.pixel_at(x, y);
+      auto *out = row.data() + static_cast<size_t>(x) * 12;
+      put_float(out, c.r);
+      put_float(out + 4, c.g);
+      put_float(out + 8, c.b);
+    }
+    os.write(reinterpret_cast<char const *>(row.data()),
+             static_cast<std::streamsize>(row.size()));
+  }
+}
+
+auto read_partial(std::istream &is) -> PartialImage {
+  auto header = std::string{};
+  is >> header;
+  if (header != magic) {
+    throw std::runtime_error("Not a partial image");
+  }
+  int full_width = 0;
+  int full_height = 0;
+  auto crop = Tile{0, 0, 0, 0};
+  is >> full_width >> full_height >> crop.x >> crop.y >> crop.width >>
+      crop.height;
+  // a single newline separates the header from the pixels
+  is.get();
+  if (!is || crop.width <= 0 || crop.height <= 0) {
+    throw std::runtime_error("Bad partial image header");
+  }
+  if (full_width <= 0 || full_height <= 0 ||
+      full_width > PartialImage::max_dimension ||
+      full_height > PartialImage::max_dimension ||
+      static_cast<long long>(full_width) * full_height >
+          PartialImage::max_pixels) {
+    throw std::runtime_error("Partial image of a " +
+                             std::to_string(full_width) + " x " +
+                             std::to_string(full_height) +
+                             " image is too big or empty");
+  }
+  if (crop.x < 0 || crop.y < 0 ||
+      static_cast<long long>(crop.x) + crop.width > full_width ||
+      static_cast<long long>(crop.y) + crop.height > full_height) {
+    throw std::runtime_error("Partial image lies outside the image");
+  }
+
+  auto part = PartialImage{full_width, full_height, crop,
+                           Canvas{crop.width, crop.height}};
+  auto row = std::vector<unsigned char>(static_cast<size_t>(crop.width) * 12);
+  for (int y = 0; y < crop.height; ++y) {
+    is.read(reinterpret_cast<char *>(row.data()),
+            static_cast<std::streamsize>(row.size()));
+    if (!is) {
+      throw std::runtime_error("Partial image is truncated");
+    }
+    for (int x = 0; x < crop.width; ++x) {
+      auto const *in = row.data() + static_cast<size_t>(x) * 12;
+      part.pixels.write_pixel(
+          x, y, Color{get_float(in), get_float(in + 4), get_float(in + 8)});
+    }
+  }
+  return part;
+}
+
+auto merge_partials(std::vector<PartialImage> const &parts) -> Canvas {
+  if (parts.empty()) {
+    throw std::invalid_argument("Nothing to merge");
+  }
+  auto width = parts.front().full_width;
+  auto height = parts.front().full_height;
+  auto image = Canvas{width, height};
+  auto covered = std::vector<bool>(static_cast<size_t>(width) * height, false);
+
+  for (auto const &part : parts) {
+    auto const &crop = part.crop;
+    if (part.full_width != width || part.full_height != height) {
+      throw std::invalid_argument("Partial images of different sizes");
+    }
+    if (crop.x < 0 || crop.y < 0 || crop.x + crop.width > width ||
+        crop.y + crop.height > height) {
+      throw std::invalid_argument("Partial image lies outside the image");
+    }
+    for (int y = 0; y < crop.height; ++y) {
+      for (int x = 0; x < crop.width; ++x) {
+        auto i = static_cast<size_t>(crop.x + x) +
+                 static_cast<size_t>(crop.y + y) * width;
+        if (covered[i]) {
+          throw std::invalid_argument("Partial images overlap");
+        }
+        covered[i] = true;
+        image.write_pixel(crop.x + x, crop.y + y, part.pixels.pixel_at(x, y));
+      }
+    }
+  }
+
+  for (auto c : covered) {
+    if (!c) {
+      throw std::invalid_argument("Partial images leave gaps");
+    }
+  }
+  return image;
+}
+
+} // namespace raytrace
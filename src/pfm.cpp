@@ -0,0 +1,77 @@
+#include "pfm.h"
+
+#include "canvas.h"
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace raytrace {
+
+namespace {
+constexpr auto floats_per_pixel = std::size_t{3};
+
+auto little_endian() -> bool {
+  auto one = std::uint16_t{1};
+  unsigned char first{};
+  std::memcpy(&first, &one, 1);
+  return first == 1;
+}
+
+auto row_bytes(Canvas const &image) -> std::size_t {
+  return static_cast<std::size_t>(image.width()) * floats_per_pixel *
+         sizeof(float);
+}
+
+// Row y of image as PFM floats. A float canvas's own row is used as it is;
+// anything else is converted into scratch.
+auto float_row(Canvas const &image, int y, std::vector<float> &scratch)
+    -> char const * {
+  if (image.format() == PixelFormat::rgb_float) {
+    return reinterpret_cast<char const *>(image.row(y));
+  }
+  scratch.resize(static_cast<std::size_t>(image.width()) * floats_per_pixel);
+  for (int x = 0; x < image.width(); ++x) {
+    auto c = image.pixel_at(x, y);
+    auto *p = scratch.data() + static_cast<std::size_t>(x) * floats_per_pixel;
+    p[0] = c.r;
+    p[1] = c.g;
+    p[2] = c.b;
+  }
+  return reinterpret_cast<char const *>(scratch.data());
+}
+} // namespace
+
+auto pfm_header(int width, int height) -> std::string {
+  // A negative scale marks little endian floats
+  return "PF\n" + std::to_string(width) + " " + std::to_string(height) +
+         "\n" + (little_endian() ? "-1.0\n" : "1.0\n");
+}
+
+void append_pfm_rows(std::string &out, Canvas const &image, int y0,
+                     int y1) {
+  auto size = row_bytes(image);
+  out.reserve(out.size() + static_cast<std::size_t>(y1 - y0) * size);
+  auto scratch = std::vector<float>{};
+  for (int y = y1 - 1; y >= y0; --y) {
+    out.append(float_row(image, y, scratch), size);
+  }
+}
+
+auto encode_pfm(Canvas const &image) -> std::string {
+  auto pfm = pfm_header(image.width(), image.height());
+  append_pfm_rows(pfm, image, 0, image.height());
+  return pfm;
+}
+
+void write_pfm(std::ostream &os, Canvas const &image) {
+  auto header = pfm_header(image.width(), image.height());
+  os.write(header.data(), static_cast<std::streamsize>(header.size()));
+  auto size = static_cast<std::streamsize>(row_bytes(image));
+  auto scratch = std::vector<float>{};
+  for (int y = image.height() - 1; y >= 0; --y) {
+    os.write(float_row(image, y, scratch), size);
+  }
+}
+
+} // namespace raytrace
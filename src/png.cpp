@@ -0,0 +1,131 @@
+#include "png.h"
+
+#include "big_endian.h"
+#include "canvas.h"
+#include "deflate.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+namespace raytrace {
+
+namespace {
+constexpr auto bytes_per_pixel = std::size_t{3};
+constexpr auto filter_types = 5;
+
+auto paeth(int a, int b, int c) -> int {
+  auto p = a + b - c;
+  auto pa = std::abs(p - a);
+  auto pb = std::abs(p - b);
+  auto pc = std::abs(p - c);
+  if (pa <= pb && pa <= pc) {
+    return a;
+  }
+  return pb <= pc ? b : c;
+}
+
+// row filtered with filter type, against the row above it, which is null
+// for the first row
+void apply_filter(int type, unsigned char const *row,
+                  unsigned char const *above, std::size_t size,
+                  unsigned char *out) {
+  for (std::size_t i = 0; i < size; ++i) {
+    int a = i >= bytes_per_pixel ? row[i - bytes_per_pixel] : 0;
+    int b = above != nullptr ? above[i] : 0;
+    int c = above != nullptr && i >= bytes_per_pixel
+                ? above[i - bytes_per_pixel]
+                : 0;
+    auto predicted = 0;
+    switch (type) {
+    case 1:
+      predicted = a;
+      break;
+    case 2:
+      predicted = b;
+      break;
+    case 3:
+      predicted = (a + b) / 2;
+      break;
+    case 4:
+      predicted = paeth(a, b, c);
+      break;
+    default:
+      break;
+    }
+    out[i] = static_cast<unsigned char>(row[i] - predicted);
+  }
+}
+
+// The filter type byte then row filtered whichever way leaves the
+// smallest differences, the usual guess at what compresses best
+void filter_row(unsigned char const *row, unsigned char const *above,
+                std::size_t size, unsigned char *out,
+                std::vector<unsigned char> &scratch) {
+  scratch.resize(size);
+  auto best = -1L;
+  for (int type = 0; type < filter_types; ++type) {
+    apply_filter(type, row, above, size, scratch.data());
+    auto cost = 0L;
+    for (auto v : scratch) {
+      cost += std::abs(static_cast<signed char>(v));
+    }
+    if (best < 0 || cost < best) {
+      best = cost;
+      out[0] = static_cast<unsigned char>(type);
+      std::copy(scratch.begin(), scratch.end(), out + 1);
+    }
+  }
+}
+
+void put_chunk(std::string &out, char const *type, std::string const &data) {
+  put_u32(out, static_cast<std::uint32_t>(data.size()));
+  auto start = out.size();
+  out.append(type, 4);
+  out += data;
+  auto const *bytes = reinterpret_cast<unsigned char const *>(out.data());
+  put_u32(out, crc32(bytes + start, out.size() - start));
+}
+} // namespace
+
+auto encode_png(Canvas const &image, ThreadPool &pool,
+                Quantization const &quantization) -> std::string {
+  auto width = image.width();
+  auto height = image.height();
+  auto row_size = static_cast<std::size_t>(width) * bytes_per_pixel;
+
+  // Rows are filtered against the ones above, so quantize them all first
+  auto pixels = std::vector<unsigned char>(row_size * height);
+  for_each_band(pool, height, [&](int y0, int y1) {
+    auto values = std::vector<unsigned char>{};
+    for (int y = y0; y < y1; ++y) {
+      quantize_row(image, y, values, quantization);
+      std::copy(values.begin(), values.end(), pixels.begin() + y * row_size);
+    }
+  });
+  auto filtered = std::vector<unsigned char>((row_size + 1) * height);
+  for_each_band(pool, height, [&](int y0, int y1) {
+    auto scratch = std::vector<unsigned char>{};
+    for (int y = y0; y < y1; ++y) {
+      auto const *row = pixels.data() + y * row_size;
+      filter_row(row, y > 0 ? row - row_size : nullptr, row_size,
+                 filtered.data() + y * (row_size + 1), scratch);
+    }
+  });
+
+  auto header = std::string{};
+  put_u32(header, static_cast<std::uint32_t>(width));
+  put_u32(header, static_cast<std::uint32_t>(height));
+  // 8 bits per channel, RGB, deflate, adaptive filters, not interlaced
+  header.append("\x08\x02\x00\x00\x00", 5);
+
+  auto out = std::string{"\x89PNG\r\n\x1a\n"};
+  put_chunk(out, "IHDR", header);
+  put_chunk(out, "IDAT", zlib_compress(filtered.data(), filtered.size(), pool));
+  put_chunk(out, "IEND", {});
+  return out;
+}
+
+} // namespace raytrace
@@ -0,0 +1,121 @@
+#include "ppm.h"
+
+#include "canvas.h"
+#include "thread_pool.h"
+
+#include <array>
+#include <string>
+#include <vector>
+
+namespace raytrace {
+
+namespace {
+constexpr auto max_ppm_line_len = 70;
+
+// The decimal digits of every PPM value
+struct Digits {
+  char text[3];
+  int length;
+};
+
+constexpr auto make_digit_table() -> std::array<Digits, 256> {
+  auto table = std::array<Digits, 256>{};
+  for (int v = 0; v < 256; ++v) {
+    auto &d = table[static_cast<std::size_t>(v)];
+    if (v >= 100) {
+      d = Digits{{static_cast<char>('0' + v / 100),
+                  static_cast<char>('0' + v / 10 % 10),
+                  static_cast<char>('0' + v % 10)},
+                 3};
+    } else if (v >= 10) {
+      d = Digits{{static_cast<char>('0' + v / 10),
+                  static_cast<char>('0' + v % 10), ' '},
+                 2};
+    } else {
+      d = Digits{{static_cast<char>('0' + v), ' ', ' '}, 1};
+    }
+  }
+  return table;
+}
+
+constexpr auto digit_table = make_digit_table();
+
+// A row of PPM values as text
+void append_plain_row(std::string &out,
+                      std::vector<unsigned char> const &values) {
+  // Every value takes at most three digits and a separator
+  auto start = out.size();
+  out.resize(start + values.size() * 4 + 1);
+  auto *p = out.data() + start;
+  auto line_len = 0;
+  for (auto v : values) {
+    auto const &d = digit_table[v];
+
+    // PPM lines should be <= 70 chars
+    if (line_len + d.length + 1 > max_ppm_line_len) {
+      *p++ = '\n';
+      line_len = 0;
+    }
+    if (line_len > 0) {
+      *p++ = ' ';
+      ++line_len;
+    }
+    for (int i = 0; i < d.length; ++i) {
+      *p++ = d.text[i];
+    }
+    line_len += d.length;
+  }
+  *p++ = '\n';
+  out.resize(static_cast<std::size_t>(p - out.data()));
+}
+
+} // namespace
+
+auto ppm_header(PpmFormat format, int width, int height) -> std::string {
+  return (format == PpmFormat::plain ? "P3\n" : "P6\n") +
+         std::to_string(width) + " " + std::to_string(height) + "\n255\n";
+}
+
+void append_ppm_rows(std::string &out, PpmFormat format, Canvas const &image,
+                     int y0, int y1, Quantization const &quantization) {
+  if (format == PpmFormat::raw) {
+    out.reserve(out.size() +
+                static_cast<std::size_t>(y1 - y0) * image.width() * 3);
+  }
+  auto values = std::vector<unsigned char>{};
+  for (int y = y0; y < y1; ++y) {
+    quantize_row(image, y, values, quantization);
+    if (format == PpmFormat::plain) {
+      append_plain_row(out, values);
+    } else {
+      out.append(reinterpret_cast<char const *>(values.data()),
+                 values.size());
+    }
+  }
+}
+
+auto encode_ppm(Canvas const &image, PpmFormat format, ThreadPool &pool,
+                Quantization const &quantization) -> std::string {
+  auto height = image.height();
+
+  // Each band's text goes in the slot for its first row, leaving the rest
+  // empty, so the slots joined in order are the whole image
+  auto parts = std::vector<std::string>(static_cast<std::size_t>(height));
+  for_each_band(pool, height, [&](int y0, int y1) {
+    append_ppm_rows(parts[static_cast<std::size_t>(y0)], format, image, y0, y1,
+                    quantization);
+  });
+
+  auto ppm = ppm_header(format, image.width(), height);
+  auto size = ppm.size();
+  for (auto const &part : parts) {
+    size += part.size();
+  }
+  ppm.reserve(size);
+  for (auto const &part : parts) {
+    ppm.append(part);
+  }
+  return ppm;
+}
+
+} // namespace raytrace
@@ -0,0 +1,130 @@
+#include "progressive.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace raytrace {
+
+namespace {
+// The grid point at or before v, and the one after it, for a grid of
+// spacing that ends at last
+auto grid_span(int v, int spacing, int last) -> std::pair<int, int> {
+  auto v0 = std::min(v / spacing * spacing, last);
+  return {v0, std::min(v0 + spacing, last)};
+}
+
+auto nearest_on_grid(int v, int spacing, int last) -> int {
+  return std::min((v + spacing / 2) / spacing * spacing, last);
+}
+
+// Fill every pixel that hasn't been traced from the traced pixels on the
+// grid of spacing
+void fill(Canvas &image, std::vector<std::uint8_t> const &traced,
+          int spacing, Upsample upsample, ThreadPool &pool) {
+  auto width = image.width();
+  auto last_x = (width - 1) / spacing * spacing;
+  auto last_y = (image.height() - 1) / spacing * spacing;
+  for_each_band(pool, image.height(), [&](int y0, int y1) {
+    for (int y = y0; y < y1; ++y) {
+      for (int x = 0; x < width; ++x) {
+        if (traced[static_cast<std::size_t>(y) * width + x]) {
+          continue;
+        }
+        if (upsample == Upsample::nearest) {
+          auto nx = nearest_on_grid(x, spacing, last_x);
+          auto ny = nearest_on_grid(y, spacing, last_y);
+          image.write_pixel(x, y, image.pixel_at(nx, ny));
+          continue;
+        }
+        auto [gx0, gx1] = grid_span(x, spacing, last_x);
+        auto [gy0, gy1] = grid_span(y, spacing, last_y);
+        auto fx = gx1 == gx0 ? 0.0f
+                             : static_cast<float>(x - gx0) / (gx1 - gx0);
+        auto fy = gy1 == gy0 ? 0.0f
+                             : static_cast<float>(y - gy0) / (gy1 - gy0);
+        auto top = image.pixel_at(gx0, gy0) * (1 - fx) +
+                   image.pixel_at(gx1, gy0) * fx;
+        auto bottom = image.pixel_at(gx0, gy1) * (1 - fx) +
+                      image.pixel_at(gx1, gy1) * fx;
+        image.write_pixel(x, y, top * (1 - fy) + bottom * fy);
+      }
+    }
+  });
+}
+} // namespace
+
+auto render_progressive(Camera const &camera, World &world, ThreadPool &pool,
+                        std::chrono::steady_clock::time_point deadline,
+                        ProgressiveOptions const &options)
+    -> ProgressiveImage {
+  auto coarsest = options.coarsest;
+  if (coarsest < 1 || (coarsest & (coarsest - 1)) != 0) {
+    throw std::invalid_argument("coarsest spacing must be a power of two");
+  }
+
+  auto width = camera.h_size();
+  auto height = camera.v_size();
+  auto image = Canvas{width, height};
+  auto traced = std::vector<std::uint8_t>(
+      static_cast<std::size_t>(width) * static_cast<std::size_t>(height), 0);
+  auto traced_count = std::atomic<std::size_t>{0};
+
+  world.commit();
+  World const &prepared = world;
+
+  auto finished = 0;
+  for (auto spacing = coarsest; spacing >= 1; spacing /= 2) {
+    auto first = spacing == coarsest;
+    auto out_of_time = std::atomic<bool>{false};
+
+    for_each_band(pool, height, [&](int y0, int y1) {
+      auto count = std::size_t{0};
+      for (int y = y0; y < y1; ++y) {
+        if (y % spacing != 0) {
+          continue;
+        }
+        if (!first && std::chrono::steady_clock::now() >= deadline) {
+          out_of_time = true;
+        }
+        if (out_of_time) {
+          break;
+        }
+        // Every other row of this grid is on the coarser one, and every
+        // other pixel along those rows is already traced
+        auto on_coarser_row = !first && y % (2 * spacing) == 0;
+        auto step = on_coarser_row ? 2 * spacing : spacing;
+        auto start = on_coarser_row ? spacing : 0;
+        for (int x = start; x < width; x += step) {
+          auto ray = camera.ray_for_pixel(x, y);
+          image.write_pixel(x, y, prepared.color_at(ray));
+          traced[static_cast<std::size_t>(y) * width + x] = 1;
+          ++count;
+        }
+      }
+      traced_count += count;
+    });
+
+    if (out_of_time) {
+      break;
+    }
+    finished = spacing;
+    if (spacing > 1) {
+      fill(image, traced, spacing, options.upsample, pool);
+    }
+    if (options.on_pass) {
+      options.on_pass(image, spacing);
+    }
+  }
+
+  if (finished > 1) {
+    // Fill around whatever the pass that ran out of time did trace
+    fill(image, traced, finished, options.upsample, pool);
+  }
+  return ProgressiveImage{std::move(image), finished, traced_count};
+}
+
+} // namespace raytrace
@@ -0,0 +1,106 @@
+#include "qoi.h"
+
+#include "big_endian.h"
+#include "canvas.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace raytrace {
+
+namespace {
+constexpr unsigned char op_index = 0x00;
+constexpr unsigned char op_diff = 0x40;
+constexpr unsigned char op_luma = 0x80;
+constexpr unsigned char op_run = 0xc0;
+constexpr unsigned char op_rgb = 0xfe;
+constexpr auto max_run = 62;
+
+// Alpha is kept, although every pixel written is opaque, so that the
+// table of recently seen pixels starts out as the decoder's does: all
+// zeros, matching nothing until a pixel has been stored
+struct Pixel {
+  unsigned char r;
+  unsigned char g;
+  unsigned char b;
+  unsigned char a;
+
+  friend auto operator==(Pixel lhs, Pixel rhs) -> bool {
+    return lhs.r == rhs.r && lhs.g == rhs.g && lhs.b == rhs.b &&
+           lhs.a == rhs.a;
+  }
+};
+
+// Where a pixel goes in the table of recently seen ones
+auto index_of(Pixel p) -> int {
+  return (p.r * 3 + p.g * 5 + p.b * 7 + p.a * 11) % 64;
+}
+
+} // namespace
+
+auto encode_qoi(Canvas const &image, Quantization const &quantization)
+    -> std::string {
+  auto out = std::string{"qoif"};
+  put_u32(out, static_cast<std::uint32_t>(image.width()));
+  put_u32(out, static_cast<std::uint32_t>(image.height()));
+  // RGB, sRGB
+  out.push_back(3);
+  out.push_back(0);
+
+  auto put = [&out](int byte) { out.push_back(static_cast<char>(byte)); };
+  Pixel seen[64] = {};
+  auto prev = Pixel{0, 0, 0, 255};
+  auto run = 0;
+  auto values = std::vector<unsigned char>{};
+  for (int y = 0; y < image.height(); ++y) {
+    quantize_row(image, y, values, quantization);
+    for (std::size_t i = 0; i < values.size(); i += 3) {
+      auto p = Pixel{values[i], values[i + 1], values[i + 2], 255};
+      if (p == prev) {
+        if (++run == max_run) {
+          put(op_run | (run - 1));
+          run = 0;
+        }
+        continue;
+      }
+      if (run > 0) {
+        put(op_run | (run - 1));
+        run = 0;
+      }
+
+      auto &slot = seen[index_of(p)];
+      if (slot == p) {
+        put(op_index | index_of(p));
+      } else {
+        slot = p;
+        // Differences wrap around, as the decoder's sums do
+        auto dr = static_cast<signed char>(p.r - prev.r);
+        auto dg = static_cast<signed char>(p.g - prev.g);
+        auto db = static_cast<signed char>(p.b - prev.b);
+        auto dr_dg = dr - dg;
+        auto db_dg = db - dg;
+        if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 &&
+            db <= 1) {
+          put(op_diff | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2));
+        } else if (dg >= -32 && dg <= 31 && dr_dg >= -8 && dr_dg <= 7 &&
+                   db_dg >= -8 && db_dg <= 7) {
+          put(op_luma | (dg + 32));
+          put((dr_dg + 8) << 4 | (db_dg + 8));
+        } else {
+          put(op_rgb);
+          put(p.r);
+          put(p.g);
+          put(p.b);
+        }
+      }
+      prev = p;
+    }
+  }
+  if (run > 0) {
+    put(op_run | (run - 1));
+  }
+  out.append("\0\0\0\0\0\0\0\1", 8);
+  return out;
+}
+
+} // namespace raytrace
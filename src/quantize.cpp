@@ -0,0 +1,153 @@
+#include "quantize.h"
+
+#include "canvas.h"
+#include "half.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define RAYTRACE_HAVE_SSE2 1
+#endif
+
+namespace raytrace {
+
+namespace {
+// Dither offsets repeat every 4 pixels along a row, which is 12 channels
+constexpr auto dither_period = std::size_t{12};
+
+constexpr int bayer[4][4] = {
+    {0, 8, 2, 10}, {12, 4, 14, 6}, {3, 11, 1, 9}, {15, 7, 13, 5}};
+
+// The sRGB curve sampled across linear [0, 1], scaled to 0-255, and looked
+// up with linear interpolation between samples
+constexpr auto srgb_samples = 4096;
+
+auto srgb_table() -> std::array<float, srgb_samples + 1> const & {
+  static auto const table = []() {
+    auto t = std::array<float, srgb_samples + 1>{};
+    for (int i = 0; i <= srgb_samples; ++i) {
+      auto linear = static_cast<double>(i) / srgb_samples;
+      auto encoded = linear <= 0.0031308
+                         ? 12.92 * linear
+                         : 1.055 * std::pow(linear, 1 / 2.4) - 0.055;
+      t[static_cast<std::size_t>(i)] = static_cast<float>(255 * encoded);
+    }
+    return t;
+  }();
+  return table;
+}
+
+// Channels are read with memcpy, as they're stored as bytes
+auto load(float const *channel) -> float {
+  auto f = 0.0f;
+  std::memcpy(&f, channel, sizeof f);
+  return f;
+}
+
+auto srgb_level(float linear) -> float {
+  auto const &table = srgb_table();
+  // Comparisons are written so NaN lands on 0
+  auto x = linear > 0.0f ? linear : 0.0f;
+  x = x < 1.0f ? x * srgb_samples : static_cast<float>(srgb_samples);
+  auto i = std::min(static_cast<int>(x), srgb_samples - 1);
+  auto f = x - static_cast<float>(i);
+  auto lo = table[static_cast<std::size_t>(i)];
+  return lo + (table[static_cast<std::size_t>(i) + 1] - lo) * f;
+}
+
+// Each of count channels times scale, less the dither offset for its
+// place in the row, rounded up and clamped to 0-255. A NaN comes out 0.
+void to_bytes(float const *channels, std::size_t count, float scale,
+              float const *offsets, unsigned char *out) {
+  auto i = std::size_t{0};
+#ifdef RAYTRACE_HAVE_SSE2
+  auto const k = _mm_set1_ps(scale);
+  auto const zero = _mm_setzero_ps();
+  auto const top = _mm_set1_ps(255.0f);
+  // Four channels at a time, rounded up as truncation plus one wherever
+  // truncating lost something. Clamping first keeps it in range.
+  auto four = [&](std::size_t at) {
+    auto v = _mm_mul_ps(_mm_loadu_ps(channels + at), k);
+    v = _mm_sub_ps(v, _mm_loadu_ps(offsets + at % dither_period));
+    v = _mm_min_ps(_mm_max_ps(v, zero), top);
+    auto t = _mm_cvttps_epi32(v);
+    auto below = _mm_cmplt_ps(_mm_cvtepi32_ps(t), v);
+    return _mm_sub_epi32(t, _mm_castps_si128(below));
+  };
+  for (; i + 16 <= count; i += 16) {
+    auto lo = _mm_packs_epi32(four(i), four(i + 4));
+    auto hi = _mm_packs_epi32(four(i + 8), four(i + 12));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i),
+                     _mm_packus_epi16(lo, hi));
+  }
+#endif
+  for (; i < count; ++i) {
+    auto v = load(channels + i) * scale - offsets[i % dither_period];
+    v = v > 0.0f ? v : 0.0f;
+    v = v < 255.0f ? v : 255.0f;
+    out[i] = static_cast<unsigned char>(std::ceil(v));
+  }
+}
+} // namespace
+
+void quantize_row(Canvas const &image, int y,
+                  std::vector<unsigned char> &values,
+                  Quantization const &quantization) {
+  auto width = static_cast<std::size_t>(image.width());
+  auto count = width * 3;
+  values.resize(count);
+  auto const *bytes = image.row(y);
+  switch (image.format()) {
+  case PixelFormat::rgb8:
+    std::copy(bytes, bytes + count, values.begin());
+    return;
+  case PixelFormat::rgba8:
+    for (std::size_t x = 0; x < width; ++x) {
+      std::copy(bytes + x * 4, bytes + x * 4 + 3, values.begin() + x * 3);
+    }
+    return;
+  default:
+    break;
+  }
+
+  // Float rows are used where they are; anything else is widened first
+  thread_local auto scratch = std::vector<float>{};
+  auto const *channels = reinterpret_cast<float const *>(bytes);
+  if (image.format() == PixelFormat::rgb_half) {
+    scratch.resize(count);
+    for (std::size_t i = 0; i < count; ++i) {
+      std::uint16_t h{};
+      std::memcpy(&h, bytes + i * sizeof h, sizeof h);
+      scratch[i] = from_half(h);
+    }
+    channels = scratch.data();
+  }
+
+  auto scale = std::exp2(quantization.exposure);
+  if (quantization.srgb) {
+    scratch.resize(count);
+    for (std::size_t i = 0; i < count; ++i) {
+      scratch[i] = srgb_level(load(channels + i) * scale);
+    }
+    channels = scratch.data();
+    scale = 1.0f;
+  } else {
+    scale *= 255.0f;
+  }
+
+  float offsets[dither_period] = {};
+  if (quantization.dither) {
+    for (std::size_t i = 0; i < dither_period; ++i) {
+      auto level = bayer[y % 4][i / 3];
+      offsets[i] = (static_cast<float>(level) + 0.5f) / 16;
+    }
+  }
+  to_bytes(channels, count, scale, offsets, values.data());
+}
+
+} // namespace raytrace
@@ -0,0 +1,93 @@
+#include "relight.h"
+
+#include "bits.h"
+
+#include <utility>
+
+namespace raytrace {
+
+auto render_gbuffer(Camera const &camera, World &world) -> GBuffer {
+  auto gbuffer = GBuffer{camera.h_size(), camera.v_size()};
+
+  for (int y = 0; y < camera.v_size(); ++y) {
+    for (int x = 0; x < camera.h_size(); ++x) {
+      auto ray = camera.ray_for_pixel(x, y);
+      auto xs = world.intersect(ray);
+      if (auto h = xs.hit()) {
+        gbuffer.set(x, y, PreComps{*h, ray});
+      }
+    }
+  }
+
+  return gbuffer;
+}
+
+auto shade_gbuffer(World &world, GBuffer const &gbuffer) -> Canvas {
+  auto image = Canvas{gbuffer.width(), gbuffer.height()};
+  world.commit();
+
+  for (int y = 0; y < gbuffer.height(); ++y) {
+    for (int x = 0; x < gbuffer.width(); ++x) {
+      if (auto const &hit = gbuffer.at(x, y)) {
+        image.write_pixel(x, y, world.shade_hit(*hit));
+      }
+    }
+  }
+
+  return image;
+}
+
+namespace {
+// Compared exactly, so a tiny move doesn't reuse hits cast for the old
+// position
+auto same_view(Camera const &lhs, Camera const &rhs) -> bool {
+  auto lt = lhs.transform();
+  auto rt = rhs.transform();
+  auto lf = lhs.fov();
+  auto rf = rhs.fov();
+  return lhs.h_size() == rhs.h_size() && lhs.v_size() == rhs.v_size() &&
+         same_bits(lf, rf) && same_bits(lt, rt);
+}
+} // namespace
+
+auto Relighter::shapes_of(World &world) -> std::vector<CastShape> {
+  auto shapes = std::vector<CastShape>{};
+  shapes.reserve(world.size());
+  for (Shape const &shape : world) {
+    shapes.push_back(CastShape{&shape, shape.id(), shape.transform()});
+  }
+  return shapes;
+}
+
+auto Relighter::can_reuse(World const &world,
+                          std::vector<CastShape> const &shapes) const
+    -> bool {
+  if (!gbuffer_ || !same_view(*gbuffer_camera_, camera_) ||
+      gbuffer_world_ != world.id() ||
+      gbuffer_shapes_.size() != shapes.size()) {
+    return false;
+  }
+  for (std::size_t i = 0; i < shapes.size(); ++i) {
+    auto const &was = gbuffer_shapes_[i];
+    auto const &now = shapes[i];
+    if (was.shape != now.shape || was.id != now.id ||
+        !same_bits(was.transform, now.transform)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+auto Relighter::render(World &world) -> Canvas {
+  auto shapes = shapes_of(world);
+  reused_ = can_reuse(world, shapes);
+  if (!reused_) {
+    gbuffer_ = render_gbuffer(camera_, world);
+    gbuffer_camera_ = camera_;
+    gbuffer_world_ = world.id();
+    gbuffer_shapes_ = std::move(shapes);
+  }
+  return shade_gbuffer(world, *gbuffer_);
+}
+
+} // namespace raytrace
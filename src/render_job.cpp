@@ -0,0 +1,166 @@
+#include "render_job.h"
+
+#include "bounded_queue.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+namespace raytrace {
+
+struct RenderJob::State {
+  State(Camera const &camera, World &world, TileCallback on_tile,
+        std::size_t tiles)
+      : camera(camera), world(world), on_tile(std::move(on_tile)),
+        image(camera.h_size(), camera.v_size()), tiles(tiles),
+        rendered(std::max<std::size_t>(tiles, 1)) {
+    if (this->on_tile) {
+      dispatcher = std::thread([this]() { dispatch(); });
+    }
+  }
+
+  // The dispatcher only stops once the queue is closed, which happens when
+  // the last tile task ends, or here if the tasks never all ran
+  ~State() {
+    rendered.close();
+    if (dispatcher.joinable()) {
+      dispatcher.join();
+    }
+  }
+
+  Camera camera;
+  World &world;
+  TileCallback on_tile;
+  Canvas image;
+  std::size_t tiles;
+
+  std::atomic<bool> cancelled{false};
+  std::atomic<std::size_t> completed{0};
+
+  std::mutex mutex;
+  std::condition_variable finished_all;
+  std::size_t finished{0};
+  std::exception_ptr error;
+
+  // Rendered tiles waiting for their callback. It has room for every tile,
+  // so a worker never waits on the consumer.
+  BoundedQueue<Tile> rendered;
+  std::atomic<std::size_t> ended{0};
+  std::thread dispatcher;
+
+  // Keep the first exception for wait() and stop the rest of the render
+  void fail() {
+    cancelled = true;
+    auto lock = std::lock_guard{mutex};
+    if (!error) {
+      error = std::current_exception();
+    }
+  }
+
+  // The tile counts as finished however it ends, or wait() would never
+  // return
+  void finish() {
+    {
+      auto lock = std::lock_guard{mutex};
+      ++finished;
+    }
+    finished_all.notify_all();
+  }
+
+  // A rendered tile is finished by the dispatcher once its callback has
+  // run; anything else is finished here
+  void run(Tile tile) {
+    auto handed_off = false;
+    if (!cancelled) {
+      try {
+        camera.render_tile(world, image, tile);
+        ++completed;
+        handed_off = on_tile && rendered.push(tile);
+      } catch (...) {
+        fail();
+      }
+    }
+    if (!handed_off) {
+      finish();
+    }
+    if (++ended == tiles) {
+      rendered.close();
+    }
+  }
+
+  // Runs the callbacks one at a time on a thread of its own, so a slow
+  // consumer holds up only itself and wait(), not the pool
+  void dispatch() {
+    while (auto tile = rendered.pop()) {
+      if (!cancelled) {
+        try {
+          on_tile(*tile, image);
+        } catch (...) {
+          fail();
+        }
+      }
+      finish();
+    }
+  }
+};
+
+RenderJob::~RenderJob() {
+  if (state_) {
+    cancel();
+    auto lock = std::unique_lock{state_->mutex};
+    state_->finished_all.wait(
+        lock, [this]() { return state_->finished == state_->tiles; });
+  }
+}
+
+auto RenderJob::state() const -> State & {
+  if (!state_) {
+    throw std::logic_error("Render job has been moved from");
+  }
+  return *state_;
+}
+
+auto RenderJob::wait() -> Canvas const & {
+  auto &s = state();
+  auto lock = std::unique_lock{s.mutex};
+  s.finished_all.wait(lock, [&s]() { return s.finished == s.tiles; });
+  if (s.error) {
+    std::rethrow_exception(s.error);
+  }
+  return s.image;
+}
+
+void RenderJob::cancel() { state().cancelled = true; }
+
+auto RenderJob::cancelled() const -> bool { return state().cancelled; }
+
+auto RenderJob::done() const -> bool {
+  auto &s = state();
+  auto lock = std::lock_guard{s.mutex};
+  return s.finished == s.tiles;
+}
+
+auto RenderJob::tiles_completed() const -> std::size_t {
+  return state().completed;
+}
+
+auto RenderJob::tile_count() const -> std::size_t { return state().tiles; }
+
+auto render_async(Camera const &camera, World &world, ThreadPool &pool,
+                  TileCallback on_tile, int tile_size) -> RenderJob {
+  auto tiles = camera.tiles(tile_size);
+  world.commit();
+  auto state = std::make_shared<RenderJob::State>(camera, world,
+                                                  std::move(on_tile),
+                                                  tiles.size());
+  for (auto tile : tiles) {
+    pool.submit([state, tile]() { state->run(tile); });
+  }
+  return RenderJob{std::move(state)};
+}
+
+} // namespace raytrace
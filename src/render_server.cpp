@@ -0,0 +1,176 @@
+#include "render_server.h"
+
+#include "canvas.h"
+#include "elapsed.h"
+#include "transformations.h"
+
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace raytrace {
+
+namespace {
+using std::chrono::steady_clock;
+
+enum class LineRead { line, end, too_long };
+
+// Read a line into line, giving up once it's longer than max_length
+// rather than buffering whatever the client sends
+auto read_line(std::istream &is, std::string &line, std::size_t max_length)
+    -> LineRead {
+  line.clear();
+  using traits = std::istream::traits_type;
+  for (auto c = is.get(); !traits::eq_int_type(c, traits::eof());
+       c = is.get()) {
+    if (traits::to_char_type(c) == '\n') {
+      return LineRead::line;
+    }
+    if (line.size() == max_length) {
+      return LineRead::too_long;
+    }
+    line.push_back(traits::to_char_type(c));
+  }
+  return line.empty() ? LineRead::end : LineRead::line;
+}
+
+void check_size(int width, int height) {
+  if (width <= 0 || height <= 0) {
+    throw std::invalid_argument("width and height must be greater than zero");
+  }
+  if (width > RenderRequest::max_dimension ||
+      height > RenderRequest::max_dimension ||
+      static_cast<long long>(width) * height > RenderRequest::max_pixels) {
+    throw std::invalid_argument(
+        "image is bigger than " + std::to_string(RenderRequest::max_pixels) +
+        " pixels or " + std::to_string(RenderRequest::max_dimension) +
+        " across");
+  }
+}
+} // namespace
+
+auto RenderRequest::camera() const -> Camera {
+  auto c = Camera{width, height, fov};
+  c.transform(view_transform(from, to, up));
+  return c;
+}
+
+auto parse_render_request(std::string const &args) -> RenderRequest {
+  auto is = std::istringstream{args};
+  auto r = RenderRequest{};
+  if (!(is >> r.width >> r.height >> r.from.x >> r.from.y >> r.from.z >>
+        r.to.x >> r.to.y >> r.to.z >> r.up.x >> r.up.y >> r.up.z >> r.fov)) {
+    throw std::invalid_argument(
+        "render expects width height from.xyz to.xyz up.xyz fov");
+  }
+  check_size(r.width, r.height);
+  return r;
+}
+
+RenderServer::RenderServer(World world, ThreadPool &pool,
+                           unsigned max_concurrent)
+    : world_(std::move(world)), pool_(pool),
+      max_concurrent_(std::max(1u, max_concurrent)) {
+  world_.commit();
+}
+
+RenderServer::Slot::Slot(RenderServer &server) : server_(server) {
+  auto lock = std::unique_lock{server_.mutex_};
+  server_.slot_free_.wait(
+      lock, [this]() { return server_.active_ < server_.max_concurrent_; });
+  ++server_.active_;
+}
+
+RenderServer::Slot::~Slot() {
+  {
+    auto lock = std::lock_guard{server_.mutex_};
+    --server_.active_;
+  }
+  server_.slot_free_.notify_one();
+}
+
+auto RenderServer::render(RenderRequest const &request) -> RenderResponse {
+  check_size(request.width, request.height);
+  auto camera = request.camera();
+  auto begin = steady_clock::now();
+  // Only bytes go out, so quantize as each pixel is written
+  auto image = Canvas{request.width, request.height, PixelFormat::rgb8};
+  auto started = begin;
+  {
+    auto slot = Slot{*this};
+    started = steady_clock::now();
+
+    World const &world = world_;
+    auto done = std::vector<std::future<void>>{};
+    try {
+      for (auto tile : camera.tiles()) {
+        done.push_back(pool_.submit([&camera, &world, &image, tile]() {
+          camera.render_tile(world, image, tile);
+        }));
+      }
+    } catch (...) {
+      wait_all(done);
+      throw;
+    }
+    wait_all(done);
+  }
+  auto rendered = steady_clock::now();
+
+  auto response = RenderResponse{image.to_ppm_binary(), RenderTiming{}};
+  auto encoded = steady_clock::now();
+
+  response.timing = RenderTiming{ms_between(begin, started),
+                                 ms_between(started, rendered),
+                                 ms_between(rendered, encoded)};
+  return response;
+}
+
+void RenderServer::serve(std::istream &is, std::ostream &os) {
+  auto line = std::string{};
+  // A client that has gone away ends the session
+  while (os) {
+    auto read = read_line(is, line, max_line_length);
+    if (read == LineRead::end) {
+      break;
+    }
+    if (read == LineRead::too_long) {
+      os << "error request line too long\n" << std::flush;
+      break;
+    }
+    auto command = std::string{};
+    auto words = std::istringstream{line};
+    words >> command;
+    if (command.empty()) {
+      continue;
+    }
+    if (command == "quit") {
+      break;
+    }
+    if (command != "render") {
+      os << "error unknown command " << command << "\n" << std::flush;
+      continue;
+    }
+
+    try {
+      auto rest = std::string{};
+      std::getline(words, rest);
+      auto request = parse_render_request(rest);
+      auto response = render(request);
+      os << "image " << request.width << " " << request.height << " "
+         << response.image.size() << " " << response.timing.queued << " "
+         << response.timing.rendered << " " << response.timing.encoded
+         << "\n";
+      os.write(response.image.data(),
+               static_cast<std::streamsize>(response.image.size()));
+      os.flush();
+    } catch (std::exception const &e) {
+      os << "error " << e.what() << "\n" << std::flush;
+    }
+  }
+}
+
+} // namespace raytrace
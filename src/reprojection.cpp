@@ -0,0 +1,126 @@
+#include "reprojection.h"
+
+#include <algorithm>
+#include <cmath>
+#include <future>
+#include <limits>
+
+namespace raytrace {
+
+namespace {
+void trace(Camera const &camera, World const &world, FrameHistory &history,
+           int x, int y) {
+  auto ray = camera.ray_for_pixel(x, y);
+  auto xs = world.intersect(ray);
+  auto h = xs.hit();
+  if (!h) {
+    history.record(x, y, colors::black, FrameHistory::no_shape, Point{});
+    return;
+  }
+  history.record(x, y, world.shade_hit(PreComps{*h, ray}), h->object->id(),
+                 ray.position(h->t));
+}
+} // namespace
+
+auto render_history(Camera const &camera, World &world, ThreadPool &pool)
+    -> FrameHistory {
+  auto history = FrameHistory{camera.h_size(), camera.v_size()};
+  world.commit();
+  World const &prepared = world;
+
+  for_each_band(pool, camera.v_size(), [&](int y0, int y1) {
+    for (int y = y0; y < y1; ++y) {
+      for (int x = 0; x < camera.h_size(); ++x) {
+        trace(camera, prepared, history, x, y);
+      }
+    }
+  });
+
+  auto pixels = static_cast<std::size_t>(camera.h_size()) * camera.v_size();
+  history.stats(ReprojectionStats{0, pixels, pixels});
+  history.snapshot(world.snapshot());
+  return history;
+}
+
+auto render_reprojected(Camera const &camera, World &world,
+                        FrameHistory const &previous, ThreadPool &pool,
+                        float tolerance) -> FrameHistory {
+  if (world.lights_changed(previous.snapshot()) ||
+      !world.changed_shapes(previous.snapshot()).empty()) {
+    return render_history(camera, world, pool);
+  }
+
+  auto width = camera.h_size();
+  auto height = camera.v_size();
+  auto history = FrameHistory{width, height};
+  world.commit();
+
+  // Scatter the previous frame's hits into the new one, keeping the
+  // nearest where several land on the same pixel
+  constexpr auto none = std::numeric_limits<std::size_t>::max();
+  auto pixels = static_cast<std::size_t>(width) * height;
+  auto candidates = std::vector<std::size_t>(pixels, none);
+  auto depths =
+      std::vector<float>(pixels, std::numeric_limits<float>::infinity());
+  for (int y = 0; y < previous.height(); ++y) {
+    for (int x = 0; x < previous.width(); ++x) {
+      if (previous.shape_id(x, y) == FrameHistory::no_shape) {
+        continue;
+      }
+      auto p = camera.project(previous.position(x, y));
+      if (!p || p->x < 0 || p->y < 0 || p->x >= width || p->y >= height) {
+        continue;
+      }
+      auto i = static_cast<std::size_t>(p->x) +
+               static_cast<std::size_t>(p->y) * width;
+      if (p->depth < depths[i]) {
+        depths[i] = p->depth;
+        candidates[i] = x + static_cast<std::size_t>(y) * previous.width();
+      }
+    }
+  }
+
+  World const &prepared = world;
+  auto reused = std::vector<int>(static_cast<std::size_t>(height), 0);
+  for_each_band(pool, height, [&](int y0, int y1) {
+    for (int y = y0; y < y1; ++y) {
+      for (int x = 0; x < width; ++x) {
+        auto i = x + static_cast<std::size_t>(y) * width;
+        if (candidates[i] != none) {
+          auto px = static_cast<int>(candidates[i] % previous.width());
+          auto py = static_cast<int>(candidates[i] / previous.width());
+          auto id = previous.shape_id(px, py);
+          auto position = previous.position(px, py);
+
+          // The pixel's own ray has to see the same shape first; checking
+          // against just that shape would miss a nearer one that has come
+          // into view in front of it
+          auto ray = camera.ray_for_pixel(x, y);
+          auto xs = prepared.intersect(ray);
+          auto h = xs.hit();
+          if (h && h->object->id() == id) {
+            auto hit_point = ray.position(h->t);
+            auto limit = tolerance * camera.pixel_size() * depths[i];
+            if ((hit_point - position).magnitude() <= limit) {
+              history.record(x, y, previous.color(px, py), id, hit_point);
+              ++reused[static_cast<std::size_t>(y)];
+              continue;
+            }
+          }
+        }
+        trace(camera, prepared, history, x, y);
+      }
+    }
+  });
+
+  auto total_reused = std::size_t{0};
+  for (auto r : reused) {
+    total_reused += static_cast<std::size_t>(r);
+  }
+  history.stats(
+      ReprojectionStats{total_reused, pixels - total_reused, pixels});
+  history.snapshot(world.snapshot());
+  return history;
+}
+
+} // namespace raytrace
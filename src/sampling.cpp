@@ -0,0 +1,74 @@
+#include "sampling.h"
+
+#include "bits.h"
+
+#include <numeric>
+
+namespace raytrace {
+
+namespace {
+auto mix(std::uint64_t h) -> std::uint64_t {
+  // splitmix64 finalizer
+  h ^= h >> 30;
+  h *= 0xbf58476d1ce4e5b9ULL;
+  h ^= h >> 27;
+  h *= 0x94d049bb133111ebULL;
+  h ^= h >> 31;
+  return h;
+}
+} // namespace
+
+auto seed_for(Point p) -> std::uint64_t {
+  auto h = mix(bits_of(p.x));
+  h = mix(h ^ bits_of(p.y));
+  return mix(h ^ bits_of(p.z));
+}
+
+AliasTable::AliasTable(std::vector<float> const &weights) {
+  auto total = std::accumulate(weights.begin(), weights.end(), 0.0);
+  if (weights.empty() || !(total > 0)) {
+    return;
+  }
+
+  auto n = weights.size();
+  probabilities_.resize(n);
+  thresholds_.resize(n);
+  aliases_.resize(n);
+
+  // Scale so the average bucket holds exactly 1, then pair each under-full
+  // bucket with an over-full one that tops it up.
+  auto scaled = std::vector<double>(n);
+  auto small = std::vector<std::size_t>{};
+  auto large = std::vector<std::size_t>{};
+  for (std::size_t i = 0; i < n; ++i) {
+    probabilities_[i] = static_cast<float>(weights[i] / total);
+    scaled[i] = weights[i] * n / total;
+    (scaled[i] < 1.0 ? small : large).push_back(i);
+  }
+
+  while (!small.empty() && !large.empty()) {
+    auto s = small.back();
+    small.pop_back();
+    auto l = large.back();
+
+    thresholds_[s] = static_cast<float>(scaled[s]);
+    aliases_[s] = l;
+    scaled[l] -= 1.0 - scaled[s];
+    if (scaled[l] < 1.0) {
+      large.pop_back();
+      small.push_back(l);
+    }
+  }
+
+  // Whatever is left is full, give or take rounding error
+  for (auto i : large) {
+    thresholds_[i] = 1.0f;
+    aliases_[i] = i;
+  }
+  for (auto i : small) {
+    thresholds_[i] = 1.0f;
+    aliases_[i] = i;
+  }
+}
+
+} // namespace raytrace
@@ -0,0 +1,302 @@
+#include "shared_framebuffer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <future>
+#include <limits>
+#include <new>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#define RAYTRACE_HAVE_SHM 1
+#endif
+
+namespace raytrace {
+
+namespace {
+constexpr char magic[8] = {'R', 'T', 'F', 'R', 'A', 'M', 'E', '1'};
+// Pixels start on a cache line of their own
+constexpr auto pixel_alignment = std::size_t{64};
+
+using Generation = std::atomic<std::uint32_t>;
+static_assert(Generation::is_always_lock_free,
+              "generation counters must work across processes");
+
+auto generations_offset() -> std::size_t {
+  return sizeof(FramebufferHeader);
+}
+
+auto tiles_along(int size, int tile_size) -> std::uint32_t {
+  return static_cast<std::uint32_t>((size + tile_size - 1) / tile_size);
+}
+
+// Whether header describes a framebuffer that fits in a segment of size
+// bytes. Everything is checked before it's used, and without overflow,
+// since the header comes from another process.
+auto valid_header(FramebufferHeader const &header, std::size_t size)
+    -> bool {
+  constexpr auto int_max =
+      static_cast<std::uint64_t>(std::numeric_limits<int>::max());
+  if (std::memcmp(header.magic, magic, sizeof magic) != 0 ||
+      header.width == 0 || header.width > int_max || header.height == 0 ||
+      header.height > int_max || header.tile_size == 0 ||
+      header.tile_size > int_max ||
+      header.format > static_cast<std::uint32_t>(PixelFormat::rgb_half)) {
+    return false;
+  }
+  auto along = [&header](std::uint64_t length) {
+    return (length + header.tile_size - 1) / header.tile_size;
+  };
+  auto format = static_cast<PixelFormat>(header.format);
+  if (header.tiles_across != along(header.width) ||
+      header.tiles_down != along(header.height) ||
+      header.stride != std::uint64_t{header.width} * pixel_size(format)) {
+    return false;
+  }
+  // The generation counters come before the pixels, which fill the rest
+  if (size < generations_offset()) {
+    return false;
+  }
+  auto tiles = std::uint64_t{header.tiles_across} * header.tiles_down;
+  if (tiles > (size - generations_offset()) / sizeof(Generation)) {
+    return false;
+  }
+  auto counters_end = generations_offset() + tiles * sizeof(Generation);
+  return header.pixel_offset >= counters_end &&
+         header.pixel_offset % pixel_alignment == 0 &&
+         header.pixel_offset <= size &&
+         header.height <= (size - header.pixel_offset) / header.stride;
+}
+
+// Brackets writing a tile, so its generation is even again however the
+// write ends
+class TileWrite {
+public:
+  TileWrite(SharedFramebuffer &framebuffer, std::size_t index)
+      : framebuffer_(framebuffer), index_(index) {
+    framebuffer_.begin_write(index_);
+  }
+  ~TileWrite() { framebuffer_.end_write(index_); }
+
+  TileWrite(TileWrite const &) = delete;
+  auto operator=(TileWrite const &) -> TileWrite & = delete;
+
+private:
+  SharedFramebuffer &framebuffer_;
+  std::size_t index_;
+};
+
+#ifdef RAYTRACE_HAVE_SHM
+// error is taken as an argument so that it can be saved before close()
+// has the chance to overwrite errno
+auto failure(char const *what, std::string const &name, int error)
+    -> std::runtime_error {
+  return std::runtime_error(std::string{what} + " " + name + ": " +
+                            std::strerror(error));
+}
+
+// Map size bytes of the open segment fd, closing fd
+auto map_segment(int fd, std::size_t size, int protection,
+                 std::string const &name) -> std::shared_ptr<void> {
+  auto *base = ::mmap(nullptr, size, protection, MAP_SHARED, fd, 0);
+  auto error = errno;
+  ::close(fd);
+  if (base == MAP_FAILED) {
+    throw failure("Can't map", name, error);
+  }
+  return std::shared_ptr<void>(base,
+                               [size](void *p) { ::munmap(p, size); });
+}
+#endif
+} // namespace
+
+SharedFramebuffer::SharedFramebuffer(std::shared_ptr<void> mapping,
+                                     std::shared_ptr<void> name)
+    : mapping_(std::move(mapping)), name_(std::move(name)),
+      header_(static_cast<FramebufferHeader const *>(mapping_.get())),
+      generations_(reinterpret_cast<Generation *>(
+          static_cast<unsigned char *>(mapping_.get()) +
+          generations_offset())),
+      canvas_(static_cast<int>(header_->width),
+              static_cast<int>(header_->height),
+              static_cast<PixelFormat>(header_->format),
+              static_cast<unsigned char *>(mapping_.get()) +
+                  header_->pixel_offset,
+              static_cast<std::ptrdiff_t>(header_->stride), mapping_) {}
+
+auto SharedFramebuffer::create(std::string const &name, int width,
+                               int height, PixelFormat format, int tile_size)
+    -> SharedFramebuffer {
+  if (width <= 0 || height <= 0) {
+    throw std::out_of_range("height and width must be greater than zero");
+  }
+  if (tile_size <= 0) {
+    throw std::invalid_argument("Tile size must be greater than zero");
+  }
+  auto header = FramebufferHeader{};
+  std::memcpy(header.magic, magic, sizeof magic);
+  header.width = static_cast<std::uint32_t>(width);
+  header.height = static_cast<std::uint32_t>(height);
+  header.format = static_cast<std::uint32_t>(format);
+  header.tile_size = static_cast<std::uint32_t>(tile_size);
+  header.tiles_across = tiles_along(width, tile_size);
+  header.tiles_down = tiles_along(height, tile_size);
+  header.stride = static_cast<std::uint64_t>(width) * pixel_size(format);
+  auto tiles = std::size_t{header.tiles_across} * header.tiles_down;
+  auto counters_end = generations_offset() + tiles * sizeof(Generation);
+  header.pixel_offset = (counters_end + pixel_alignment - 1) /
+                        pixel_alignment * pixel_alignment;
+  auto size = header.pixel_offset + header.stride * header.height;
+
+#ifdef RAYTRACE_HAVE_SHM
+  ::shm_unlink(name.c_str());
+  auto fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+  if (fd < 0) {
+    throw failure("Can't create", name, errno);
+  }
+  auto unlink = std::shared_ptr<void>(
+      nullptr, [name](void *) { ::shm_unlink(name.c_str()); });
+  if (::ftruncate(fd, static_cast<off_t>(size)) != 0) {
+    auto error = failure("Can't size", name, errno);
+    ::close(fd);
+    throw error;
+  }
+  auto mapping = map_segment(fd, size, PROT_READ | PROT_WRITE, name);
+
+  auto *base = static_cast<unsigned char *>(mapping.get());
+  std::memcpy(base, &header, sizeof header);
+  auto *counters = base + generations_offset();
+  for (std::size_t i = 0; i < tiles; ++i) {
+    new (counters + i * sizeof(Generation)) Generation{0};
+  }
+  return SharedFramebuffer{std::move(mapping), std::move(unlink)};
+#else
+  (void)size;
+  throw std::runtime_error("Can't create " + name +
+                           ": shared memory isn't supported here");
+#endif
+}
+
+auto SharedFramebuffer::open(std::string const &name) -> SharedFramebuffer {
+#ifdef RAYTRACE_HAVE_SHM
+  auto fd = ::shm_open(name.c_str(), O_RDONLY, 0);
+  if (fd < 0) {
+    throw failure("Can't open", name, errno);
+  }
+  struct stat info {};
+  if (::fstat(fd, &info) != 0) {
+    auto error = failure("Can't size", name, errno);
+    ::close(fd);
+    throw error;
+  }
+  auto size = static_cast<std::size_t>(info.st_size);
+  auto header = FramebufferHeader{};
+  if (size < sizeof header ||
+      ::pread(fd, &header, sizeof header, 0) !=
+          static_cast<ssize_t>(sizeof header) ||
+      !valid_header(header, size)) {
+    ::close(fd);
+    throw std::runtime_error(name + " isn't a framebuffer");
+  }
+  return SharedFramebuffer{map_segment(fd, size, PROT_READ, name), nullptr};
+#else
+  throw std::runtime_error("Can't open " + name +
+                           ": shared memory isn't supported here");
+#endif
+}
+
+auto SharedFramebuffer::tile_count() const -> std::size_t {
+  return std::size_t{header_->tiles_across} * header_->tiles_down;
+}
+
+auto SharedFramebuffer::tile(std::size_t index) const -> Tile {
+  auto size = static_cast<int>(header_->tile_size);
+  auto x = static_cast<int>(index % header_->tiles_across) * size;
+  auto y = static_cast<int>(index / header_->tiles_across) * size;
+  return Tile{x, y, std::min(size, canvas_.width() - x),
+              std::min(size, canvas_.height() - y)};
+}
+
+auto SharedFramebuffer::tile_index(int x, int y) const -> std::size_t {
+  auto size = static_cast<int>(header_->tile_size);
+  return static_cast<std::size_t>(y / size) * header_->tiles_across +
+         static_cast<std::size_t>(x / size);
+}
+
+auto SharedFramebuffer::generation(std::size_t index) const
+    -> std::uint32_t {
+  return generations_[index].load(std::memory_order_acquire);
+}
+
+// A sequence lock: odd while the pixels are being written, so a reader
+// that sees the same even generation before and after copying them knows
+// the copy is whole
+void SharedFramebuffer::begin_write(std::size_t index) {
+  auto &g = generations_[index];
+  g.store(g.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+}
+
+void SharedFramebuffer::end_write(std::size_t index) {
+  auto &g = generations_[index];
+  g.store(g.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+auto SharedFramebuffer::read_tile(std::size_t index, Canvas &image) const
+    -> bool {
+  auto before = generation(index);
+  auto t = tile(index);
+  // The same format is copied a row of the tile at a time
+  auto same = image.format() == canvas_.format();
+  auto bytes = pixel_size(image.format());
+  auto row_bytes = static_cast<std::size_t>(t.width) * bytes;
+  auto offset = static_cast<std::size_t>(t.x) * bytes;
+  for (int y = t.y; y < t.y + t.height; ++y) {
+    if (same) {
+      std::memcpy(image.row(y) + offset, canvas_.row(y) + offset, row_bytes);
+    } else {
+      for (int x = t.x; x < t.x + t.width; ++x) {
+        image.write_pixel(x, y, canvas_.pixel_at(x, y));
+      }
+    }
+  }
+  std::atomic_thread_fence(std::memory_order_acquire);
+  auto after = generations_[index].load(std::memory_order_relaxed);
+  return before % 2 == 0 && before == after;
+}
+
+void render_shared(Camera const &camera, World &world, ThreadPool &pool,
+                   SharedFramebuffer &framebuffer) {
+  if (camera.h_size() != framebuffer.canvas().width() ||
+      camera.v_size() != framebuffer.canvas().height()) {
+    throw std::invalid_argument("Camera and framebuffer sizes differ");
+  }
+  world.commit();
+  World const &prepared = world;
+  auto done = std::vector<std::future<void>>{};
+  // Every task has to finish before an exception leaves, as they all
+  // refer to the world and the framebuffer
+  try {
+    for (std::size_t i = 0; i < framebuffer.tile_count(); ++i) {
+      done.push_back(pool.submit([&, i]() {
+        auto writing = TileWrite{framebuffer, i};
+        camera.render_tile(prepared, framebuffer.canvas(),
+                           framebuffer.tile(i));
+      }));
+    }
+  } catch (...) {
+    wait_all(done);
+    throw;
+  }
+  wait_all(done);
+}
+
+} // namespace raytrace
@@ -0,0 +1,194 @@
+#include "streaming.h"
+
+#include "bounded_queue.h"
+#include "canvas.h"
+#include "elapsed.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <deque>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace raytrace {
+
+namespace {
+using std::chrono::steady_clock;
+
+// Rows [y0, y0 + rows) of the image
+struct Band {
+  int y0;
+  int rows;
+  Canvas pixels;
+};
+
+// A band and the rows of it still being rendered
+struct BandInFlight {
+  Band band;
+  std::vector<std::future<void>> rows;
+};
+
+// Start rendering rows [y0, y0 + rows) of the image into pixels, a row per
+// task
+auto start_rows(Camera const &camera, World const &world, ThreadPool &pool,
+                Canvas &pixels, int y0, int rows)
+    -> std::vector<std::future<void>> {
+  auto done = std::vector<std::future<void>>{};
+  for (int y = y0; y < y0 + rows; ++y) {
+    done.push_back(pool.submit([&camera, &world, &pixels, y, y0]() {
+      for (int x = 0; x < camera.h_size(); ++x) {
+        pixels.write_pixel(x, y - y0,
+                           world.color_at(camera.ray_for_pixel(x, y)));
+      }
+    }));
+  }
+  return done;
+}
+} // namespace
+
+void render_to_stream(Camera const &camera, World &world, ThreadPool &pool,
+                      std::ostream &os, StreamOptions const &options) {
+  if (options.band_height <= 0) {
+    throw std::invalid_argument("Band height must be greater than zero");
+  }
+  auto width = camera.h_size();
+  auto height = camera.v_size();
+  auto band_height = std::min(options.band_height, height);
+
+  world.commit();
+  World const &prepared = world;
+
+  auto bands = std::array<Canvas, 2>{Canvas{width, band_height},
+                                     Canvas{width, band_height}};
+  auto rendering = std::array<std::vector<std::future<void>>, 2>{};
+
+  // Start rendering the band that begins at image row y0 into bands[i]
+  auto start_band = [&](std::size_t i, int y0) {
+    if (y0 < height) {
+      rendering[i] = start_rows(camera, prepared, pool, bands[i], y0,
+                                std::min(band_height, height - y0));
+    }
+  };
+
+  auto out = ppm_header(options.format, width, height);
+  os.write(out.data(), static_cast<std::streamsize>(out.size()));
+
+  try {
+    // Both bands are queued from the start, so the pool works on the next
+    // band's rows while the last rows of this one finish and it's written
+    start_band(0, 0);
+    start_band(1, band_height);
+    for (int y0 = 0, current = 0; y0 < height;
+         y0 += band_height, current = 1 - current) {
+      for (auto &row : rendering[current]) {
+        row.get();
+      }
+      rendering[current].clear();
+
+      out.clear();
+      append_ppm_rows(out, options.format, bands[current], 0,
+                      std::min(band_height, height - y0),
+                      options.quantization);
+      os.write(out.data(), static_cast<std::streamsize>(out.size()));
+      start_band(current, y0 + 2 * band_height);
+    }
+  } catch (...) {
+    settle(rendering[0]);
+    settle(rendering[1]);
+    throw;
+  }
+  os.flush();
+}
+
+auto render_pipelined(Camera const &camera, World &world, ThreadPool &pool,
+                      std::ostream &os, StreamOptions const &options)
+    -> PipelineTiming {
+  if (options.band_height <= 0 || options.queue_depth <= 0) {
+    throw std::invalid_argument(
+        "Band height and queue depth must be greater than zero");
+  }
+  auto begin = steady_clock::now();
+  auto width = camera.h_size();
+  auto height = camera.v_size();
+  auto band_height = std::min(options.band_height, height);
+  auto depth = static_cast<std::size_t>(options.queue_depth);
+  auto timing = PipelineTiming{};
+
+  world.commit();
+  World const &prepared = world;
+
+  // Band canvases go round from the renderer to the encoder and back
+  auto free_bands = BoundedQueue<Band>{depth};
+  auto to_encode = BoundedQueue<Band>{depth};
+  auto to_write = BoundedQueue<std::string>{depth};
+  for (std::size_t i = 0; i < depth; ++i) {
+    free_bands.push(Band{0, 0, Canvas{width, band_height}});
+  }
+
+  auto encoder = std::thread([&]() {
+    while (auto band = to_encode.pop()) {
+      auto out = std::string{};
+      append_ppm_rows(out, options.format, band->pixels, 0, band->rows,
+                      options.quantization);
+      free_bands.push(std::move(*band));
+      to_write.push(std::move(out));
+    }
+    timing.encoded = ms_between(begin, steady_clock::now());
+    to_write.close();
+  });
+
+  auto writer = std::thread([&]() {
+    auto header = ppm_header(options.format, width, height);
+    os.write(header.data(), static_cast<std::streamsize>(header.size()));
+    while (auto chunk = to_write.pop()) {
+      os.write(chunk->data(), static_cast<std::streamsize>(chunk->size()));
+    }
+    os.flush();
+    timing.written = ms_between(begin, steady_clock::now());
+  });
+
+  auto finish = [&]() {
+    to_encode.close();
+    encoder.join();
+    writer.join();
+  };
+
+  // Bands being rendered, oldest first. Up to depth of them are queued on
+  // the pool at once, so it moves straight on to the next band's rows
+  // rather than idling while the last rows of a band finish.
+  auto rendering = std::deque<BandInFlight>{};
+  try {
+    auto next_y0 = 0;
+    while (next_y0 < height || !rendering.empty()) {
+      while (next_y0 < height && rendering.size() < depth) {
+        auto &next =
+            rendering.emplace_back(BandInFlight{*free_bands.pop(), {}});
+        next.band.y0 = next_y0;
+        next.band.rows = std::min(band_height, height - next_y0);
+        next.rows = start_rows(camera, prepared, pool, next.band.pixels,
+                               next.band.y0, next.band.rows);
+        next_y0 += band_height;
+      }
+      for (auto &row : rendering.front().rows) {
+        row.get();
+      }
+      to_encode.push(std::move(rendering.front().band));
+      rendering.pop_front();
+    }
+  } catch (...) {
+    for (auto &in_flight : rendering) {
+      settle(in_flight.rows);
+    }
+    finish();
+    throw;
+  }
+  timing.rendered = ms_between(begin, steady_clock::now());
+  finish();
+  return timing;
+}
+
+} // namespace raytrace
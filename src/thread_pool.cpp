@@ -0,0 +1,45 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+
+namespace raytrace {
+
+ThreadPool::ThreadPool(unsigned threads) {
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  workers_.reserve(threads);
+  for (unsigned i = 0; i < threads; ++i) {
+    workers_.emplace_back([this]() { work(); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    auto lock = std::lock_guard{mutex_};
+    stopping_ = true;
+  }
+  ready_.notify_all();
+  for (auto &worker : workers_) {
+    worker.join();
+  }
+}
+
+void ThreadPool::work() {
+  for (;;) {
+    auto task = std::function<void()>{};
+    {
+      auto lock = std::unique_lock{mutex_};
+      ready_.wait(lock, [this]() { return stopping_ || !tasks_.empty(); });
+      // Finish whatever was submitted before stopping
+      if (tasks_.empty()) {
+        return;
+      }
+      task = std::move(tasks_.front());
+      tasks_.pop();
+    }
+    task();
+  }
+}
+
+} // namespace raytrace
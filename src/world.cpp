@@ -1,9 +1,12 @@
 #include "world.h"
 
+#include "bits.h"
 #include "ray.h"
 #include "shape.h"
 #include "sphere.h"
 
+#include <algorithm>
+#include <atomic>
 #include <memory>
 #include <numeric>
 
@@ -15,10 +18,201 @@ auto World::intersect(Ray r) const -> Intersections {
       [&r](auto &xs, auto &obj) { return obj->intersect(r, xs); });
 }
 
+namespace {
+auto has_energy(Color c) -> bool { return c.r > 0 || c.g > 0 || c.b > 0; }
+
+// 0 is left for shapes that no world has committed
+std::atomic<unsigned> next_world_id{1};
+} // namespace
+
+World::World() : id_(next_world_id++) {}
+
+void World::commit() {
+  auto weights = std::vector<float>{};
+  weights.reserve(lights_.size());
+  for (auto const &light : lights_) {
+    weights.push_back((light.intensity.r + light.intensity.g +
+                       light.intensity.b) /
+                      3);
+  }
+  light_table_ = AliasTable{weights};
+
+  materials_.clear();
+  for (auto &obj : objects_) {
+    Shape const &shape = *obj;
+    obj->committed(id_, materials_.insert(shape.material()));
+  }
+  materials_.compile(lights_);
+  committed_lights_version_ = lights_version_;
+  committed_ = true;
+}
+
+namespace {
+auto same_area_light(AreaLight const &lhs, AreaLight const &rhs) -> bool {
+  auto l = lhs.extent();
+  auto r = rhs.extent();
+  return lhs.kind() == rhs.kind() && lhs.samples() == rhs.samples() &&
+         lhs.adaptive_samples() == rhs.adaptive_samples() &&
+         lhs.jitter() == rhs.jitter() &&
+         same_bits(lhs.intensity(), rhs.intensity()) &&
+         std::equal(l.begin(), l.end(), r.begin(), r.end(),
+                    same_bits<Point>);
+}
+} // namespace
+
+auto World::snapshot() const -> WorldSnapshot {
+  auto state = WorldSnapshot{};
+  state.taken_ = true;
+  state.transforms_.reserve(objects_.size());
+  state.materials_.reserve(objects_.size());
+  for (auto const &obj : objects_) {
+    Shape const &shape = *obj;
+    state.transforms_.push_back(shape.transform());
+    state.materials_.push_back(shape.material());
+  }
+  state.lights_ = lights_;
+  state.area_lights_ = area_lights_;
+  return state;
+}
+
+auto World::lights_changed(WorldSnapshot const &since) const -> bool {
+  return !since.taken_ ||
+         !std::equal(lights_.begin(), lights_.end(), since.lights_.begin(),
+                     since.lights_.end(), same_bits<PointLight>) ||
+         !std::equal(area_lights_.begin(), area_lights_.end(),
+                     since.area_lights_.begin(), since.area_lights_.end(),
+                     same_area_light);
+}
+
+auto World::changed_shapes(WorldSnapshot const &since)
+    -> std::vector<ShapeChange> {
+  auto changes = std::vector<ShapeChange>{};
+  auto known = since.transforms_.size();
+  for (size_type i = 0; i < objects_.size(); ++i) {
+    auto &obj = *objects_[i];
+    Shape const &shape = obj;
+    if (i >= known) {
+      changes.push_back(ShapeChange{&obj, std::nullopt});
+    } else if (!same_bits(shape.transform(), since.transforms_[i]) ||
+               !same_bits(shape.material(), since.materials_[i])) {
+      changes.push_back(ShapeChange{&obj, since.transforms_[i]});
+    }
+  }
+  return changes;
+}
+
+auto World::compiled_material(Shape const &shape) const
+    -> CompiledMaterial const * {
+  if (!committed_ || committed_lights_version_ != lights_version_ ||
+      !shape.committed_to(id_) ||
+      shape.material_index() >= materials_.size()) {
+    return nullptr;
+  }
+  return &materials_[shape.material_index()];
+}
+
+auto World::shade_light(PreComps const &comps, Material const &material,
+                        CompiledMaterial const *compiled, std::size_t i) const
+    -> Color {
+  auto const &light = lights_[i];
+
+  // Cull lights that can't reach the point before doing any work for them.
+  if (!light.reaches(comps.point())) {
+    return colors::black;
+  }
+
+  auto color = colors::black;
+  auto direct = colors::black;
+  if (compiled) {
+    color = compiled->ambient(i);
+    auto to_light = (light.position - comps.point()).normalize();
+    direct = compiled->direct(i, to_light, comps.eye_vec(), comps.normal());
+  } else {
+    color = ambient_lighting(material, light);
+    direct = direct_lighting(material, light, comps.point(), comps.eye_vec(),
+                             comps.normal());
+  }
+
+  // Only trace the shadow ray if the light could actually add something.
+  if (has_energy(direct) && !is_shadowed(comps.over_point(), light)) {
+    color += direct;
+  }
+  return color;
+}
+
+auto World::shade_area_light(PreComps const &comps, Material const &material,
+                             AreaLight const &light, Rng &rng) const -> Color {
+  auto color = ambient_lighting(material, PointLight{light.center(),
+                                                     light.intensity()});
+
+  // Every sample carries the light's full intensity; the average over them
+  // is the light's contribution.
+  auto lit = colors::black;
+  auto samples = light.samples();
+  auto taken = 0;
+  auto traced = 0;
+  auto visible = 0;
+  while (taken < samples) {
+    auto sample = PointLight{light.point_on_light(taken, rng, comps.point()),
+                             light.intensity()};
+    ++taken;
+
+    auto direct = direct_lighting(material, sample, comps.point(),
+                                  comps.eye_vec(), comps.normal());
+    if (!has_energy(direct)) {
+      continue;
+    }
+    ++traced;
+    if (!is_shadowed(comps.over_point(), sample)) {
+      lit += direct;
+      ++visible;
+    }
+    if (traced == light.adaptive_samples() &&
+        (visible == 0 || visible == traced)) {
+      break;
+    }
+  }
+  return color + lit * (1.0f / taken);
+}
+
 auto World::shade_hit(PreComps comps) const -> Color {
-  return lighting(comps.intersection().object->material(), light_,
-                  comps.point(), comps.eye_vec(), comps.normal(),
-                  is_shadowed(comps.over_point()));
+  auto const &shape = *comps.intersection().object;
+  auto const *compiled = compiled_material(shape);
+  auto const &material = compiled ? compiled->material() : shape.material();
+  auto color = colors::black;
+
+  if (!area_lights_.empty()) {
+    auto rng = Rng{seed_for(comps.point())};
+    for (auto const &light : area_lights_) {
+      color += shade_area_light(comps, material, light, rng);
+    }
+  }
+
+  // Sampling only pays off when there are more lights than samples. A
+  // table built before the lights were last edited can't be used: a light
+  // that had no intensity then would never be picked, biasing the
+  // estimate, so every light is shaded until the next commit.
+  auto sample = light_samples_ > 0 &&
+                static_cast<size_type>(light_samples_) < lights_.size() &&
+                committed_ && committed_lights_version_ == lights_version_;
+  if (!sample) {
+    for (size_type i = 0; i < lights_.size(); ++i) {
+      color += shade_light(comps, material, compiled, i);
+    }
+    return color;
+  }
+
+  // Each sample is weighted by 1 / (samples * probability), so the sum is
+  // an unbiased estimate of shading with every light.
+  auto rng = Rng{seed_for(comps.over_point())};
+  for (int i = 0; i < light_samples_; ++i) {
+    auto u1 = rng.next_float();
+    auto u2 = rng.next_float();
+    auto l = light_table_.sample(u1, u2);
+    auto weight = 1.0f / (light_samples_ * light_table_.probability(l));
+    color += shade_light(comps, material, compiled, l) * weight;
+  }
+  return color;
 }
 
 auto World::color_at(Ray r) const -> Color {
@@ -28,7 +222,11 @@ auto World::color_at(Ray r) const -> Color {
 }
 
 auto World::is_shadowed(Point p) const -> bool {
-  auto v = light_.position - p;
+  return is_shadowed(p, lights_.at(0));
+}
+
+auto World::is_shadowed(Point p, PointLight const &light) const -> bool {
+  auto v = light.position - p;
   auto distance = v.magnitude();
   auto direction = v.normalize();
   auto xs = intersect(Ray{p, direction});
@@ -0,0 +1,150 @@
+#include "y4m.h"
+
+#include "canvas.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define RAYTRACE_HAVE_SSE2 1
+#endif
+
+namespace raytrace {
+
+namespace {
+// A YUV channel from 8 bit RGB, in 256ths:
+// ((r * red + g * green + b * blue + 128) >> 8) + offset
+struct Weights {
+  std::int16_t red;
+  std::int16_t green;
+  std::int16_t blue;
+  int offset;
+};
+
+// BT.601, limited range
+constexpr auto luma = Weights{66, 129, 25, 16};
+constexpr auto blue_difference = Weights{-38, -74, 112, 128};
+constexpr auto red_difference = Weights{112, -94, -18, 128};
+
+// Pixels as pairs of 16 bit values, (r, g) and (b, 1), so that one
+// multiply-add of each pair with its weights gives a channel
+struct Pairs {
+  std::vector<std::int16_t> rg;
+  std::vector<std::int16_t> b1;
+
+  void resize(std::size_t pixels) {
+    rg.resize(pixels * 2);
+    b1.resize(pixels * 2);
+  }
+
+  void set(std::size_t i, int r, int g, int b) {
+    rg[i * 2] = static_cast<std::int16_t>(r);
+    rg[i * 2 + 1] = static_cast<std::int16_t>(g);
+    b1[i * 2] = static_cast<std::int16_t>(b);
+    b1[i * 2 + 1] = 1;
+  }
+};
+
+// The channel w gives for each of count pixels
+void weigh(Pairs const &pixels, std::size_t count, Weights w,
+           unsigned char *out) {
+  auto i = std::size_t{0};
+#ifdef RAYTRACE_HAVE_SSE2
+  auto const rg_weights = _mm_set_epi16(w.green, w.red, w.green, w.red,
+                                        w.green, w.red, w.green, w.red);
+  auto const b1_weights =
+      _mm_set_epi16(128, w.blue, 128, w.blue, 128, w.blue, 128, w.blue);
+  auto const offset = _mm_set1_epi32(w.offset);
+  auto four = [&](std::size_t at) {
+    auto rg = _mm_loadu_si128(
+        reinterpret_cast<__m128i const *>(pixels.rg.data() + at * 2));
+    auto b1 = _mm_loadu_si128(
+        reinterpret_cast<__m128i const *>(pixels.b1.data() + at * 2));
+    auto sum = _mm_add_epi32(_mm_madd_epi16(rg, rg_weights),
+                             _mm_madd_epi16(b1, b1_weights));
+    return _mm_add_epi32(_mm_srai_epi32(sum, 8), offset);
+  };
+  for (; i + 8 <= count; i += 8) {
+    auto eight = _mm_packs_epi32(four(i), four(i + 4));
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(out + i),
+                     _mm_packus_epi16(eight, eight));
+  }
+#endif
+  for (; i < count; ++i) {
+    auto sum = pixels.rg[i * 2] * w.red + pixels.rg[i * 2 + 1] * w.green +
+               pixels.b1[i * 2] * w.blue + 128;
+    out[i] = static_cast<unsigned char>(
+        std::clamp((sum >> 8) + w.offset, 0, 255));
+  }
+}
+} // namespace
+
+Y4mWriter::Y4mWriter(std::ostream &os, int width, int height,
+                     Y4mOptions const &options)
+    : os_(os), width_(width), height_(height),
+      quantization_(options.quantization) {
+  if (width <= 0 || height <= 0) {
+    throw std::out_of_range("height and width must be greater than zero");
+  }
+  // Chroma sited in the middle of each 2x2 block, as averaging puts it
+  os_ << "YUV4MPEG2 W" << width << " H" << height << " F" << options.fps
+      << ":1 Ip A1:1 C420jpeg XCOLORRANGE=LIMITED\n";
+}
+
+void Y4mWriter::write_frame(Canvas const &frame) {
+  if (frame.width() != width_ || frame.height() != height_) {
+    throw std::invalid_argument("Frame isn't the size of the stream");
+  }
+  auto width = static_cast<std::size_t>(width_);
+  auto chroma_width = (width + 1) / 2;
+  auto chroma_height = static_cast<std::size_t>(height_ + 1) / 2;
+
+  frame_ = "FRAME\n";
+  auto start = frame_.size();
+  frame_.resize(start + width * static_cast<std::size_t>(height_) +
+                2 * chroma_width * chroma_height);
+  auto *y_plane = reinterpret_cast<unsigned char *>(frame_.data()) + start;
+  auto *u_plane = y_plane + width * static_cast<std::size_t>(height_);
+  auto *v_plane = u_plane + chroma_width * chroma_height;
+
+  auto pixels = Pairs{};
+  pixels.resize(width);
+  // Rows two at a time, for the chroma they share. An odd last row and
+  // column are paired with themselves.
+  for (int y = 0; y < height_; y += 2) {
+    auto rows = std::min(2, height_ - y);
+    for (int r = 0; r < rows; ++r) {
+      auto &values = rows_[r];
+      quantize_row(frame, y + r, values, quantization_);
+      for (std::size_t x = 0; x < width; ++x) {
+        pixels.set(x, values[x * 3], values[x * 3 + 1], values[x * 3 + 2]);
+      }
+      weigh(pixels, width, luma,
+            y_plane + static_cast<std::size_t>(y + r) * width);
+    }
+
+    auto const &top = rows_[0];
+    auto const &bottom = rows_[rows - 1];
+    for (std::size_t cx = 0; cx < chroma_width; ++cx) {
+      auto x0 = cx * 6;
+      auto x1 = std::min(cx * 2 + 1, width - 1) * 3;
+      int average[3];
+      for (std::size_t c = 0; c < 3; ++c) {
+        average[c] = (top[x0 + c] + top[x1 + c] + bottom[x0 + c] +
+                      bottom[x1 + c] + 2) >>
+                     2;
+      }
+      pixels.set(cx, average[0], average[1], average[2]);
+    }
+    auto row = static_cast<std::size_t>(y / 2) * chroma_width;
+    weigh(pixels, chroma_width, blue_difference, u_plane + row);
+    weigh(pixels, chroma_width, red_difference, v_plane + row);
+  }
+
+  os_.write(frame_.data(), static_cast<std::streamsize>(frame_.size()));
+  ++frames_;
+}
+
+} // namespace raytrace
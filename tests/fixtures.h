@@ -0,0 +1,55 @@
+#ifndef RAYTRACE_TESTS_FIXTURES_H_GUARD
+#define RAYTRACE_TESTS_FIXTURES_H_GUARD
+
+#include "camera.h"
+#include "canvas.h"
+#include "intersections.h"
+#include "primitives.h"
+#include "shape.h"
+#include "transformations.h"
+
+#include <stdexcept>
+
+// Helpers shared by the tests
+namespace fixtures {
+
+// A small view of default_world(), whose edge tiles are cut short for most
+// tile sizes
+inline auto small_camera() -> raytrace::Camera {
+  using raytrace::Point;
+  return raytrace::Camera{
+      21, 13, raytrace::pi / 2,
+      raytrace::view_transform(Point{0.0f, 0.0f, -5.0f},
+                               Point{0.0f, 0.0f, 0.0f},
+                               raytrace::Vector3{0.0f, 1.0f, 0.0f})};
+}
+
+// Whether a and b are the same size with exactly the same pixels
+inline auto same_image(raytrace::Canvas const &a, raytrace::Canvas const &b)
+    -> bool {
+  if (a.width() != b.width() || a.height() != b.height()) {
+    return false;
+  }
+  for (int y = 0; y < a.height(); ++y) {
+    for (int x = 0; x < a.width(); ++x) {
+      if (a.pixel_at(x, y) != b.pixel_at(x, y)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// A shape that can't be rendered
+class Faulty : public raytrace::Shape {
+public:
+  auto local_normal_at(raytrace::Point) const -> raytrace::Vector3 override {
+    return {};
+  }
+  void local_intersect(raytrace::Ray, raytrace::Intersections &) override {
+    throw std::runtime_error("can't intersect");
+  }
+};
+
+} // namespace fixtures
+#endif
@@ -0,0 +1,143 @@
+#include "animation.h"
+
+#include "doctest.h"
+
+#include "camera.h"
+#include "canvas.h"
+#include "primitives.h"
+#include "thread_pool.h"
+#include "transformations.h"
+#include "world.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using raytrace::Camera;
+using raytrace::CameraKey;
+using raytrace::CameraPath;
+using raytrace::Canvas;
+using raytrace::default_world;
+using raytrace::pi;
+using raytrace::Point;
+using raytrace::read_camera_path;
+using raytrace::render_sequence;
+using raytrace::ThreadPool;
+using raytrace::Vector3;
+using raytrace::view_transform;
+
+namespace {
+auto two_key_path() -> CameraPath {
+  auto path = CameraPath{};
+  path.add(CameraKey{2.0f, Point{0.0f, 0.0f, -5.0f}, Point{0.0f, 0.0f, 0.0f},
+                     Vector3{0.0f, 1.0f, 0.0f}, pi / 2});
+  path.add(CameraKey{0.0f, Point{-4.0f, 2.0f, -5.0f}, Point{0.0f, 0.0f, 0.0f},
+                     Vector3{0.0f, 1.0f, 0.0f}, pi / 3});
+  return path;
+}
+
+// A shape that's never hit but counts the rays tested against it
+class Counting : public raytrace::Shape {
+public:
+  explicit Counting(std::atomic<int> &rays) : rays_{rays} {}
+
+  auto local_normal_at(Point) const -> Vector3 override { return {}; }
+  void local_intersect(raytrace::Ray, raytrace::Intersections &) override {
+    ++rays_;
+  }
+
+private:
+  std::atomic<int> &rays_;
+};
+} // namespace
+
+TEST_CASE("A camera path interpolates between its keys") {
+  auto path = two_key_path();
+  REQUIRE(path.size() == 2);
+  CHECK(path.start_time() == 0.0f);
+  CHECK(path.end_time() == 2.0f);
+
+  auto middle = path.at(1.0f);
+  CHECK(middle.from == Point{-2.0f, 1.0f, -5.0f});
+  CHECK(middle.to == Point{0.0f, 0.0f, 0.0f});
+  CHECK_EQ(middle.fov, doctest::Approx(5 * pi / 12));
+
+  CHECK(path.at(-1.0f).from == Point{-4.0f, 2.0f, -5.0f});
+  CHECK(path.at(5.0f).from == Point{0.0f, 0.0f, -5.0f});
+}
+
+TEST_CASE("An empty camera path has no camera") {
+  CHECK_THROWS_AS(CameraPath{}.at(0.0f), std::out_of_range);
+  CHECK_THROWS_AS(CameraPath{}.start_time(), std::out_of_range);
+  CHECK_THROWS_AS(CameraPath{}.end_time(), std::out_of_range);
+  CHECK_THROWS_AS(CameraPath{}.camera(0, 1, 10, 10), std::out_of_range);
+}
+
+TEST_CASE("Frames are spread evenly along the path") {
+  auto path = two_key_path();
+  auto first = path.camera(0, 3, 10, 10);
+  auto last = path.camera(2, 3, 10, 10);
+  CHECK(first.transform() ==
+        view_transform(Point{-4.0f, 2.0f, -5.0f}, Point{0.0f, 0.0f, 0.0f},
+                       Vector3{0.0f, 1.0f, 0.0f}));
+  CHECK(last.transform() ==
+        view_transform(Point{0.0f, 0.0f, -5.0f}, Point{0.0f, 0.0f, 0.0f},
+                       Vector3{0.0f, 1.0f, 0.0f}));
+}
+
+TEST_CASE("Reading a camera path") {
+  auto is = std::istringstream{"# time from to up fov\n"
+                               "\n"
+                               "0 0 1 -5  0 1 0  0 1 0  1.0\n"
+                               "1 1 1 -5  0 1 0  0 1 0  0.5\n"};
+  auto path = read_camera_path(is);
+  REQUIRE(path.size() == 2);
+  CHECK(path.at(1.0f).from == Point{1.0f, 1.0f, -5.0f});
+  CHECK_EQ(path.at(0.5f).fov, doctest::Approx(0.75f));
+
+  auto bad = std::istringstream{"0 0 1 -5 0 1 0\n"};
+  CHECK_THROWS_AS(read_camera_path(bad), std::invalid_argument);
+}
+
+TEST_CASE("Rendering a sequence matches rendering each frame") {
+  auto w = default_world();
+  auto path = two_key_path();
+  auto pool = ThreadPool{3};
+  auto delivered = std::vector<int>{};
+  auto all_match = true;
+
+  render_sequence(w, path, 7, 11, 11, pool, [&](int frame, Canvas &image) {
+    delivered.push_back(frame);
+    auto expected = path.camera(frame, 7, 11, 11).render(w);
+    for (int y = 0; y < 11; ++y) {
+      for (int x = 0; x < 11; ++x) {
+        all_match =
+            all_match && image.pixel_at(x, y) == expected.pixel_at(x, y);
+      }
+    }
+  });
+
+  CHECK(delivered == std::vector<int>{0, 1, 2, 3, 4, 5, 6});
+  CHECK(all_match);
+}
+
+TEST_CASE("A sequence that stops early waits for its frames in flight") {
+  auto rays = std::atomic<int>{0};
+  auto w = default_world();
+  w.push_back(std::make_unique<Counting>(rays));
+  auto path = two_key_path();
+  auto pool = ThreadPool{2};
+
+  CHECK_THROWS_AS(render_sequence(w, path, 20, 41, 41, pool,
+                                  [](int, Canvas &) {
+                                    throw std::runtime_error("stop");
+                                  }),
+                  std::runtime_error);
+  auto after_return = rays.load();
+  std::this_thread::sleep_for(std::chrono::milliseconds{50});
+  CHECK(rays.load() == after_return);
+}
@@ -0,0 +1,61 @@
+#include "bounded_queue.h"
+
+#include "doctest.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using raytrace::BoundedQueue;
+
+TEST_CASE("A bounded queue hands items over in order") {
+  auto queue = BoundedQueue<int>{2};
+  CHECK(queue.capacity() == 2);
+
+  auto received = std::vector<int>{};
+  auto consumer = std::thread([&]() {
+    while (auto item = queue.pop()) {
+      received.push_back(*item);
+    }
+  });
+  for (int i = 0; i < 100; ++i) {
+    queue.push(i);
+  }
+  queue.close();
+  consumer.join();
+
+  auto in_order = received.size() == 100;
+  for (std::size_t i = 0; in_order && i < received.size(); ++i) {
+    in_order = received[i] == static_cast<int>(i);
+  }
+  CHECK(in_order);
+}
+
+TEST_CASE("A full bounded queue makes the producer wait") {
+  auto queue = BoundedQueue<int>{1};
+  queue.push(1);
+
+  auto pushed = std::atomic<bool>{false};
+  auto producer = std::thread([&]() {
+    queue.push(2);
+    pushed = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds{20});
+  CHECK_FALSE(pushed);
+
+  CHECK(queue.pop() == 1);
+  producer.join();
+  CHECK(pushed);
+  CHECK(queue.pop() == 2);
+}
+
+TEST_CASE("A closed bounded queue drains, then comes up empty") {
+  auto queue = BoundedQueue<int>{4};
+  queue.push(7);
+  queue.close();
+  CHECK_FALSE(queue.push(8));
+  CHECK(queue.pop() == 7);
+  CHECK_FALSE(queue.pop().has_value());
+  CHECK_THROWS_AS(BoundedQueue<int>{0}, std::invalid_argument);
+}
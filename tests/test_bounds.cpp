@@ -0,0 +1,43 @@
+#include "bounds.h"
+
+#include "doctest.h"
+
+#include "matrix.h"
+#include "primitives.h"
+
+using raytrace::Bounds;
+using raytrace::identity_matrix;
+using raytrace::pi;
+using raytrace::Point;
+
+TEST_CASE("A bounding box has eight corners") {
+  auto b = Bounds{Point{-1.0f, -2.0f, -3.0f}, Point{1.0f, 2.0f, 3.0f}};
+  auto corners = b.corners();
+  CHECK(corners.size() == 8);
+  CHECK(corners[0] == Point{-1.0f, -2.0f, -3.0f});
+  CHECK(corners[7] == Point{1.0f, 2.0f, 3.0f});
+}
+
+TEST_CASE("Including a point grows a bounding box") {
+  auto b = Bounds{Point{0.0f, 0.0f, 0.0f}, Point{1.0f, 1.0f, 1.0f}};
+  b.include(Point{-1.0f, 0.5f, 2.0f});
+  CHECK(b == Bounds{Point{-1.0f, 0.0f, 0.0f}, Point{1.0f, 1.0f, 2.0f}});
+}
+
+TEST_CASE("Transforming a bounding box") {
+  auto b = Bounds{Point{-1.0f, -1.0f, -1.0f}, Point{1.0f, 1.0f, 1.0f}};
+
+  SUBCASE("Scaling and translating") {
+    auto m = identity_matrix().scaled(2.0f, 1.0f, 1.0f).translated(
+        1.0f, 0.0f, 0.0f);
+    CHECK(b.transformed(m) ==
+          Bounds{Point{-1.0f, -1.0f, -1.0f}, Point{3.0f, 1.0f, 1.0f}});
+  }
+
+  SUBCASE("Rotating encloses the rotated box") {
+    auto m = identity_matrix().rotated_on_y(pi / 4);
+    auto r = std::sqrt(2.0f);
+    CHECK(b.transformed(m) ==
+          Bounds{Point{-r, -1.0f, -r}, Point{r, 1.0f, r}});
+  }
+}
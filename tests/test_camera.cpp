@@ -3,20 +3,34 @@
 #include "doctest.h"
 
 #include "color.h"
+#include "fixtures.h"
 #include "matrix.h"
+#include "plane.h"
 #include "primitives.h"
+#include "sphere.h"
 #include "transformations.h"
 #include "world.h"
 
+#include <algorithm>
 #include <cmath>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <vector>
 
+using fixtures::same_image;
 using raytrace::Camera;
+using raytrace::Canvas;
 using raytrace::Color;
 using raytrace::default_world;
 using raytrace::identity_matrix;
 using raytrace::pi;
+using raytrace::PixelFormat;
+using raytrace::Plane;
 using raytrace::Point;
-using raytrace::Ray;
+using raytrace::PointLight;
+using raytrace::Sphere;
+using raytrace::Tile;
 using raytrace::Vector3;
 using raytrace::view_transform;
 using raytrace::World;
@@ -72,4 +86,174 @@ TEST_CASE("Rendering a world with a camera") {
                             Vector3{0.0f, 1.0f, 0.0f})};
   auto image = c.render(w);
   CHECK(image.pixel_at(5, 5) == Color{0.38066f, 0.47583f, 0.2855f});
-}
\ No newline at end of file
+}
+
+TEST_CASE("Rendering into a caller's buffer") {
+  auto w = default_world();
+  auto c =
+      Camera{11, 11, pi / 2,
+             view_transform(Point{0.0f, 0.0f, -5.0f}, Point{0.0f, 0.0f, 0.0f},
+                            Vector3{0.0f, 1.0f, 0.0f})};
+  auto expected = c.render(w);
+
+  SUBCASE("Float RGB, rows padded") {
+    auto stride = std::ptrdiff_t{16 * 3 * sizeof(float)};
+    auto buffer = std::vector<unsigned char>(11 * stride, 0xff);
+    c.render_into(w, buffer.data(), 11, 11, stride);
+    auto view = Canvas{11, 11, PixelFormat::rgb_float, buffer.data(), stride,
+                       nullptr};
+    CHECK(view.pixel_at(5, 5) == Color{0.38066f, 0.47583f, 0.2855f});
+    CHECK(view.to_ppm() == expected.to_ppm());
+    // The padding is left alone
+    CHECK(buffer[11 * 3 * sizeof(float)] == 0xff);
+  }
+
+  SUBCASE("RGBA8") {
+    auto buffer = std::vector<unsigned char>(11 * 11 * 4);
+    c.render_into(w, buffer.data(), 11, 11, 11 * 4, PixelFormat::rgba8);
+    auto expected8 = expected.converted(PixelFormat::rgba8);
+    CHECK(std::equal(buffer.begin(), buffer.end(), expected8.row(0)));
+  }
+
+  SUBCASE("The buffer must be the camera's size") {
+    auto buffer = std::vector<unsigned char>(10 * 11 * 4);
+    CHECK_THROWS_AS(c.render_into(w, buffer.data(), 10, 11, 10 * 4,
+                                  PixelFormat::rgba8),
+                    std::invalid_argument);
+  }
+}
+
+TEST_CASE("Projecting points onto the canvas") {
+  auto c =
+      Camera{201, 101, pi / 2,
+             view_transform(Point{0.0f, 0.0f, -5.0f}, Point{0.0f, 0.0f, 0.0f},
+                            Vector3{0.0f, 1.0f, 0.0f})};
+
+  SUBCASE("A point along a pixel's ray lands in that pixel") {
+    for (auto [x, y] : {std::pair{100, 50}, std::pair{0, 0},
+                        std::pair{200, 100}, std::pair{37, 81}}) {
+      auto r = c.ray_for_pixel(x, y);
+      auto p = c.project(r.position(3.0f));
+      REQUIRE(p.has_value());
+      CHECK_EQ(p->x, doctest::Approx(x + 0.5f));
+      CHECK_EQ(p->y, doctest::Approx(y + 0.5f));
+    }
+  }
+
+  SUBCASE("Points behind the camera don't project") {
+    CHECK(!c.project(Point{0.0f, 0.0f, -6.0f}).has_value());
+  }
+}
+
+TEST_CASE("Splitting the canvas into tiles") {
+  auto c = Camera{40, 20, pi / 2};
+  auto tiles = c.tiles(16);
+  REQUIRE(tiles.size() == 6);
+  CHECK(tiles[0] == Tile{0, 0, 16, 16});
+  CHECK(tiles[2] == Tile{32, 0, 8, 16});
+  CHECK(tiles[5] == Tile{32, 16, 8, 4});
+  CHECK_THROWS_AS(c.tiles(0), std::invalid_argument);
+  CHECK_THROWS_AS(c.tiles(-16), std::invalid_argument);
+}
+
+TEST_CASE("Re-rendering only what changed") {
+  auto w = World{};
+  w.light(PointLight{Point{-10.0f, 10.0f, -10.0f}, Color{1, 1, 1}});
+  w.push_back(std::make_unique<Sphere>(
+      Sphere{identity_matrix().scaled(0.5f, 0.5f, 0.5f).translated(
+          -1.5f, 0.0f, 0.0f)}));
+  w.push_back(std::make_unique<Sphere>(
+      Sphere{identity_matrix().scaled(0.5f, 0.5f, 0.5f).translated(
+          1.5f, 0.0f, 0.0f)}));
+  auto c =
+      Camera{64, 64, pi / 3,
+             view_transform(Point{0.0f, 0.0f, -8.0f}, Point{0.0f, 0.0f, 0.0f},
+                            Vector3{0.0f, 1.0f, 0.0f})};
+  auto image = c.render(w);
+  auto since = w.snapshot();
+  auto all_tiles = c.tiles(8).size();
+
+  SUBCASE("Nothing changed") {
+    CHECK(c.render_changes(w, image, since, 8) == 0);
+  }
+
+  SUBCASE("A shape moved") {
+    w[1].transform(w[1].transform().translated(0.0f, 0.5f, 0.0f));
+    auto rendered = c.render_changes(w, image, since, 8);
+    CHECK(rendered > 0);
+    CHECK(rendered < all_tiles);
+    auto expected = c.render(w);
+    CHECK(same_image(image, expected));
+  }
+
+  SUBCASE("A material changed") {
+    w[0].material().color(Color{1.0f, 0.0f, 0.0f});
+    auto rendered = c.render_changes(w, image, since, 8);
+    CHECK(rendered > 0);
+    CHECK(rendered < all_tiles);
+    auto expected = c.render(w);
+    CHECK(same_image(image, expected));
+  }
+
+  SUBCASE("The light moved") {
+    w.light().position = Point{10.0f, 10.0f, -10.0f};
+    CHECK(c.render_changes(w, image, since, 8) == all_tiles);
+  }
+
+  SUBCASE("An unbounded shape was added") {
+    w.push_back(std::make_unique<Plane>(
+        Plane{identity_matrix().translated(0.0f, -1.0f, 0.0f)}));
+    CHECK(c.render_changes(w, image, since, 8) == all_tiles);
+    auto expected = c.render(w);
+    CHECK(same_image(image, expected));
+  }
+}
+
+TEST_CASE("Re-rendering a moved shape also redraws its shadow") {
+  auto w = World{};
+  w.light(PointLight{Point{-10.0f, 10.0f, -10.0f}, Color{1, 1, 1}});
+  w.push_back(std::make_unique<Sphere>(
+      Sphere{identity_matrix().scaled(10.0f, 0.01f, 10.0f).translated(
+          0.0f, -1.0f, 0.0f)}));
+  w.push_back(std::make_unique<Sphere>(
+      Sphere{identity_matrix().scaled(0.5f, 0.5f, 0.5f)}));
+  auto c =
+      Camera{64, 64, pi / 3,
+             view_transform(Point{0.0f, 2.0f, -8.0f}, Point{0.0f, 0.0f, 0.0f},
+                            Vector3{0.0f, 1.0f, 0.0f})};
+  auto image = c.render(w);
+  auto since = w.snapshot();
+
+  w[1].transform(w[1].transform().translated(1.0f, 0.0f, 0.0f));
+  auto rendered = c.render_changes(w, image, since, 8);
+  CHECK(rendered < c.tiles(8).size());
+  auto expected = c.render(w);
+  CHECK(same_image(image, expected));
+}
+
+TEST_CASE("Another render in between doesn't hide changes from an image") {
+  auto w = default_world();
+  auto c =
+      Camera{32, 32, pi / 3,
+             view_transform(Point{0.0f, 0.0f, -8.0f}, Point{0.0f, 0.0f, 0.0f},
+                            Vector3{0.0f, 1.0f, 0.0f})};
+  auto image = c.render(w);
+  auto since = w.snapshot();
+
+  w[0].material().color(Color{1.0f, 0.0f, 0.0f});
+  auto other = Camera{16, 16, pi / 2};
+  other.render(w);
+
+  CHECK(c.render_changes(w, image, since, 8) > 0);
+  auto expected = c.render(w);
+  CHECK(same_image(image, expected));
+  CHECK(c.render_changes(w, image, since, 8) == 0);
+}
+
+TEST_CASE("An empty snapshot re-renders everything") {
+  auto w = default_world();
+  auto c = Camera{32, 32, pi / 3};
+  auto image = c.render(w);
+  auto since = raytrace::WorldSnapshot{};
+  CHECK(c.render_changes(w, image, since, 8) == c.tiles(8).size());
+}
@@ -2,7 +2,9 @@
 
 #include "canvas.h"
 
+#include <memory>
 #include <sstream>
+#include <vector>
 
 using namespace raytrace;
 
@@ -97,3 +99,90 @@ TEST_CASE("PPM files are terminated by a newline") {
   Canvas c{5, 3};
   CHECK(c.to_ppm().back() == '\n');
 }
+
+TEST_CASE("Constructing a binary PPM") {
+  Canvas c{2, 1};
+  c.write_pixel(0, 0, Color{1.5f, 0.0f, -0.5f});
+  c.write_pixel(1, 0, Color{0.5f, 0.8f, 0.6f});
+  CHECK(c.to_ppm_binary() ==
+        std::string{"P6\n2 1\n255\n\xff\x00\x00\x80\xcc\x99", 17});
+}
+
+TEST_CASE("Canvases storing bytes quantize like PPM files") {
+  Canvas c{2, 1, PixelFormat::rgb8};
+  c.write_pixel(0, 0, Color{1.5f, 0.5f, -0.5f});
+  CHECK(c.pixel_at(0, 0) == Color{1.0f, 128 / 255.0f, 0.0f});
+  CHECK(c.row(0)[1] == 128);
+  CHECK(c.to_ppm() == "P3\n2 1\n255\n255 128 0 0 0 0\n");
+}
+
+TEST_CASE("Canvases over memory they don't own") {
+  // Two 2 x 2 float images side by side, the second stored bottom up
+  auto memory = std::make_shared<std::vector<float>>(2 * 2 * 3 * 2, 0.0f);
+  auto *bytes = reinterpret_cast<unsigned char *>(memory->data());
+  auto stride = static_cast<std::ptrdiff_t>(4 * 3 * sizeof(float));
+  auto top_down = Canvas{2, 2, PixelFormat::rgb_float, bytes, stride, memory};
+  auto *right_half = bytes + stride / 2;
+  auto bottom_up = Canvas{
+      2, 2, PixelFormat::rgb_float, right_half + stride, -stride, memory};
+
+  top_down.write_pixel(1, 0, Color{0.25f, 0.5f, 0.75f});
+  CHECK((*memory)[3] == 0.25f);
+  bottom_up.write_pixel(0, 1, Color{1.0f, 0.0f, 0.0f});
+  CHECK((*memory)[6] == 1.0f);
+
+  auto copy = bottom_up;
+  copy.write_pixel(0, 1, Color{0.0f, 1.0f, 0.0f});
+  CHECK(bottom_up.pixel_at(0, 1) == Color{1.0f, 0.0f, 0.0f});
+  CHECK(copy.stride() > 0);
+
+  CHECK_THROWS_AS(top_down.pixel_at(2, 0), std::out_of_range);
+  CHECK_THROWS_AS(Canvas(2, 2, PixelFormat::rgb_float, bytes, 4, memory),
+                  std::invalid_argument);
+}
+
+TEST_CASE("RGBA canvases are opaque") {
+  Canvas c{2, 2, PixelFormat::rgba8};
+  CHECK(c.row(1)[7] == 255);
+  c.write_pixel(1, 1, Color{0.5f, 0.4f, 0.6f});
+  CHECK(c.row(1)[4] == 128);
+  CHECK(c.row(1)[7] == 255);
+}
+
+TEST_CASE("Half precision canvases keep high dynamic range") {
+  Canvas c{1, 1, PixelFormat::rgb_half};
+  c.write_pixel(0, 0, Color{1000.0f, 0.001f, -2.0f});
+  auto p = c.pixel_at(0, 0);
+  CHECK(p.r == 1000.0f);
+  CHECK(p.g == doctest::Approx(0.001f).epsilon(0.001));
+  CHECK(p.b == -2.0f);
+}
+
+TEST_CASE("Converting between pixel formats") {
+  Canvas c{7, 3};
+  for (int y = 0; y < c.height(); ++y) {
+    for (int x = 0; x < c.width(); ++x) {
+      c.write_pixel(x, y, Color{x / 6.0f, y / 2.0f, 1.2f});
+    }
+  }
+
+  for (auto format : {PixelFormat::rgb8, PixelFormat::rgba8,
+                      PixelFormat::rgb_half, PixelFormat::rgb_float}) {
+    auto converted = c.converted(format);
+    CHECK(converted.format() == format);
+    CHECK(converted.width() == 7);
+    if (format != PixelFormat::rgb_half) {
+      // Quantizing early gives the same file as quantizing while writing
+      CHECK(converted.to_ppm() == c.to_ppm());
+      CHECK(converted.to_ppm_binary() == c.to_ppm_binary());
+    }
+  }
+
+  auto rgb = c.converted(PixelFormat::rgb8);
+  auto rgba = rgb.converted(PixelFormat::rgba8);
+  CHECK(rgba.row(2)[3] == 255);
+  CHECK(rgba.converted(PixelFormat::rgb8).to_ppm() == rgb.to_ppm());
+
+  auto small = Canvas{2, 2};
+  CHECK_THROWS_AS(convert(c, small), std::invalid_argument);
+}
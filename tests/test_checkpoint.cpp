@@ -0,0 +1,157 @@
+#include "checkpoint.h"
+
+#include "doctest.h"
+
+#include "camera.h"
+#include "fixtures.h"
+#include "plane.h"
+#include "primitives.h"
+#include "sphere.h"
+#include "thread_pool.h"
+#include "transformations.h"
+#include "world.h"
+
+#include <chrono>
+#include <csignal>
+#include <filesystem>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include <sys/resource.h>
+
+using fixtures::Faulty;
+using fixtures::small_camera;
+using raytrace::CheckpointOptions;
+using raytrace::default_world;
+using raytrace::Plane;
+using raytrace::Point;
+using raytrace::render_checkpointed;
+using raytrace::scene_hash;
+using raytrace::Sphere;
+using raytrace::ThreadPool;
+using raytrace::Vector3;
+using raytrace::view_transform;
+
+namespace {
+auto options() -> CheckpointOptions {
+  auto o = CheckpointOptions{};
+  o.path = (std::filesystem::temp_directory_path() / "raytrace_test.ckpt")
+               .string();
+  o.tile_size = 4;
+  return o;
+}
+} // namespace
+
+TEST_CASE("The scene hash changes with anything that affects the render") {
+  auto w = default_world();
+  auto original = scene_hash(w);
+  CHECK(scene_hash(w) == original);
+
+  SUBCASE("A material") {
+    w[0].material().ambient(0.5f);
+    CHECK(scene_hash(w) != original);
+  }
+  SUBCASE("A transform") {
+    w[1].transform() = w[1].transform().translated(0.0f, 1.0f, 0.0f);
+    CHECK(scene_hash(w) != original);
+  }
+  SUBCASE("A kind of shape") {
+    auto sphere = raytrace::World{};
+    sphere.push_back(std::make_unique<Sphere>());
+    auto plane = raytrace::World{};
+    plane.push_back(std::make_unique<Plane>());
+    CHECK(scene_hash(sphere) != scene_hash(plane));
+    CHECK(Sphere{}.kind() == std::string{"sphere"});
+    CHECK(Plane{}.kind() == std::string{"plane"});
+  }
+  SUBCASE("A light") {
+    w.light().position.x += 1.0f;
+    CHECK(scene_hash(w) != original);
+  }
+}
+
+TEST_CASE("Checkpointed renders resume where they left off") {
+  auto w = default_world();
+  auto expected = small_camera().render(w).to_ppm();
+  auto pool = ThreadPool{2};
+  auto o = options();
+  std::filesystem::remove(o.path);
+
+  auto first = render_checkpointed(small_camera(), w, pool, o);
+  CHECK(first.image.to_ppm() == expected);
+  CHECK(first.tiles_resumed == 0);
+  CHECK(first.tiles_rendered == 24);
+
+  SUBCASE("A finished checkpoint needs no more rendering") {
+    auto again = render_checkpointed(small_camera(), w, pool, o);
+    CHECK(again.image.to_ppm() == expected);
+    CHECK(again.tiles_resumed == 24);
+    CHECK(again.tiles_rendered == 0);
+  }
+
+  SUBCASE("A checkpoint cut off part way through a tile") {
+    auto size = std::filesystem::file_size(o.path);
+    std::filesystem::resize_file(o.path, size / 2);
+    auto resumed = render_checkpointed(small_camera(), w, pool, o);
+    CHECK(resumed.image.to_ppm() == expected);
+    CHECK(resumed.tiles_resumed > 0);
+    CHECK(resumed.tiles_resumed < 24);
+    CHECK(resumed.tiles_resumed + resumed.tiles_rendered == 24);
+    CHECK(std::filesystem::file_size(o.path) == size);
+  }
+
+  SUBCASE("A checkpoint of a different camera is started over") {
+    auto c = small_camera();
+    c.transform(view_transform(Point{0.0f, 0.0f, -6.0f},
+                               Point{0.0f, 0.0f, 0.0f},
+                               Vector3{0.0f, 1.0f, 0.0f}));
+    auto other = render_checkpointed(c, w, pool, o);
+    CHECK(other.tiles_resumed == 0);
+    CHECK(other.image.to_ppm() == c.render(w).to_ppm());
+  }
+
+  SUBCASE("A checkpoint of a different scene is started over") {
+    w.light().position.x += 1.0f;
+    auto other = render_checkpointed(small_camera(), w, pool, o);
+    CHECK(other.tiles_resumed == 0);
+    CHECK(other.image.to_ppm() == small_camera().render(w).to_ppm());
+  }
+
+  std::filesystem::remove(o.path);
+}
+
+TEST_CASE("A checkpoint that can't be written stops the render") {
+  auto w = default_world();
+  auto pool = ThreadPool{2};
+  auto o = options();
+  o.interval = std::chrono::milliseconds{1};
+  std::filesystem::remove(o.path);
+
+  // Let the manifest and a tile or two in, then fail every write
+  auto old_handler = std::signal(SIGXFSZ, SIG_IGN);
+  auto old_limit = rlimit{};
+  ::getrlimit(RLIMIT_FSIZE, &old_limit);
+  auto limit = old_limit;
+  limit.rlim_cur = 1024;
+  ::setrlimit(RLIMIT_FSIZE, &limit);
+  CHECK_THROWS_AS(render_checkpointed(small_camera(), w, pool, o),
+                  std::runtime_error);
+  ::setrlimit(RLIMIT_FSIZE, &old_limit);
+  std::signal(SIGXFSZ, old_handler);
+
+  CHECK(std::filesystem::file_size(o.path) <= 1024);
+  std::filesystem::remove(o.path);
+}
+
+TEST_CASE("A checkpointed render that fails waits for its other tiles") {
+  auto w = default_world();
+  w.push_back(std::make_unique<Faulty>());
+  auto o = options();
+  std::filesystem::remove(o.path);
+  auto pool = ThreadPool{2};
+  CHECK_THROWS_AS(render_checkpointed(small_camera(), w, pool, o),
+                  std::runtime_error);
+  CHECK(std::filesystem::file_size(o.path) > 0);
+  std::filesystem::remove(o.path);
+}
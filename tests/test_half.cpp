@@ -0,0 +1,48 @@
+#include "half.h"
+
+#include "doctest.h"
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+using raytrace::from_half;
+using raytrace::to_half;
+
+TEST_CASE("Converting floats to half precision") {
+  CHECK(to_half(0.0f) == 0x0000);
+  CHECK(to_half(-0.0f) == 0x8000);
+  CHECK(to_half(1.0f) == 0x3c00);
+  CHECK(to_half(-2.0f) == 0xc000);
+  CHECK(to_half(0.5f) == 0x3800);
+  CHECK(to_half(65504.0f) == 0x7bff);
+  CHECK(to_half(1e6f) == 0x7c00);
+  CHECK(to_half(std::numeric_limits<float>::infinity()) == 0x7c00);
+  CHECK((to_half(std::numeric_limits<float>::quiet_NaN()) & 0x7fff) > 0x7c00);
+  // The smallest subnormal, 2^-24
+  CHECK(to_half(5.9604645e-8f) == 0x0001);
+}
+
+TEST_CASE("Half precision rounds to nearest even") {
+  // 1 + 2^-11 is halfway between 1 and the next half, 1 + 2^-10
+  CHECK(to_half(1.0f + std::ldexp(1.0f, -11)) == 0x3c00);
+  // 1 + 3 * 2^-11 is halfway between two halves, the even one above
+  CHECK(to_half(1.0f + 3 * std::ldexp(1.0f, -11)) == 0x3c02);
+  CHECK(to_half(1.0f + std::ldexp(1.0f, -11) + std::ldexp(1.0f, -20)) ==
+        0x3c01);
+}
+
+TEST_CASE("Every half survives a round trip through float") {
+  auto all_match = true;
+  for (std::uint32_t h = 0; h < 0x10000; ++h) {
+    auto half = static_cast<std::uint16_t>(h);
+    auto f = from_half(half);
+    if (std::isnan(f)) {
+      all_match = all_match && (half & 0x7c00) == 0x7c00;
+      continue;
+    }
+    all_match = all_match && to_half(f) == half;
+  }
+  CHECK(all_match);
+  CHECK(from_half(0x3555) == doctest::Approx(0.33325f));
+}
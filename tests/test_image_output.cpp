@@ -0,0 +1,61 @@
+#include "image_output.h"
+
+#include "doctest.h"
+
+#include "canvas.h"
+#include "color.h"
+#include "pfm.h"
+#include "png.h"
+#include "qoi.h"
+#include "thread_pool.h"
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+
+using raytrace::Canvas;
+using raytrace::Color;
+using raytrace::encode_image;
+using raytrace::image_format_for;
+using raytrace::ImageFormat;
+using raytrace::ThreadPool;
+using raytrace::write_image;
+
+TEST_CASE("Image format goes by the file's extension") {
+  CHECK(image_format_for("out.png") == ImageFormat::png);
+  CHECK(image_format_for("renders/OUT.PNG") == ImageFormat::png);
+  CHECK(image_format_for("frame.qoi") == ImageFormat::qoi);
+  CHECK(image_format_for("hdr.pfm") == ImageFormat::pfm);
+  CHECK(image_format_for("out.ppm") == ImageFormat::ppm);
+  CHECK(image_format_for("out") == ImageFormat::ppm);
+  CHECK(image_format_for("renders.png/out") == ImageFormat::ppm);
+}
+
+TEST_CASE("Writing an image encodes it in the format its name asks for") {
+  auto pool = ThreadPool{2};
+  auto c = Canvas{10, 4};
+  c.write_pixel(3, 2, Color{1.0f, 0.5f, 0.0f});
+  CHECK(encode_image(c, ImageFormat::ppm, pool) == c.to_ppm());
+  CHECK(encode_image(c, ImageFormat::qoi, pool) == raytrace::encode_qoi(c));
+
+  auto path = (std::filesystem::temp_directory_path() / "raytrace_out.png")
+                  .string();
+  write_image(path, c, pool);
+  auto is = std::ifstream{path, std::ios::binary};
+  auto written = std::string{std::istreambuf_iterator<char>{is}, {}};
+  CHECK(written == raytrace::encode_png(c, pool));
+  std::filesystem::remove(path);
+
+  auto pfm = (std::filesystem::temp_directory_path() / "raytrace_out.pfm")
+                 .string();
+  write_image(pfm, c, pool);
+  auto floats = std::ifstream{pfm, std::ios::binary};
+  CHECK(std::string{std::istreambuf_iterator<char>{floats}, {}} ==
+        raytrace::encode_pfm(c));
+  std::filesystem::remove(pfm);
+
+  CHECK_THROWS_AS(write_image("/no/such/directory/out.png", c, pool),
+                  std::runtime_error);
+}
@@ -4,10 +4,18 @@
 
 #include "color.h"
 #include "primitives.h"
+#include "sampling.h"
 
+#include <vector>
+
+using raytrace::AreaLight;
 using raytrace::Color;
 using raytrace::Point;
 using raytrace::PointLight;
+using raytrace::rectangle_light;
+using raytrace::Rng;
+using raytrace::sphere_light;
+using raytrace::Vector3;
 
 TEST_CASE("A point light has position and intensity") {
   auto position = Point{0, 0, 0};
@@ -31,3 +39,92 @@ TEST_CASE("PointLights can be compared") {
   CHECK(p1 == p2);
   CHECK(p1 != p3);
 }
+
+TEST_CASE("A PointLight reaches points within its range") {
+  auto unlimited = PointLight{Point{0, 0, 0}, Color{1, 1, 1}};
+  CHECK(unlimited.reaches(Point{1000.0f, 0.0f, 0.0f}));
+
+  auto limited = PointLight{Point{0, 0, 0}, Color{1, 1, 1}, 5.0f};
+  CHECK(limited.reaches(Point{0.0f, 3.0f, 4.0f}));
+  CHECK(!limited.reaches(Point{0.0f, 3.0f, 4.1f}));
+}
+
+TEST_CASE("Creating a rectangular area light") {
+  auto light =
+      rectangle_light(Point{0.0f, 0.0f, 0.0f}, Vector3{2.0f, 0.0f, 0.0f}, 4,
+                      Vector3{0.0f, 0.0f, 1.0f}, 2, Color{1, 1, 1});
+  CHECK(light.kind() == AreaLight::Kind::rectangle);
+  CHECK(light.samples() == 8);
+  CHECK(light.center() == Point{1.0f, 0.0f, 0.5f});
+  CHECK(light.intensity() == Color{1, 1, 1});
+  CHECK(light.adaptive_samples() == 0);
+  CHECK_THROWS_AS(light.adaptive_samples(-1), std::out_of_range);
+}
+
+TEST_CASE("Area lights visit every stratum once") {
+  auto light =
+      rectangle_light(Point{0.0f, 0.0f, 0.0f}, Vector3{2.0f, 0.0f, 0.0f}, 4,
+                      Vector3{0.0f, 0.0f, 1.0f}, 4, Color{1, 1, 1});
+  auto seen = std::vector<int>(16, 0);
+  for (int i = 0; i < light.samples(); ++i) {
+    ++seen[light.order(i)];
+  }
+  CHECK(std::all_of(seen.begin(), seen.end(), [](int n) { return n == 1; }));
+  CHECK(light.order(0) != light.order(1) - 1);
+}
+
+TEST_CASE("Finding points on a rectangular area light without jitter") {
+  auto light =
+      rectangle_light(Point{0.0f, 0.0f, 0.0f}, Vector3{2.0f, 0.0f, 0.0f}, 4,
+                      Vector3{0.0f, 0.0f, 1.0f}, 2, Color{1, 1, 1})
+          .jitter(false);
+  auto rng = Rng{0};
+  auto p = Point{0.0f, -1.0f, 0.0f};
+
+  auto expected = std::vector<Point>{
+      {0.25f, 0.0f, 0.25f}, {0.75f, 0.0f, 0.25f}, {1.25f, 0.0f, 0.25f},
+      {1.75f, 0.0f, 0.25f}, {0.25f, 0.0f, 0.75f}, {0.75f, 0.0f, 0.75f},
+      {1.25f, 0.0f, 0.75f}, {1.75f, 0.0f, 0.75f}};
+  for (int i = 0; i < light.samples(); ++i) {
+    auto stratum = static_cast<size_t>(light.order(i));
+    CHECK(light.point_on_light(i, rng, p) == expected[stratum]);
+  }
+}
+
+TEST_CASE("Jittered points stay inside their cell") {
+  auto light =
+      rectangle_light(Point{0.0f, 0.0f, 0.0f}, Vector3{2.0f, 0.0f, 0.0f}, 2,
+                      Vector3{0.0f, 0.0f, 2.0f}, 2, Color{1, 1, 1});
+  auto rng = Rng{3};
+  auto inside = true;
+  for (int n = 0; n < 100; ++n) {
+    for (int i = 0; i < light.samples(); ++i) {
+      auto stratum = light.order(i);
+      auto q = light.point_on_light(i, rng, Point{0.0f, -1.0f, 0.0f});
+      auto u = static_cast<float>(stratum % 2);
+      auto v = static_cast<float>(stratum / 2);
+      inside = inside && q.x >= u && q.x <= u + 1 && q.z >= v &&
+               q.z <= v + 1 && q.y == 0.0f;
+    }
+  }
+  CHECK(inside);
+}
+
+TEST_CASE("Sphere light samples lie on the hemisphere facing the point") {
+  auto center = Point{1.0f, 2.0f, 3.0f};
+  auto light = sphere_light(center, 0.5f, 16, Color{1, 1, 1});
+  CHECK(light.kind() == AreaLight::Kind::sphere);
+  CHECK(light.samples() == 16);
+  CHECK(light.center() == center);
+
+  auto rng = Rng{11};
+  auto p = Point{1.0f, 2.0f, -10.0f};
+  auto on_facing_side = true;
+  for (int i = 0; i < light.samples(); ++i) {
+    auto q = light.point_on_light(i, rng, p);
+    on_facing_side = on_facing_side &&
+                     std::abs((q - center).magnitude() - 0.5f) < 0.001f &&
+                     (q - center).dot(p - center) >= 0;
+  }
+  CHECK(on_facing_side);
+}
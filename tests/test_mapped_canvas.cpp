@@ -0,0 +1,87 @@
+#include "mapped_canvas.h"
+
+#include "doctest.h"
+
+#include "canvas.h"
+#include "color.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+using raytrace::Canvas;
+using raytrace::Color;
+using raytrace::ImageFile;
+using raytrace::map_image_file;
+
+namespace {
+auto temp_file(char const *name) -> std::string {
+  return (std::filesystem::temp_directory_path() / name).string();
+}
+
+auto read_file(std::string const &path) -> std::string {
+  auto is = std::ifstream{path, std::ios::binary};
+  return std::string{std::istreambuf_iterator<char>{is}, {}};
+}
+
+auto gradient() -> Canvas {
+  auto c = Canvas{5, 3};
+  for (int y = 0; y < c.height(); ++y) {
+    for (int x = 0; x < c.width(); ++x) {
+      c.write_pixel(x, y, Color{x / 4.0f, y / 2.0f, 0.3f});
+    }
+  }
+  return c;
+}
+} // namespace
+
+TEST_CASE("Writing to a canvas mapped onto a PPM file") {
+  auto path = temp_file("raytrace_test_mapped.ppm");
+  auto expected = gradient();
+  {
+    auto mapped = map_image_file(path, ImageFile::ppm, 5, 3);
+    for (int y = 0; y < 3; ++y) {
+      for (int x = 0; x < 5; ++x) {
+        mapped.write_pixel(x, y, expected.pixel_at(x, y));
+      }
+    }
+    CHECK(mapped.to_ppm() == expected.to_ppm());
+  }
+  CHECK(read_file(path) == expected.to_ppm_binary());
+  std::filesystem::remove(path);
+}
+
+TEST_CASE("Writing to a canvas mapped onto a PFM file") {
+  auto path = temp_file("raytrace_test_mapped.pfm");
+  auto expected = gradient();
+  {
+    auto mapped = map_image_file(path, ImageFile::pfm, 5, 3);
+    for (int y = 0; y < 3; ++y) {
+      for (int x = 0; x < 5; ++x) {
+        mapped.write_pixel(x, y, expected.pixel_at(x, y));
+      }
+    }
+  }
+
+  auto file = read_file(path);
+  auto header = std::string{"PF\n5 3\n-1.0\n"};
+  REQUIRE(file.size() == header.size() + 5 * 3 * 3 * sizeof(float));
+  CHECK(file.substr(0, 3) == "PF\n");
+
+  // The bottom row comes first
+  auto data = file.data() + file.size() - 5 * 3 * 3 * sizeof(float);
+  float first[3];
+  std::memcpy(first, data, sizeof first);
+  CHECK(first[0] == 0.0f);
+  CHECK(first[1] == 1.0f);
+  CHECK(first[2] == 0.3f);
+  std::filesystem::remove(path);
+}
+
+TEST_CASE("Mapping a file that can't be created") {
+  CHECK_THROWS_AS(map_image_file(temp_file("no/such/dir/image.ppm"),
+                                 ImageFile::ppm, 5, 3),
+                  std::runtime_error);
+}
@@ -0,0 +1,75 @@
+#include "material_table.h"
+
+#include "doctest.h"
+
+#include "color.h"
+#include "lights.h"
+#include "materials.h"
+#include "primitives.h"
+
+#include <cmath>
+#include <vector>
+
+using raytrace::ambient_lighting;
+using raytrace::Color;
+using raytrace::CompiledMaterial;
+using raytrace::direct_lighting;
+using raytrace::Material;
+using raytrace::MaterialTable;
+using raytrace::Point;
+using raytrace::PointLight;
+using raytrace::Vector3;
+
+TEST_CASE("A material table stores each distinct material once") {
+  auto table = MaterialTable{};
+  CHECK(table.empty());
+
+  auto red = Material{Color{1.0f, 0.0f, 0.0f}};
+  auto shiny_red = Material{Color{1.0f, 0.0f, 0.0f}}.shininess(300.0f);
+  CHECK(table.insert(red) == 0);
+  CHECK(table.insert(shiny_red) == 1);
+  CHECK(table.insert(Material{Color{1.0f, 0.0f, 0.0f}}) == 0);
+  CHECK(table.size() == 2);
+
+  // Told apart bit for bit
+  CHECK(table.insert(Material{Color{-0.0f, 0.0f, 0.0f}}) == 2);
+  CHECK(table.insert(Material{Color{0.0f, 0.0f, 0.0f}}) == 3);
+  CHECK(table.insert(Material{Color{-0.0f, 0.0f, 0.0f}}) == 2);
+
+  table.clear();
+  CHECK(table.empty());
+  CHECK(table.insert(shiny_red) == 0);
+}
+
+TEST_CASE("Compiled materials shade like the lighting functions") {
+  auto lights = std::vector<PointLight>{
+      PointLight{Point{0.0f, 10.0f, -10.0f}, Color{1.0f, 1.0f, 1.0f}},
+      PointLight{Point{5.0f, 5.0f, -10.0f}, Color{0.5f, 0.3f, 0.2f}},
+      PointLight{Point{0.0f, 0.0f, 10.0f}, Color{1.0f, 1.0f, 1.0f}}};
+  auto point = Point{0.0f, 0.0f, 0.0f};
+  auto eye = Vector3{0.0f, -std::sqrt(2.0f) / 2, -std::sqrt(2.0f) / 2};
+  auto normal = Vector3{0.0f, 0.0f, -1.0f};
+
+  auto check_material = [&](Material const &material) {
+    auto compiled = CompiledMaterial{material, lights};
+    for (size_t i = 0; i < lights.size(); ++i) {
+      auto to_light = (lights[i].position - point).normalize();
+      CHECK(compiled.ambient(i) == ambient_lighting(material, lights[i]));
+      CHECK(compiled.direct(i, to_light, eye, normal) ==
+            direct_lighting(material, lights[i], point, eye, normal));
+    }
+  };
+
+  SUBCASE("Default material, integer shininess") {
+    check_material(Material{});
+  }
+  SUBCASE("Fractional shininess") {
+    check_material(Material{}.shininess(10.5f));
+  }
+  SUBCASE("No specular") {
+    check_material(Material{Color{1.0f, 0.9f, 0.9f}}.specular(0.0f));
+  }
+  SUBCASE("No diffuse or specular") {
+    check_material(Material{}.diffuse(0.0f).specular(0.0f));
+  }
+}
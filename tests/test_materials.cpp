@@ -7,8 +7,10 @@
 
 #include <cmath>
 
+using raytrace::ambient_lighting;
 using raytrace::are_about_equal;
 using raytrace::Color;
+using raytrace::direct_lighting;
 using raytrace::Material;
 using raytrace::Point;
 using raytrace::PointLight;
@@ -84,4 +86,39 @@ TEST_CASE("Lighting function") {
     auto color = lighting(material, light, position, eye, normal, true);
     CHECK(color == Color{0.1f, 0.1f, 0.1f});
   }
-}
\ No newline at end of file
+}
+TEST_CASE("Lighting is the sum of its ambient and direct parts") {
+  auto material = Material{};
+  auto position = Point{0, 0, 0};
+  auto eye = Vector3{0.0f, -std::sqrt(2.0f) / 2, -std::sqrt(2.0f) / 2};
+  auto normal = Vector3{0.0f, 0.0f, -1.0f};
+  auto light = PointLight{Point{0.0f, 10.0f, -10.0f}, Color{1.0f, 1.0f, 1.0f}};
+
+  auto ambient = ambient_lighting(material, light);
+  auto direct = direct_lighting(material, light, position, eye, normal);
+  CHECK(ambient == Color{0.1f, 0.1f, 0.1f});
+  CHECK(ambient + direct == lighting(material, light, position, eye, normal));
+}
+
+TEST_CASE("Direct lighting is black when the light can't add anything") {
+  auto position = Point{0, 0, 0};
+  auto eye = Vector3{0.0f, 0.0f, -1.0f};
+  auto normal = Vector3{0.0f, 0.0f, -1.0f};
+
+  SUBCASE("Light behind the surface") {
+    auto light = PointLight{Point{0.0f, 0.0f, 10.0f}, Color{1.0f, 1.0f, 1.0f}};
+    auto c = direct_lighting(Material{}, light, position, eye, normal);
+    CHECK(c.r == 0.0f);
+    CHECK(c.g == 0.0f);
+    CHECK(c.b == 0.0f);
+  }
+
+  SUBCASE("Material with no diffuse or specular reflection") {
+    auto light = PointLight{Point{0.0f, 0.0f, -10.0f}, Color{1.0f, 1.0f, 1.0f}};
+    auto m = Material{}.diffuse(0.0f).specular(0.0f);
+    auto c = direct_lighting(m, light, position, eye, normal);
+    CHECK(c.r == 0.0f);
+    CHECK(c.g == 0.0f);
+    CHECK(c.b == 0.0f);
+  }
+}
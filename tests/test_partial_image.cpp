@@ -0,0 +1,146 @@
+#include "partial_image.h"
+
+#include "doctest.h"
+
+#include "camera.h"
+#include "canvas.h"
+#include "color.h"
+#include "fixtures.h"
+#include "primitives.h"
+#include "transformations.h"
+#include "world.h"
+
+#include <cstddef>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using fixtures::small_camera;
+using raytrace::Camera;
+using raytrace::Canvas;
+using raytrace::Color;
+using raytrace::default_world;
+using raytrace::merge_partials;
+using raytrace::PartialImage;
+using raytrace::pi;
+using raytrace::Point;
+using raytrace::read_partial;
+using raytrace::shard_crop;
+using raytrace::Tile;
+using raytrace::Vector3;
+using raytrace::view_transform;
+using raytrace::write_partial;
+
+TEST_CASE("Shards split the image into bands of rows") {
+  CHECK(shard_crop(10, 10, 0, 3) == Tile{0, 0, 10, 3});
+  CHECK(shard_crop(10, 10, 1, 3) == Tile{0, 3, 10, 3});
+  CHECK(shard_crop(10, 10, 2, 3) == Tile{0, 6, 10, 4});
+  CHECK_THROWS_AS(shard_crop(10, 10, 3, 3), std::out_of_range);
+}
+
+TEST_CASE("Every shard gets at least one row") {
+  CHECK(shard_crop(10, 3, 2, 3) == Tile{0, 2, 10, 1});
+  CHECK_THROWS_AS(shard_crop(10, 3, 0, 4), std::out_of_range);
+  CHECK_THROWS_AS(shard_crop(10, 0, 0, 1), std::out_of_range);
+}
+
+TEST_CASE("Rendering a crop window") {
+  auto w = default_world();
+  auto c =
+      Camera{11, 11, pi / 2,
+             view_transform(Point{0.0f, 0.0f, -5.0f}, Point{0.0f, 0.0f, 0.0f},
+                            Vector3{0.0f, 1.0f, 0.0f})};
+  auto crop = c.render(w, Tile{4, 5, 3, 2});
+  CHECK(crop.width() == 3);
+  CHECK(crop.height() == 2);
+  CHECK(crop.pixel_at(1, 0) == Color{0.38066f, 0.47583f, 0.2855f});
+  CHECK_THROWS_AS(c.render(w, Tile{10, 0, 2, 1}), std::out_of_range);
+}
+
+TEST_CASE("Partial images survive a round trip exactly") {
+  auto pixels = Canvas{2, 2};
+  pixels.write_pixel(0, 0, Color{0.1f, 0.2f, 0.3f});
+  pixels.write_pixel(1, 1, Color{1.5f, -0.25f, 0.333333f});
+  auto part = PartialImage{4, 4, Tile{1, 2, 2, 2}, pixels};
+
+  auto buffer = std::stringstream{};
+  write_partial(buffer, part);
+  auto read = read_partial(buffer);
+
+  CHECK(read.full_width == 4);
+  CHECK(read.full_height == 4);
+  CHECK(read.crop == Tile{1, 2, 2, 2});
+  auto c = read.pixels.pixel_at(1, 1);
+  CHECK(c.r == 1.5f);
+  CHECK(c.g == -0.25f);
+  CHECK(c.b == 0.333333f);
+}
+
+TEST_CASE("Partial image pixels are little endian") {
+  auto part = PartialImage{1, 1, Tile{0, 0, 1, 1}, Canvas{1, 1}};
+  part.pixels.write_pixel(0, 0, Color{1.0f, -2.0f, 0.0f});
+  auto buffer = std::stringstream{};
+  write_partial(buffer, part);
+  auto bytes = buffer.str();
+  REQUIRE(bytes.size() >= 12);
+  CHECK(bytes.substr(bytes.size() - 12) ==
+        std::string("\x00\x00\x80\x3f\x00\x00\x00\xc0\x00\x00\x00\x00",
+                    12));
+}
+
+TEST_CASE("Reading something that isn't a partial image") {
+  auto buffer = std::stringstream{"P3\n1 1\n255\n0 0 0\n"};
+  CHECK_THROWS_AS(read_partial(buffer), std::runtime_error);
+}
+
+TEST_CASE("A partial image must fit inside a full image of sane size") {
+  // Followed by pixels for the whole crop, so only the header is wrong
+  auto read = [](std::string const &header, std::size_t pixels) {
+    auto buffer = std::stringstream{"RTPART2\n" + header + "\n" +
+                                    std::string(pixels * 12, '\0')};
+    return read_partial(buffer);
+  };
+  SUBCASE("Crop along the bottom edge") {
+    CHECK_NOTHROW(read("10 10\n0 9 10 1", 10));
+  }
+  SUBCASE("Crop past the right edge") {
+    CHECK_THROWS_AS(read("10 10\n5 0 6 1", 6), std::runtime_error);
+  }
+  SUBCASE("Crop past the bottom edge") {
+    CHECK_THROWS_AS(read("10 10\n0 9 10 2", 20), std::runtime_error);
+  }
+  SUBCASE("Negative crop origin") {
+    CHECK_THROWS_AS(read("10 10\n-1 0 1 1", 1), std::runtime_error);
+  }
+  SUBCASE("Empty full image") {
+    CHECK_THROWS_AS(read("0 10\n0 0 1 1", 1), std::runtime_error);
+  }
+  SUBCASE("Full image too big to merge") {
+    CHECK_THROWS_AS(read("65536 65536\n0 0 1 1", 1), std::runtime_error);
+    CHECK_THROWS_AS(read("70000 1\n0 0 1 1", 1), std::runtime_error);
+  }
+}
+
+TEST_CASE("Merged shards match a single render") {
+  auto w = default_world();
+  auto c = small_camera();
+  auto parts = std::vector<PartialImage>{};
+  for (int k = 0; k < 4; ++k) {
+    auto crop = shard_crop(21, 13, k, 4);
+    auto buffer = std::stringstream{};
+    write_partial(buffer, PartialImage{21, 13, crop, c.render(w, crop)});
+    parts.push_back(read_partial(buffer));
+  }
+  CHECK(merge_partials(parts).to_ppm() == c.render(w).to_ppm());
+
+  SUBCASE("Missing shards are an error") {
+    parts.pop_back();
+    CHECK_THROWS_AS(merge_partials(parts), std::invalid_argument);
+  }
+
+  SUBCASE("Overlapping shards are an error") {
+    parts.push_back(parts.front());
+    CHECK_THROWS_AS(merge_partials(parts), std::invalid_argument);
+  }
+}
@@ -0,0 +1,109 @@
+#include "pfm.h"
+
+#include "doctest.h"
+
+#include "canvas.h"
+#include "color.h"
+#include "mapped_canvas.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using raytrace::append_pfm_rows;
+using raytrace::Canvas;
+using raytrace::Color;
+using raytrace::encode_pfm;
+using raytrace::pfm_header;
+using raytrace::write_pfm;
+
+namespace {
+// High dynamic range values that 8 bits would clamp or round
+auto radiance() -> Canvas {
+  auto c = Canvas{4, 3};
+  for (int y = 0; y < 3; ++y) {
+    for (int x = 0; x < 4; ++x) {
+      c.write_pixel(x, y, Color{x * 1.75f, y * 0.001f, -0.5f + x + y});
+    }
+  }
+  return c;
+}
+
+auto floats_of(std::string const &bytes) -> std::vector<float> {
+  auto floats = std::vector<float>(bytes.size() / sizeof(float));
+  std::memcpy(floats.data(), bytes.data(), floats.size() * sizeof(float));
+  return floats;
+}
+} // namespace
+
+TEST_CASE("A PFM header gives the size and the byte order") {
+  auto one = 1.0f;
+  unsigned char last{};
+  std::memcpy(&last, reinterpret_cast<unsigned char *>(&one) + 3, 1);
+  auto little = last == 0x3f;
+  CHECK(pfm_header(4, 3) == (little ? "PF\n4 3\n-1.0\n" : "PF\n4 3\n1.0\n"));
+}
+
+TEST_CASE("A PFM holds the floats exactly, bottom row first") {
+  auto c = radiance();
+  auto pfm = encode_pfm(c);
+  auto header = pfm_header(4, 3);
+  REQUIRE(pfm.size() == header.size() + 4 * 3 * 3 * sizeof(float));
+  CHECK(pfm.substr(0, header.size()) == header);
+
+  auto floats = floats_of(pfm.substr(header.size()));
+  auto i = std::size_t{0};
+  for (int y = 2; y >= 0; --y) {
+    for (int x = 0; x < 4; ++x) {
+      auto p = c.pixel_at(x, y);
+      CHECK(floats[i++] == p.r);
+      CHECK(floats[i++] == p.g);
+      CHECK(floats[i++] == p.b);
+    }
+  }
+}
+
+TEST_CASE("PFM bands join bottom band first") {
+  auto c = radiance();
+  auto pfm = pfm_header(4, 3);
+  append_pfm_rows(pfm, c, 1, 3);
+  append_pfm_rows(pfm, c, 0, 1);
+  CHECK(pfm == encode_pfm(c));
+}
+
+TEST_CASE("Writing a PFM to a stream gives the same bytes") {
+  auto c = radiance();
+  auto os = std::ostringstream{};
+  write_pfm(os, c);
+  CHECK(os.str() == encode_pfm(c));
+
+  auto halves = c.converted(raytrace::PixelFormat::rgb_half);
+  os.str("");
+  write_pfm(os, halves);
+  CHECK(os.str() == encode_pfm(halves));
+  CHECK(os.str().size() == encode_pfm(c).size());
+}
+
+TEST_CASE("A PFM is the same as a mapped float image file") {
+  auto c = radiance();
+  auto path =
+      (std::filesystem::temp_directory_path() / "raytrace_write.pfm").string();
+  {
+    auto mapped =
+        raytrace::map_image_file(path, raytrace::ImageFile::pfm, 4, 3);
+    raytrace::convert(c, mapped);
+  }
+  auto is = std::ifstream{path, std::ios::binary};
+  auto bytes = std::string{std::istreambuf_iterator<char>{is}, {}};
+  CHECK(bytes == encode_pfm(c));
+
+  // A mapped PFM canvas stores its rows bottom up
+  auto mapped = raytrace::map_image_file(path, raytrace::ImageFile::pfm, 4, 3);
+  raytrace::convert(c, mapped);
+  CHECK(encode_pfm(mapped) == encode_pfm(c));
+  std::filesystem::remove(path);
+}
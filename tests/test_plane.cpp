@@ -57,3 +57,9 @@ TEST_CASE("A ray intersecting a plane from below") {
   CHECK(xs[0].t == 1);
   CHECK(xs[0].object->is(p));
 }
+
+TEST_CASE("A plane is unbounded") {
+  auto p = Plane{};
+  CHECK(!p.local_bounds().has_value());
+  CHECK(!p.bounds().has_value());
+}
@@ -0,0 +1,355 @@
+#include "png.h"
+
+#include "doctest.h"
+
+#include "canvas.h"
+#include "color.h"
+#include "deflate.h"
+#include "ppm.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using raytrace::adler32;
+using raytrace::Canvas;
+using raytrace::Color;
+using raytrace::crc32;
+using raytrace::encode_png;
+using raytrace::ppm_value;
+using raytrace::ThreadPool;
+using raytrace::zlib_compress;
+
+namespace {
+using Bytes = std::vector<unsigned char>;
+
+auto bytes_of(std::string const &s) -> Bytes {
+  return Bytes(s.begin(), s.end());
+}
+
+// A straightforward inflater, to check the compressor against
+class Inflater {
+public:
+  explicit Inflater(Bytes const &in) : in_(in) {}
+
+  auto zlib() -> Bytes {
+    auto cmf = bits(8);
+    auto flg = bits(8);
+    if ((cmf & 0x0f) != 8 || (cmf * 256 + flg) % 31 != 0) {
+      throw std::runtime_error("bad zlib header");
+    }
+    auto out = Bytes{};
+    for (auto last = 0; !last;) {
+      last = bits(1);
+      auto type = bits(2);
+      if (type == 0) {
+        stored(out);
+      } else if (type == 1) {
+        auto lengths = std::vector<int>(288, 8);
+        std::fill(lengths.begin() + 144, lengths.begin() + 256, 9);
+        std::fill(lengths.begin() + 256, lengths.begin() + 280, 7);
+        codes(out, Huffman{lengths}, Huffman{std::vector<int>(30, 5)});
+      } else if (type == 2) {
+        dynamic(out);
+      } else {
+        throw std::runtime_error("bad block type");
+      }
+    }
+    bit_count_ = 0;
+    auto check = 0U;
+    for (int i = 0; i < 4; ++i) {
+      check = check << 8 | static_cast<unsigned>(bits(8));
+    }
+    if (check != adler32(out.data(), out.size()) || pos_ != in_.size()) {
+      throw std::runtime_error("bad zlib trailer");
+    }
+    return out;
+  }
+
+private:
+  struct Huffman {
+    explicit Huffman(std::vector<int> const &lengths) : count(16, 0) {
+      for (auto l : lengths) {
+        ++count[static_cast<std::size_t>(l)];
+      }
+      count[0] = 0;
+      for (int l = 1; l < 16; ++l) {
+        for (std::size_t s = 0; s < lengths.size(); ++s) {
+          if (lengths[s] == l) {
+            symbols.push_back(static_cast<int>(s));
+          }
+        }
+      }
+    }
+    std::vector<int> count;
+    std::vector<int> symbols;
+  };
+
+  Bytes const &in_;
+  std::size_t pos_{0};
+  unsigned bit_buffer_{0};
+  int bit_count_{0};
+
+  auto bits(int n) -> int {
+    while (bit_count_ < n) {
+      if (pos_ >= in_.size()) {
+        throw std::runtime_error("ran out of input");
+      }
+      bit_buffer_ |= static_cast<unsigned>(in_[pos_++]) << bit_count_;
+      bit_count_ += 8;
+    }
+    auto v = static_cast<int>(bit_buffer_ & ((1U << n) - 1));
+    bit_buffer_ >>= n;
+    bit_count_ -= n;
+    return v;
+  }
+
+  auto decode(Huffman const &h) -> int {
+    auto code = 0;
+    auto first = 0;
+    auto index = 0;
+    for (int l = 1; l < 16; ++l) {
+      code |= bits(1);
+      auto count = h.count[static_cast<std::size_t>(l)];
+      if (code - count < first) {
+        return h.symbols[static_cast<std::size_t>(index + code - first)];
+      }
+      index += count;
+      first = (first + count) << 1;
+      code <<= 1;
+    }
+    throw std::runtime_error("bad code");
+  }
+
+  void stored(Bytes &out) {
+    bit_buffer_ = 0;
+    bit_count_ = 0;
+    auto length = bits(16);
+    if (bits(16) != (~length & 0xffff)) {
+      throw std::runtime_error("bad stored block");
+    }
+    for (int i = 0; i < length; ++i) {
+      out.push_back(static_cast<unsigned char>(bits(8)));
+    }
+  }
+
+  void dynamic(Bytes &out) {
+    static constexpr int order[19] = {16, 17, 18, 0, 8,  7, 9,  6, 10, 5,
+                                      11, 4,  12, 3, 13, 2, 14, 1, 15};
+    auto literals = bits(5) + 257;
+    auto distances = bits(5) + 1;
+    auto code_lengths = bits(4) + 4;
+    auto lengths = std::vector<int>(19, 0);
+    for (int i = 0; i < code_lengths; ++i) {
+      lengths[static_cast<std::size_t>(order[i])] = bits(3);
+    }
+    auto length_code = Huffman{lengths};
+    lengths.clear();
+    while (static_cast<int>(lengths.size()) < literals + distances) {
+      auto symbol = decode(length_code);
+      if (symbol < 16) {
+        lengths.push_back(symbol);
+      } else if (symbol == 16) {
+        auto repeat = lengths.back();
+        lengths.insert(lengths.end(), static_cast<std::size_t>(3 + bits(2)),
+                       repeat);
+      } else if (symbol == 17) {
+        lengths.insert(lengths.end(), static_cast<std::size_t>(3 + bits(3)),
+                       0);
+      } else {
+        lengths.insert(lengths.end(), static_cast<std::size_t>(11 + bits(7)),
+                       0);
+      }
+    }
+    auto split = lengths.begin() + literals;
+    codes(out, Huffman{std::vector<int>(lengths.begin(), split)},
+          Huffman{std::vector<int>(split, lengths.end())});
+  }
+
+  void codes(Bytes &out, Huffman const &literal, Huffman const &distance) {
+    static constexpr int length_base[29] = {
+        3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+        31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+    static constexpr int length_extra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1,
+                                             1, 1, 2, 2, 2, 2, 3, 3, 3, 3,
+                                             4, 4, 4, 4, 5, 5, 5, 5, 0};
+    for (;;) {
+      auto symbol = decode(literal);
+      if (symbol < 256) {
+        out.push_back(static_cast<unsigned char>(symbol));
+        continue;
+      }
+      if (symbol == 256) {
+        return;
+      }
+      auto l = static_cast<std::size_t>(symbol - 257);
+      auto length = length_base[l] + bits(length_extra[l]);
+      auto d = decode(distance);
+      auto extra = d < 4 ? 0 : d / 2 - 1;
+      auto base = d < 4 ? d + 1 : ((2 + d % 2) << extra) + 1;
+      auto back = static_cast<std::size_t>(base + bits(extra));
+      if (back > out.size()) {
+        throw std::runtime_error("distance too far back");
+      }
+      for (int i = 0; i < length; ++i) {
+        out.push_back(out[out.size() - back]);
+      }
+    }
+  }
+};
+
+auto inflate(std::string const &compressed) -> Bytes {
+  auto in = bytes_of(compressed);
+  return Inflater{in}.zlib();
+}
+
+auto u32_at(std::string const &s, std::size_t pos) -> std::uint32_t {
+  auto v = std::uint32_t{0};
+  for (std::size_t i = 0; i < 4; ++i) {
+    v = v << 8 | static_cast<unsigned char>(s[pos + i]);
+  }
+  return v;
+}
+
+// Undo PNG's filtering, as a decoder would
+auto unfilter(Bytes const &filtered, int width, int height) -> Bytes {
+  auto row_size = static_cast<std::size_t>(width) * 3;
+  auto pixels = Bytes{};
+  for (int y = 0; y < height; ++y) {
+    auto const *in = filtered.data() + y * (row_size + 1);
+    auto type = in[0];
+    auto start = pixels.size();
+    for (std::size_t i = 0; i < row_size; ++i) {
+      int a = i >= 3 ? pixels[start + i - 3] : 0;
+      int b = y > 0 ? pixels[start + i - row_size] : 0;
+      int c = y > 0 && i >= 3 ? pixels[start + i - 3 - row_size] : 0;
+      auto predicted = 0;
+      if (type == 1) {
+        predicted = a;
+      } else if (type == 2) {
+        predicted = b;
+      } else if (type == 3) {
+        predicted = (a + b) / 2;
+      } else if (type == 4) {
+        auto p = a + b - c;
+        auto pa = std::abs(p - a);
+        auto pb = std::abs(p - b);
+        auto pc = std::abs(p - c);
+        predicted = pa <= pb && pa <= pc ? a : pb <= pc ? b : c;
+      }
+      pixels.push_back(static_cast<unsigned char>(in[i + 1] + predicted));
+    }
+  }
+  return pixels;
+}
+
+auto scene(int width, int height) -> Canvas {
+  auto c = Canvas{width, height};
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      auto inside = (x - width / 2) * (x - width / 2) +
+                        (y - height / 2) * (y - height / 2) <
+                    width * height / 8;
+      c.write_pixel(x, y,
+                    inside ? Color{0.9f, 0.2f * y / height, 0.1f}
+                           : Color{0.0f, 0.0f, 0.05f * x / width});
+    }
+  }
+  return c;
+}
+} // namespace
+
+TEST_CASE("CRC-32 and Adler-32 give the standard check values") {
+  auto const *digits = reinterpret_cast<unsigned char const *>("123456789");
+  CHECK(crc32(digits, 9) == 0xcbf43926U);
+  CHECK(crc32(digits + 4, 5, crc32(digits, 4)) == 0xcbf43926U);
+  CHECK(adler32(digits, 9) == 0x091e01deU);
+  CHECK(adler32(digits, 0) == 1);
+}
+
+TEST_CASE("Compressed data inflates back to what it was") {
+  auto pool = ThreadPool{3};
+  auto random = std::mt19937{7};
+  auto noise = Bytes(100000);
+  for (auto &b : noise) {
+    b = static_cast<unsigned char>(random());
+  }
+  // Enough to need several blocks, repeating with a period that spans them
+  auto repeating = Bytes(1000000);
+  for (std::size_t i = 0; i < repeating.size(); ++i) {
+    repeating[i] = static_cast<unsigned char>((i * i) % 40000 % 251);
+  }
+  auto zeros = Bytes(600000, 0);
+
+  for (auto const &data : {Bytes{}, Bytes{42}, noise, repeating, zeros}) {
+    auto compressed = zlib_compress(data.data(), data.size(), pool);
+    CHECK(inflate(compressed) == data);
+  }
+  auto compressed = zlib_compress(zeros.data(), zeros.size(), pool);
+  CHECK(compressed.size() < zeros.size() / 100);
+}
+
+TEST_CASE("Compression doesn't depend on the number of threads") {
+  auto data = Bytes(700000);
+  for (std::size_t i = 0; i < data.size(); ++i) {
+    data[i] = static_cast<unsigned char>(i / 1000 + i % 7);
+  }
+  auto one = ThreadPool{1};
+  auto four = ThreadPool{4};
+  CHECK(zlib_compress(data.data(), data.size(), one) ==
+        zlib_compress(data.data(), data.size(), four));
+}
+
+TEST_CASE("A PNG holds the canvas's PPM values") {
+  auto pool = ThreadPool{2};
+  auto c = scene(123, 77);
+  auto png = encode_png(c, pool);
+
+  REQUIRE(png.substr(0, 8) == "\x89PNG\r\n\x1a\n");
+  // Each chunk is length, type, data and a CRC of the type and data
+  auto chunks = std::vector<std::string>{};
+  auto idat = std::string{};
+  for (std::size_t pos = 8; pos < png.size();) {
+    auto length = u32_at(png, pos);
+    auto type = png.substr(pos + 4, 4);
+    auto const *typed = reinterpret_cast<unsigned char const *>(png.data());
+    CHECK(crc32(typed + pos + 4, length + 4) ==
+          u32_at(png, pos + 8 + length));
+    chunks.push_back(type);
+    if (type == "IHDR") {
+      CHECK(u32_at(png, pos + 8) == 123);
+      CHECK(u32_at(png, pos + 12) == 77);
+      CHECK(png.substr(pos + 16, 5) == std::string{"\x08\x02\x00\x00\x00", 5});
+    } else if (type == "IDAT") {
+      idat += png.substr(pos + 8, length);
+    }
+    pos += 12 + length;
+  }
+  CHECK(chunks == std::vector<std::string>{"IHDR", "IDAT", "IEND"});
+
+  auto pixels = unfilter(inflate(idat), 123, 77);
+  REQUIRE(pixels.size() == std::size_t{123} * 77 * 3);
+  auto expected = Bytes{};
+  for (int y = 0; y < 77; ++y) {
+    for (int x = 0; x < 123; ++x) {
+      auto p = c.pixel_at(x, y);
+      for (auto v : {p.r, p.g, p.b}) {
+        expected.push_back(static_cast<unsigned char>(ppm_value(v)));
+      }
+    }
+  }
+  CHECK(pixels == expected);
+  CHECK(png.size() < expected.size() / 4);
+}
+
+TEST_CASE("A PNG is the same whatever format the canvas stores") {
+  auto pool = ThreadPool{2};
+  auto c = scene(40, 30);
+  CHECK(encode_png(c.converted(raytrace::PixelFormat::rgba8), pool) ==
+        encode_png(c, pool));
+}
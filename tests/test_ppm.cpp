@@ -0,0 +1,112 @@
+#include "ppm.h"
+
+#include "doctest.h"
+
+#include "canvas.h"
+#include "color.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <string>
+
+using raytrace::append_ppm_rows;
+using raytrace::Canvas;
+using raytrace::Color;
+using raytrace::encode_ppm;
+using raytrace::ppm_header;
+using raytrace::ppm_value;
+using raytrace::PpmFormat;
+using raytrace::ThreadPool;
+
+namespace {
+// The plain PPM encoder as first written, one std::to_string at a time
+auto reference_ppm(Canvas const &c) -> std::string {
+  auto ppm = std::ostringstream{};
+  ppm << "P3\n" << c.width() << " " << c.height() << "\n255\n";
+  auto line = std::string{};
+  for (int y = 0; y < c.height(); ++y) {
+    for (int x = 0; x < c.width(); ++x) {
+      auto p = c.pixel_at(x, y);
+      for (auto v : {p.r, p.g, p.b}) {
+        auto s = std::to_string(
+            std::clamp(static_cast<int>(std::ceil(v * 255)), 0, 255));
+        if (line.size() + s.size() + 1 > 70) {
+          ppm << line << "\n";
+          line.clear();
+        }
+        if (!line.empty()) {
+          line.append(" ");
+        }
+        line.append(s);
+      }
+    }
+    ppm << line << "\n";
+    line.clear();
+  }
+  return ppm.str();
+}
+
+// Every value from 0 to 255, in runs that wrap lines at every offset
+auto all_values() -> Canvas {
+  auto c = Canvas{97, 11};
+  auto v = 0;
+  for (int y = 0; y < c.height(); ++y) {
+    for (int x = 0; x < c.width(); ++x) {
+      c.write_pixel(x, y,
+                    Color{(v % 256) / 255.0f, ((v * 7) % 256) / 255.0f,
+                          ((v * 13 + 5) % 300) / 255.0f - 0.1f});
+      ++v;
+    }
+  }
+  return c;
+}
+} // namespace
+
+TEST_CASE("PPM values are rounded up and clamped") {
+  CHECK(ppm_value(0.0f) == 0);
+  CHECK(ppm_value(0.5f) == 128);
+  CHECK(ppm_value(1.0f) == 255);
+  CHECK(ppm_value(1.5f) == 255);
+  CHECK(ppm_value(-0.5f) == 0);
+}
+
+TEST_CASE("PPM headers") {
+  CHECK(ppm_header(PpmFormat::plain, 5, 3) == "P3\n5 3\n255\n");
+  CHECK(ppm_header(PpmFormat::raw, 5, 3) == "P6\n5 3\n255\n");
+}
+
+TEST_CASE("Bands of rows encode to the same image as the whole canvas") {
+  auto c = Canvas{13, 7};
+  for (int y = 0; y < c.height(); ++y) {
+    for (int x = 0; x < c.width(); ++x) {
+      c.write_pixel(x, y, Color{x / 12.0f, y / 6.0f, 0.5f});
+    }
+  }
+  for (auto format : {PpmFormat::plain, PpmFormat::raw}) {
+    auto bands = ppm_header(format, c.width(), c.height());
+    append_ppm_rows(bands, format, c, 0, 3);
+    append_ppm_rows(bands, format, c, 3, 4);
+    append_ppm_rows(bands, format, c, 4, 7);
+    CHECK(bands == (format == PpmFormat::plain ? c.to_ppm()
+                                               : c.to_ppm_binary()));
+  }
+}
+
+TEST_CASE("Plain PPM is the same as the original encoder's") {
+  auto c = all_values();
+  CHECK(c.to_ppm() == reference_ppm(c));
+  auto bytes = c.converted(raytrace::PixelFormat::rgb8);
+  CHECK(bytes.to_ppm() == reference_ppm(c));
+}
+
+TEST_CASE("Encoding in parallel gives the same bytes") {
+  auto c = all_values();
+  auto pool = ThreadPool{3};
+  CHECK(encode_ppm(c, PpmFormat::plain, pool) == c.to_ppm());
+  CHECK(encode_ppm(c, PpmFormat::raw, pool) == c.to_ppm_binary());
+
+  auto one_row = Canvas{5, 1};
+  CHECK(encode_ppm(one_row, PpmFormat::plain, pool) == one_row.to_ppm());
+}
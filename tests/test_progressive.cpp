@@ -0,0 +1,86 @@
+#include "progressive.h"
+
+#include "doctest.h"
+
+#include "camera.h"
+#include "canvas.h"
+#include "fixtures.h"
+#include "primitives.h"
+#include "thread_pool.h"
+#include "world.h"
+
+#include <chrono>
+#include <vector>
+
+using fixtures::small_camera;
+using raytrace::Canvas;
+using raytrace::default_world;
+using raytrace::ProgressiveOptions;
+using raytrace::render_progressive;
+using raytrace::ThreadPool;
+using raytrace::Upsample;
+using std::chrono::hours;
+using std::chrono::steady_clock;
+
+TEST_CASE("A progressive render with time to spare is a full render") {
+  auto w = default_world();
+  auto expected = small_camera().render(w).to_ppm();
+  auto pool = ThreadPool{2};
+
+  auto passes = std::vector<int>{};
+  auto options = ProgressiveOptions{};
+  options.on_pass = [&passes](Canvas const &, int spacing) {
+    passes.push_back(spacing);
+  };
+  auto result = render_progressive(small_camera(), w, pool,
+                                   steady_clock::now() + hours{1}, options);
+
+  CHECK(result.complete());
+  CHECK(result.image.to_ppm() == expected);
+  // Every pixel was traced exactly once over the three passes
+  CHECK(result.traced == 21 * 13);
+  CHECK(passes == std::vector<int>{4, 2, 1});
+}
+
+TEST_CASE("A progressive render past its deadline finishes the first pass") {
+  auto w = default_world();
+  auto full = small_camera().render(w);
+  auto pool = ThreadPool{2};
+
+  SUBCASE("Nearest neighbor") {
+    auto options = ProgressiveOptions{};
+    options.upsample = Upsample::nearest;
+    auto result = render_progressive(small_camera(), w, pool,
+                                     steady_clock::now() - hours{1}, options);
+    CHECK_FALSE(result.complete());
+    CHECK(result.spacing == 4);
+    CHECK(result.traced == 6 * 4);
+    CHECK(result.image.pixel_at(8, 4) == full.pixel_at(8, 4));
+    CHECK(result.image.pixel_at(9, 5) == full.pixel_at(8, 4));
+    CHECK(result.image.pixel_at(10, 6) == full.pixel_at(12, 8));
+    CHECK(result.image.pixel_at(20, 12) == full.pixel_at(20, 12));
+  }
+
+  SUBCASE("Bilinear") {
+    auto options = ProgressiveOptions{};
+    options.coarsest = 2;
+    auto result = render_progressive(small_camera(), w, pool,
+                                     steady_clock::now() - hours{1}, options);
+    CHECK(result.spacing == 2);
+    CHECK(result.image.pixel_at(10, 6) == full.pixel_at(10, 6));
+    CHECK(result.image.pixel_at(11, 6) ==
+          full.pixel_at(10, 6) * 0.5f + full.pixel_at(12, 6) * 0.5f);
+    CHECK(result.image.pixel_at(10, 7) ==
+          full.pixel_at(10, 6) * 0.5f + full.pixel_at(10, 8) * 0.5f);
+  }
+}
+
+TEST_CASE("The coarsest spacing must be a power of two") {
+  auto w = default_world();
+  auto pool = ThreadPool{1};
+  auto options = ProgressiveOptions{};
+  options.coarsest = 3;
+  CHECK_THROWS_AS(
+      render_progressive(small_camera(), w, pool, steady_clock::now(), options),
+      std::invalid_argument);
+}
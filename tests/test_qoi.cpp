@@ -0,0 +1,130 @@
+#include "qoi.h"
+
+#include "doctest.h"
+
+#include "canvas.h"
+#include "color.h"
+#include "ppm.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using raytrace::Canvas;
+using raytrace::Color;
+using raytrace::encode_qoi;
+using raytrace::ppm_value;
+
+namespace {
+using Bytes = std::vector<unsigned char>;
+
+auto u32_at(std::string const &s, std::size_t pos) -> std::uint32_t {
+  auto v = std::uint32_t{0};
+  for (std::size_t i = 0; i < 4; ++i) {
+    v = v << 8 | static_cast<unsigned char>(s[pos + i]);
+  }
+  return v;
+}
+
+// A QOI decoder following the specification, giving r g b for each pixel
+auto decode_qoi(std::string const &qoi) -> Bytes {
+  auto count = std::size_t{u32_at(qoi, 4)} * u32_at(qoi, 8);
+  auto pixels = Bytes{};
+  unsigned char seen[64][4] = {};
+  unsigned char px[4] = {0, 0, 0, 255};
+  auto pos = std::size_t{14};
+  auto next = [&]() { return static_cast<unsigned char>(qoi.at(pos++)); };
+  while (pixels.size() < count * 3) {
+    auto op = next();
+    auto run = 1;
+    if (op == 0xfe) {
+      px[0] = next();
+      px[1] = next();
+      px[2] = next();
+    } else if (op == 0xff) {
+      px[0] = next();
+      px[1] = next();
+      px[2] = next();
+      px[3] = next();
+    } else if ((op & 0xc0) == 0x00) {
+      std::copy(seen[op], seen[op] + 4, px);
+    } else if ((op & 0xc0) == 0x40) {
+      px[0] = static_cast<unsigned char>(px[0] + ((op >> 4) & 3) - 2);
+      px[1] = static_cast<unsigned char>(px[1] + ((op >> 2) & 3) - 2);
+      px[2] = static_cast<unsigned char>(px[2] + (op & 3) - 2);
+    } else if ((op & 0xc0) == 0x80) {
+      auto dg = (op & 0x3f) - 32;
+      auto rb = next();
+      px[0] = static_cast<unsigned char>(px[0] + dg + (rb >> 4) - 8);
+      px[1] = static_cast<unsigned char>(px[1] + dg);
+      px[2] = static_cast<unsigned char>(px[2] + dg + (rb & 0x0f) - 8);
+    } else {
+      run = (op & 0x3f) + 1;
+    }
+    auto index = (px[0] * 3 + px[1] * 5 + px[2] * 7 + px[3] * 11) % 64;
+    std::copy(px, px + 4, seen[index]);
+    for (int i = 0; i < run; ++i) {
+      pixels.insert(pixels.end(), px, px + 3);
+    }
+  }
+  CHECK(qoi.substr(pos) == std::string("\0\0\0\0\0\0\0\1", 8));
+  return pixels;
+}
+
+auto ppm_values(Canvas const &c) -> Bytes {
+  auto values = Bytes{};
+  for (int y = 0; y < c.height(); ++y) {
+    for (int x = 0; x < c.width(); ++x) {
+      auto p = c.pixel_at(x, y);
+      for (auto v : {p.r, p.g, p.b}) {
+        values.push_back(static_cast<unsigned char>(ppm_value(v)));
+      }
+    }
+  }
+  return values;
+}
+} // namespace
+
+TEST_CASE("A QOI file starts with its header") {
+  auto qoi = encode_qoi(Canvas{300, 2});
+  CHECK(qoi.substr(0, 4) == "qoif");
+  CHECK(u32_at(qoi, 4) == 300);
+  CHECK(u32_at(qoi, 8) == 2);
+  CHECK(qoi[12] == 3);
+  CHECK(qoi[13] == 0);
+  // 600 black pixels are ten runs of at most 62
+  CHECK(qoi.size() == 14 + 10 + 8);
+}
+
+TEST_CASE("A QOI file decodes to the canvas's PPM values") {
+  // Runs, small and large steps, and colours seen before
+  auto c = Canvas{67, 23};
+  for (int y = 0; y < c.height(); ++y) {
+    for (int x = 0; x < c.width(); ++x) {
+      auto band = x / 10;
+      if (band % 3 == 0) {
+        c.write_pixel(x, y, Color{0.5f, 0.5f, 0.5f});
+      } else if (band % 3 == 1) {
+        c.write_pixel(x, y, Color{x / 67.0f, y / 23.0f, 0.3f});
+      } else {
+        c.write_pixel(x, y, Color{(x * 37 % 11) / 10.0f,
+                                  (y * 13 % 7) / 6.0f, (x ^ y) % 2 * 1.0f});
+      }
+    }
+  }
+  CHECK(decode_qoi(encode_qoi(c)) == ppm_values(c));
+  auto bytes = c.converted(raytrace::PixelFormat::rgb8);
+  CHECK(encode_qoi(bytes) == encode_qoi(c));
+}
+
+TEST_CASE("QOI only indexes colours it has stored") {
+  // Black hashes to a slot that starts out empty, not black, so it must
+  // not be emitted as an index before it's been seen
+  auto c = Canvas{5, 1};
+  c.write_pixel(0, 0, Color{1.0f, 0.0f, 0.0f});
+  c.write_pixel(1, 0, Color{0.0f, 0.0f, 0.0f});
+  c.write_pixel(2, 0, Color{0.0f, 1.0f, 0.0f});
+  c.write_pixel(3, 0, Color{0.0f, 0.0f, 1.0f});
+  c.write_pixel(4, 0, Color{0.0f, 1.0f, 0.0f});
+  CHECK(decode_qoi(encode_qoi(c)) == ppm_values(c));
+}
@@ -0,0 +1,148 @@
+#include "quantize.h"
+
+#include "doctest.h"
+
+#include "canvas.h"
+#include "color.h"
+#include "ppm.h"
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+using raytrace::Canvas;
+using raytrace::Color;
+using raytrace::PixelFormat;
+using raytrace::ppm_value;
+using raytrace::Quantization;
+using raytrace::quantize_row;
+
+namespace {
+using Bytes = std::vector<unsigned char>;
+
+auto row_of(Canvas const &c, int y, Quantization const &q = {}) -> Bytes {
+  auto values = Bytes{};
+  quantize_row(c, y, values, q);
+  return values;
+}
+
+// A row of a constant colour, long enough for the vector loop and its tail
+auto flat(Color color, int width = 37, int height = 4) -> Canvas {
+  auto c = Canvas{width, height};
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      c.write_pixel(x, y, color);
+    }
+  }
+  return c;
+}
+} // namespace
+
+TEST_CASE("Quantizing by default matches ppm_value() for every level") {
+  // Every level, just either side of it, and out of range values
+  auto channels = std::vector<float>{-1.0f, -0.0f, 1.5f, 1e30f, -1e30f};
+  for (int level = 0; level <= 255; ++level) {
+    auto exact = level / 255.0f;
+    channels.push_back(exact);
+    channels.push_back(std::nextafter(exact, 0.0f));
+    channels.push_back(std::nextafter(exact, 1.0f));
+  }
+  auto width = static_cast<int>(channels.size() + 2) / 3;
+  auto c = Canvas{width, 1};
+  for (int x = 0; x < width; ++x) {
+    auto at = [&](int i) {
+      auto n = static_cast<std::size_t>(x * 3 + i);
+      return n < channels.size() ? channels[n] : 0.0f;
+    };
+    c.write_pixel(x, 0, Color{at(0), at(1), at(2)});
+  }
+
+  auto values = row_of(c, 0);
+  REQUIRE(values.size() == static_cast<std::size_t>(width) * 3);
+  for (int x = 0; x < width; ++x) {
+    auto p = c.pixel_at(x, 0);
+    CHECK(values[x * 3] == ppm_value(p.r));
+    CHECK(values[x * 3 + 1] == ppm_value(p.g));
+    CHECK(values[x * 3 + 2] == ppm_value(p.b));
+  }
+}
+
+TEST_CASE("NaN and infinity quantize to the ends of the range") {
+  auto nan = std::numeric_limits<float>::quiet_NaN();
+  auto inf = std::numeric_limits<float>::infinity();
+  auto c = flat(Color{nan, inf, -inf}, 20, 1);
+  auto values = row_of(c, 0);
+  for (std::size_t i = 0; i < values.size(); i += 3) {
+    CHECK(values[i] == 0);
+    CHECK(values[i + 1] == 255);
+    CHECK(values[i + 2] == 0);
+  }
+}
+
+TEST_CASE("Exposure scales by powers of two") {
+  auto c = flat(Color{0.1f, 0.2f, 0.3f});
+  auto q = Quantization{};
+  q.exposure = 1.0f;
+  CHECK(row_of(c, 0, q) == row_of(flat(Color{0.2f, 0.4f, 0.6f}), 0));
+  q.exposure = -2.0f;
+  CHECK(row_of(c, 0, q) == row_of(flat(Color{0.025f, 0.05f, 0.075f}), 0));
+}
+
+TEST_CASE("The sRGB curve brightens the mid tones") {
+  auto q = Quantization{};
+  q.srgb = true;
+  CHECK(row_of(flat(Color{0.0f, 1.0f, 2.0f}), 0, q)[0] == 0);
+  CHECK(row_of(flat(Color{0.0f, 1.0f, 2.0f}), 0, q)[1] == 255);
+  CHECK(row_of(flat(Color{0.0f, 1.0f, 2.0f}), 0, q)[2] == 255);
+  // 0.5 linear is 0.7354 encoded, 187.5 of 255
+  CHECK(row_of(flat(Color{0.5f, 0.5f, 0.5f}), 0, q)[0] == 188);
+  // 0.002 linear is on the straight part, 12.92 * 0.002 * 255 = 6.59
+  CHECK(row_of(flat(Color{0.002f, 0.002f, 0.002f}), 0, q)[0] == 7);
+
+  auto ramp = Canvas{256, 1};
+  for (int x = 0; x < 256; ++x) {
+    auto v = x / 255.0f;
+    ramp.write_pixel(x, 0, Color{v * v, v * v, v * v});
+  }
+  auto values = row_of(ramp, 0, q);
+  for (std::size_t i = 3; i < values.size(); ++i) {
+    CHECK(values[i] >= values[i - 3]);
+  }
+}
+
+TEST_CASE("Ordered dithering averages out to the true level") {
+  auto q = Quantization{};
+  q.dither = true;
+  // Halfway between 127 and 128
+  auto c = flat(Color{127.5f / 255, 127.25f / 255, 10.0f / 255}, 8, 4);
+  auto red = 0;
+  auto green = 0;
+  for (int y = 0; y < 4; ++y) {
+    auto values = row_of(c, y, q);
+    for (int x = 0; x < 4; ++x) {
+      CHECK((values[x * 3] == 127 || values[x * 3] == 128));
+      red += values[x * 3];
+      green += values[x * 3 + 1];
+      // Whole levels stay put
+      CHECK(values[x * 3 + 2] == 10);
+    }
+  }
+  CHECK(red == 127 * 16 + 8);
+  CHECK(green == 127 * 16 + 4);
+}
+
+TEST_CASE("Other canvas formats quantize the same way") {
+  auto c = Canvas{19, 2};
+  for (int x = 0; x < 19; ++x) {
+    c.write_pixel(x, 1, Color{x / 18.0f, 1 - x / 18.0f, 0.5f});
+  }
+  auto halves = c.converted(PixelFormat::rgb_half);
+  CHECK(row_of(halves, 1) == row_of(halves.converted(PixelFormat::rgb_float),
+                                    1));
+  auto bytes = c.converted(PixelFormat::rgba8);
+  CHECK(row_of(bytes, 1) == row_of(c, 1));
+  // 8 bit pixels are already quantized
+  auto q = Quantization{};
+  q.exposure = 3.0f;
+  CHECK(row_of(bytes, 1, q) == row_of(c, 1));
+}
@@ -0,0 +1,114 @@
+#include "relight.h"
+
+#include "doctest.h"
+
+#include "camera.h"
+#include "canvas.h"
+#include "color.h"
+#include "fixtures.h"
+#include "primitives.h"
+#include "sphere.h"
+#include "transformations.h"
+#include "world.h"
+
+#include <memory>
+
+using fixtures::same_image;
+using raytrace::Camera;
+using raytrace::Color;
+using raytrace::default_world;
+using raytrace::epsilon;
+using raytrace::pi;
+using raytrace::Point;
+using raytrace::Relighter;
+using raytrace::render_gbuffer;
+using raytrace::shade_gbuffer;
+using raytrace::Sphere;
+using raytrace::Vector3;
+using raytrace::view_transform;
+
+namespace {
+auto test_camera() -> Camera {
+  return Camera{11, 11, pi / 2,
+                view_transform(Point{0.0f, 0.0f, -5.0f},
+                               Point{0.0f, 0.0f, 0.0f},
+                               Vector3{0.0f, 1.0f, 0.0f})};
+}
+} // namespace
+
+TEST_CASE("A G-buffer records the primary hit of each pixel") {
+  auto w = default_world();
+  auto c = test_camera();
+  auto gbuffer = render_gbuffer(c, w);
+  CHECK(gbuffer.width() == 11);
+  CHECK(gbuffer.height() == 11);
+  REQUIRE(gbuffer.at(5, 5).has_value());
+  CHECK(gbuffer.at(5, 5)->intersection().object == &w[0]);
+  CHECK(!gbuffer.at(0, 0).has_value());
+}
+
+TEST_CASE("Shading a G-buffer matches rendering") {
+  auto w = default_world();
+  auto c = test_camera();
+  auto rendered = c.render(w);
+  auto shaded = shade_gbuffer(w, render_gbuffer(c, w));
+  CHECK(same_image(rendered, shaded));
+}
+
+TEST_CASE("Relighting reuses primary hits until geometry or camera change") {
+  auto w = default_world();
+  auto relighter = Relighter{test_camera()};
+
+  auto first = relighter.render(w);
+  CHECK(!relighter.reused());
+  CHECK(first.pixel_at(5, 5) == Color{0.38066f, 0.47583f, 0.2855f});
+
+  SUBCASE("Moving the light only reshades") {
+    w.light().position = Point{10.0f, 10.0f, -10.0f};
+    auto relit = relighter.render(w);
+    CHECK(relighter.reused());
+    auto expected = test_camera().render(w);
+    CHECK(same_image(relit, expected));
+  }
+
+  SUBCASE("Changing a material only reshades") {
+    w[0].material().color(Color{1.0f, 0.0f, 0.0f});
+    auto relit = relighter.render(w);
+    CHECK(relighter.reused());
+    auto expected = test_camera().render(w);
+    CHECK(same_image(relit, expected));
+  }
+
+  SUBCASE("Moving a shape recasts primary rays") {
+    w[0].transform(w[0].transform().translated(0.5f, 0.0f, 0.0f));
+    relighter.render(w);
+    CHECK(!relighter.reused());
+  }
+
+  SUBCASE("Even a tiny move recasts primary rays") {
+    w[0].transform(w[0].transform().translated(epsilon / 10, 0.0f, 0.0f));
+    relighter.render(w);
+    CHECK(!relighter.reused());
+  }
+
+  SUBCASE("Adding a shape recasts primary rays") {
+    w.push_back(std::make_unique<Sphere>(Sphere{}));
+    relighter.render(w);
+    CHECK(!relighter.reused());
+  }
+
+  SUBCASE("Another world with the same shapes recasts primary rays") {
+    auto other = default_world();
+    auto relit = relighter.render(other);
+    CHECK(!relighter.reused());
+    CHECK(same_image(relit, first));
+  }
+
+  SUBCASE("Moving the camera recasts primary rays") {
+    relighter.camera(test_camera().transform(view_transform(
+        Point{0.0f, 1.0f, -5.0f}, Point{0.0f, 0.0f, 0.0f},
+        Vector3{0.0f, 1.0f, 0.0f})));
+    relighter.render(w);
+    CHECK(!relighter.reused());
+  }
+}
@@ -0,0 +1,147 @@
+#include "render_job.h"
+
+#include "doctest.h"
+
+#include "camera.h"
+#include "canvas.h"
+#include "fixtures.h"
+#include "primitives.h"
+#include "thread_pool.h"
+#include "world.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using fixtures::Faulty;
+using fixtures::small_camera;
+using raytrace::Canvas;
+using raytrace::default_world;
+using raytrace::render_async;
+using raytrace::ThreadPool;
+using raytrace::Tile;
+
+TEST_CASE("An asynchronous render matches a blocking one") {
+  auto w = default_world();
+  auto expected = small_camera().render(w).to_ppm();
+
+  auto pool = ThreadPool{2};
+  auto job = render_async(small_camera(), w, pool, {}, 4);
+  CHECK(job.tile_count() == 24);
+  CHECK(job.wait().to_ppm() == expected);
+  CHECK(job.done());
+  CHECK_FALSE(job.cancelled());
+  CHECK(job.tiles_completed() == 24);
+}
+
+TEST_CASE("Tile callbacks see each finished tile once") {
+  auto w = default_world();
+  auto expected = small_camera().render(w);
+
+  auto pool = ThreadPool{2};
+  auto seen = std::vector<int>(21 * 13, 0);
+  auto matches = true;
+  auto job = render_async(
+      small_camera(), w, pool, [&](Tile tile, Canvas const &image) {
+        for (int y = tile.y; y < tile.y + tile.height; ++y) {
+          for (int x = tile.x; x < tile.x + tile.width; ++x) {
+            ++seen[static_cast<std::size_t>(y * 21 + x)];
+            matches =
+                matches && image.pixel_at(x, y) == expected.pixel_at(x, y);
+          }
+        }
+      });
+  job.wait();
+  CHECK(matches);
+  CHECK(std::count(seen.begin(), seen.end(), 1) == 21 * 13);
+}
+
+TEST_CASE("Cancelling a render skips the tiles that haven't started") {
+  auto w = default_world();
+  auto pool = ThreadPool{1};
+
+  // Hold the only worker until the job is cancelled
+  auto release = std::promise<void>{};
+  auto blocked = pool.submit(
+      [released = release.get_future().share()]() { released.wait(); });
+
+  auto job = render_async(small_camera(), w, pool, {}, 4);
+  job.cancel();
+  release.set_value();
+  blocked.get();
+
+  job.wait();
+  CHECK(job.cancelled());
+  CHECK(job.done());
+  CHECK(job.tiles_completed() == 0);
+}
+
+TEST_CASE("A throwing callback stops the render and is rethrown") {
+  auto w = default_world();
+  auto pool = ThreadPool{1};
+  auto calls = std::atomic<int>{0};
+  auto job = render_async(
+      small_camera(), w, pool,
+      [&calls](Tile, Canvas const &) {
+        ++calls;
+        throw std::runtime_error("viewer closed");
+      },
+      4);
+  CHECK_THROWS_AS(job.wait(), std::runtime_error);
+  CHECK(calls == 1);
+  CHECK(job.cancelled());
+}
+
+TEST_CASE("A tile that fails to render stops the render and is rethrown") {
+  auto w = default_world();
+  w.push_back(std::make_unique<Faulty>());
+  auto pool = ThreadPool{2};
+  auto job = render_async(small_camera(), w, pool, {}, 4);
+  CHECK_THROWS_AS(job.wait(), std::runtime_error);
+  CHECK(job.done());
+  CHECK(job.cancelled());
+  CHECK(job.tiles_completed() == 0);
+}
+
+TEST_CASE("A slow tile callback doesn't hold up the render") {
+  auto w = default_world();
+  auto pool = ThreadPool{1};
+  auto rendered_all = std::promise<void>{};
+  auto all_done = rendered_all.get_future();
+  auto waited = std::future_status::timeout;
+  auto first = true;
+
+  // The first callback holds out until every tile is rendered, which only
+  // happens if the pool's one worker isn't the thread running it
+  auto job = render_async(
+      small_camera(), w, pool,
+      [&](Tile, Canvas const &) {
+        if (first) {
+          first = false;
+          waited = all_done.wait_for(std::chrono::seconds{10});
+        }
+      },
+      4);
+  while (job.tiles_completed() < job.tile_count()) {
+    std::this_thread::yield();
+  }
+  rendered_all.set_value();
+  job.wait();
+  CHECK(waited == std::future_status::ready);
+}
+
+TEST_CASE("A moved-from render job can't be waited on") {
+  auto w = default_world();
+  auto pool = ThreadPool{2};
+  auto job = render_async(small_camera(), w, pool, {}, 4);
+  auto moved = std::move(job);
+  CHECK_THROWS_AS(job.wait(), std::logic_error);
+  CHECK_THROWS_AS(job.cancel(), std::logic_error);
+  CHECK_THROWS_AS(job.done(), std::logic_error);
+  CHECK(moved.wait().width() == 21);
+}
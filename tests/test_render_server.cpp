@@ -0,0 +1,181 @@
+#include "render_server.h"
+
+#include "doctest.h"
+
+#include "camera.h"
+#include "fixtures.h"
+#include "primitives.h"
+#include "thread_pool.h"
+#include "world.h"
+
+#include <future>
+#include <memory>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+using fixtures::Faulty;
+using fixtures::small_camera;
+using raytrace::default_world;
+using raytrace::parse_render_request;
+using raytrace::pi;
+using raytrace::Point;
+using raytrace::RenderRequest;
+using raytrace::RenderServer;
+using raytrace::ThreadPool;
+using raytrace::Vector3;
+
+namespace {
+auto request() -> RenderRequest {
+  return RenderRequest{21,
+                       13,
+                       Point{0.0f, 0.0f, -5.0f},
+                       Point{0.0f, 0.0f, 0.0f},
+                       Vector3{0.0f, 1.0f, 0.0f},
+                       pi / 2};
+}
+
+auto expected_image() -> std::string {
+  auto w = default_world();
+  auto c = small_camera();
+  return c.render(w).to_ppm_binary();
+}
+} // namespace
+
+TEST_CASE("Parsing a render request") {
+  auto r = parse_render_request("21 13 0 0 -5 0 0 0 0 1 0 1.5707964");
+  CHECK(r.width == 21);
+  CHECK(r.height == 13);
+  CHECK(r.from == Point{0.0f, 0.0f, -5.0f});
+  CHECK(r.to == Point{0.0f, 0.0f, 0.0f});
+  CHECK(r.up == Vector3{0.0f, 1.0f, 0.0f});
+  CHECK(r.fov == doctest::Approx(pi / 2));
+  CHECK(r.camera() == request().camera());
+
+  CHECK_THROWS_AS(parse_render_request("21 13 0 0 -5"), std::invalid_argument);
+  CHECK_THROWS_AS(parse_render_request("0 13 0 0 -5 0 0 0 0 1 0 1"),
+                  std::invalid_argument);
+}
+
+TEST_CASE("A render request can't ask for a huge image") {
+  CHECK_NOTHROW(parse_render_request("4096 4096 0 0 -5 0 0 0 0 1 0 1"));
+  CHECK_THROWS_AS(parse_render_request("8193 1 0 0 -5 0 0 0 0 1 0 1"),
+                  std::invalid_argument);
+  CHECK_THROWS_AS(parse_render_request("8192 8192 0 0 -5 0 0 0 0 1 0 1"),
+                  std::invalid_argument);
+
+  auto pool = ThreadPool{1};
+  auto server = RenderServer{default_world(), pool};
+  auto in = std::istringstream{"render 100000 100000 0 0 -5 0 0 0 0 1 0 1\n"};
+  auto out = std::ostringstream{};
+  server.serve(in, out);
+  CHECK(out.str().rfind("error ", 0) == 0);
+}
+
+TEST_CASE("The server renders the same image as the camera") {
+  auto pool = ThreadPool{2};
+  auto server = RenderServer{default_world(), pool};
+  auto response = server.render(request());
+  CHECK(response.image == expected_image());
+  CHECK(response.timing.queued >= 0.0);
+  CHECK(response.timing.rendered >= 0.0);
+  CHECK(response.timing.encoded >= 0.0);
+}
+
+TEST_CASE("Concurrent requests beyond the limit wait their turn") {
+  auto pool = ThreadPool{2};
+  auto server = RenderServer{default_world(), pool, 2};
+  CHECK(server.max_concurrent() == 2);
+
+  auto pending = std::vector<std::future<std::string>>{};
+  for (int i = 0; i < 5; ++i) {
+    pending.push_back(std::async(std::launch::async, [&server]() {
+      return server.render(request()).image;
+    }));
+  }
+  auto expected = expected_image();
+  auto all_match = true;
+  for (auto &p : pending) {
+    all_match = all_match && p.get() == expected;
+  }
+  CHECK(all_match);
+}
+
+TEST_CASE("Serving a session of commands") {
+  auto pool = ThreadPool{1};
+  auto server = RenderServer{default_world(), pool};
+  auto in = std::istringstream{
+      "render 21 13 0 0 -5 0 0 0 0 1 0 1.5707964\n"
+      "\n"
+      "frobnicate\n"
+      "render 21 13\n"
+      "quit\n"
+      "render 21 13 0 0 -5 0 0 0 0 1 0 1.5707964\n"};
+  auto out = std::ostringstream{};
+  server.serve(in, out);
+
+  auto session = std::istringstream{out.str()};
+  auto word = std::string{};
+  int width = 0;
+  int height = 0;
+  std::size_t bytes = 0;
+  double queued = 0;
+  double rendered = 0;
+  double encoded = 0;
+  session >> word >> width >> height >> bytes >> queued >> rendered >>
+      encoded;
+  CHECK(word == "image");
+  CHECK(width == 21);
+  CHECK(height == 13);
+  session.get();
+  auto image = std::string(bytes, '\0');
+  session.read(image.data(), static_cast<std::streamsize>(bytes));
+  CHECK(image == expected_image());
+
+  auto line = std::string{};
+  std::getline(session, line);
+  CHECK(line == "error unknown command frobnicate");
+  std::getline(session, line);
+  CHECK(line.rfind("error ", 0) == 0);
+  CHECK_FALSE(std::getline(session, line));
+}
+
+TEST_CASE("An over-long request line ends the session") {
+  auto pool = ThreadPool{1};
+  auto server = RenderServer{default_world(), pool};
+  auto in = std::istringstream{
+      std::string(RenderServer::max_line_length + 1, 'x') + "\n" +
+      "render 21 13 0 0 -5 0 0 0 0 1 0 1.5707964\n"};
+  auto out = std::ostringstream{};
+  server.serve(in, out);
+  CHECK(out.str() == "error request line too long\n");
+}
+
+TEST_CASE("A session ends once its output fails") {
+  // Takes a few bytes, then fails as a socket does once the client has
+  // hung up
+  struct HungUp : std::streambuf {
+    int budget = 8;
+    auto overflow(int_type c) -> int_type override {
+      return budget-- > 0 ? traits_type::not_eof(c) : traits_type::eof();
+    }
+  };
+
+  auto pool = ThreadPool{1};
+  auto server = RenderServer{default_world(), pool};
+  auto first = std::string{"render 21 13 0 0 -5 0 0 0 0 1 0 1.5707964\n"};
+  auto in = std::istringstream{first + "frobnicate\n" + first};
+  auto buffer = HungUp{};
+  auto out = std::ostream{&buffer};
+  server.serve(in, out);
+  CHECK(in.tellg() == static_cast<std::streamoff>(first.size()));
+}
+
+TEST_CASE("A render that fails is reported once every tile has stopped") {
+  auto w = default_world();
+  w.push_back(std::make_unique<Faulty>());
+  auto pool = ThreadPool{2};
+  auto server = RenderServer{std::move(w), pool};
+  CHECK_THROWS_AS(server.render(request()), std::runtime_error);
+}
@@ -0,0 +1,154 @@
+#include "reprojection.h"
+
+#include "doctest.h"
+
+#include "camera.h"
+#include "color.h"
+#include "primitives.h"
+#include "sphere.h"
+#include "thread_pool.h"
+#include "transformations.h"
+#include "world.h"
+
+#include <cmath>
+#include <memory>
+
+using raytrace::Camera;
+using raytrace::Color;
+using raytrace::default_world;
+using raytrace::identity_matrix;
+using raytrace::FrameHistory;
+using raytrace::pi;
+using raytrace::Point;
+using raytrace::PointLight;
+using raytrace::render_history;
+using raytrace::render_reprojected;
+using raytrace::ReprojectionStats;
+using raytrace::Sphere;
+using raytrace::ThreadPool;
+using raytrace::Vector3;
+using raytrace::view_transform;
+using raytrace::World;
+
+namespace {
+auto camera_from(Point from) -> Camera {
+  return Camera{41, 41, pi / 2,
+                view_transform(from, Point{0.0f, 0.0f, 0.0f},
+                               Vector3{0.0f, 1.0f, 0.0f})};
+}
+} // namespace
+
+TEST_CASE("The reuse rate of a frame") {
+  CHECK(ReprojectionStats{}.shading_reuse_rate() == 0.0f);
+  CHECK(ReprojectionStats{3, 1, 4}.shading_reuse_rate() == 0.75f);
+}
+
+TEST_CASE("A frame history records what each pixel hit") {
+  auto w = default_world();
+  auto pool = ThreadPool{2};
+  auto c = camera_from(Point{0.0f, 0.0f, -5.0f});
+  auto history = render_history(c, w, pool);
+
+  CHECK(history.width() == 41);
+  CHECK(history.height() == 41);
+  CHECK(history.stats().shaded == 41 * 41);
+  CHECK(history.stats().primary_rays == 41 * 41);
+  CHECK(history.shape_id(0, 0) == FrameHistory::no_shape);
+  CHECK(history.shape_id(20, 20) == w[0].id());
+  CHECK(history.position(20, 20) == Point{0.0f, 0.0f, -1.0f});
+  CHECK(history.color(20, 20) == c.render(w).pixel_at(20, 20));
+}
+
+TEST_CASE("Reprojecting into an unchanged camera reuses every hit") {
+  auto w = default_world();
+  auto pool = ThreadPool{2};
+  auto c = camera_from(Point{0.0f, 0.0f, -5.0f});
+  auto first = render_history(c, w, pool);
+  auto second = render_reprojected(c, w, first, pool);
+
+  auto hits = std::size_t{0};
+  for (int y = 0; y < 41; ++y) {
+    for (int x = 0; x < 41; ++x) {
+      hits += first.shape_id(x, y) != FrameHistory::no_shape ? 1 : 0;
+    }
+  }
+  CHECK(second.stats().shading_reused == hits);
+  CHECK(second.stats().shaded == 41 * 41 - hits);
+  CHECK(second.stats().primary_rays == 41 * 41);
+}
+
+TEST_CASE("Reprojecting after a small camera move") {
+  auto w = default_world();
+  auto pool = ThreadPool{2};
+  auto first = render_history(camera_from(Point{0.0f, 0.0f, -5.0f}), w, pool);
+  auto c = camera_from(Point{0.1f, 0.05f, -5.0f});
+  auto second = render_reprojected(c, w, first, pool);
+  auto expected = c.render(w);
+
+  CHECK(second.stats().shading_reused > 0);
+  CHECK(second.stats().shaded > 0);
+
+  // Reused pixels hit the same shape, with nearly the same color
+  auto same_shapes = true;
+  auto close_colors = true;
+  auto fresh = render_history(c, w, pool);
+  for (int y = 0; y < 41; ++y) {
+    for (int x = 0; x < 41; ++x) {
+      same_shapes =
+          same_shapes && second.shape_id(x, y) == fresh.shape_id(x, y);
+      auto a = second.color(x, y);
+      auto b = expected.pixel_at(x, y);
+      close_colors = close_colors && std::abs(a.r - b.r) < 0.1f &&
+                     std::abs(a.g - b.g) < 0.1f && std::abs(a.b - b.b) < 0.1f;
+    }
+  }
+  CHECK(same_shapes);
+  CHECK(close_colors);
+}
+
+TEST_CASE("Reprojection traces everything when the world changed") {
+  auto w = default_world();
+  auto pool = ThreadPool{2};
+  auto c = camera_from(Point{0.0f, 0.0f, -5.0f});
+  auto first = render_history(c, w, pool);
+  w.light().position = Point{10.0f, 10.0f, -10.0f};
+  auto second = render_reprojected(c, w, first, pool);
+  CHECK(second.stats().shading_reused == 0);
+  CHECK(second.color(20, 20) == c.render(w).pixel_at(20, 20));
+}
+
+TEST_CASE("Reprojection doesn't reuse pixels a nearer shape now covers") {
+  // A backdrop, and a ball just out of the first frame's view that the
+  // camera pans to bring in front of it
+  auto w = World{};
+  w.light(PointLight{Point{-10.0f, 10.0f, -10.0f}, Color{1, 1, 1}});
+  w.push_back(std::make_unique<Sphere>(
+      Sphere{identity_matrix().scaled(100.0f, 100.0f, 100.0f).translated(
+          0.0f, 0.0f, 110.0f)}));
+  w.push_back(std::make_unique<Sphere>(
+      Sphere{identity_matrix().scaled(0.5f, 0.5f, 0.5f).translated(
+          6.0f, 0.0f, 0.0f)}));
+  auto ball = w[1].id();
+
+  auto pool = ThreadPool{2};
+  auto first = render_history(camera_from(Point{0.0f, 0.0f, -5.0f}), w, pool);
+  auto c = Camera{41, 41, pi / 2,
+                  view_transform(Point{2.0f, 0.0f, -5.0f},
+                                 Point{2.0f, 0.0f, 0.0f},
+                                 Vector3{0.0f, 1.0f, 0.0f})};
+  auto second = render_reprojected(c, w, first, pool);
+  auto fresh = render_history(c, w, pool);
+
+  auto ball_pixels = 0;
+  auto same_shapes = true;
+  for (int y = 0; y < 41; ++y) {
+    for (int x = 0; x < 41; ++x) {
+      ball_pixels += fresh.shape_id(x, y) == ball ? 1 : 0;
+      same_shapes =
+          same_shapes && second.shape_id(x, y) == fresh.shape_id(x, y);
+    }
+  }
+  CHECK(ball_pixels > 0);
+  CHECK(second.stats().shading_reused > 0);
+  CHECK(same_shapes);
+}
@@ -0,0 +1,65 @@
+#include "sampling.h"
+
+#include "doctest.h"
+
+#include "primitives.h"
+
+#include <vector>
+
+using raytrace::AliasTable;
+using raytrace::Point;
+using raytrace::Rng;
+using raytrace::seed_for;
+
+TEST_CASE("Rng produces floats in [0, 1)") {
+  auto rng = Rng{42};
+  auto all_in_range = true;
+  for (int i = 0; i < 1000; ++i) {
+    auto f = rng.next_float();
+    all_in_range = all_in_range && f >= 0.0f && f < 1.0f;
+  }
+  CHECK(all_in_range);
+}
+
+TEST_CASE("Rngs with the same seed produce the same sequence") {
+  auto a = Rng{seed_for(Point{1.0f, 2.0f, 3.0f})};
+  auto b = Rng{seed_for(Point{1.0f, 2.0f, 3.0f})};
+  auto c = Rng{seed_for(Point{1.0f, 2.0f, 3.5f})};
+  auto all_same = true;
+  auto any_different = false;
+  for (int i = 0; i < 10; ++i) {
+    auto va = a.next();
+    all_same = all_same && va == b.next();
+    any_different = any_different || va != c.next();
+  }
+  CHECK(all_same);
+  CHECK(any_different);
+}
+
+TEST_CASE("An alias table with no weight is empty") {
+  CHECK(AliasTable{}.empty());
+  CHECK(AliasTable{std::vector<float>{}}.empty());
+  CHECK(AliasTable{std::vector<float>{0.0f, 0.0f}}.empty());
+}
+
+TEST_CASE("An alias table samples in proportion to the weights") {
+  auto table = AliasTable{std::vector<float>{1.0f, 0.0f, 3.0f, 4.0f}};
+  REQUIRE(table.size() == 4);
+  CHECK_EQ(table.probability(0), doctest::Approx(0.125f));
+  CHECK_EQ(table.probability(1), doctest::Approx(0.0f));
+  CHECK_EQ(table.probability(2), doctest::Approx(0.375f));
+  CHECK_EQ(table.probability(3), doctest::Approx(0.5f));
+
+  auto counts = std::vector<int>(4, 0);
+  auto rng = Rng{7};
+  constexpr auto draws = 80000;
+  for (int i = 0; i < draws; ++i) {
+    auto u1 = rng.next_float();
+    auto u2 = rng.next_float();
+    ++counts[table.sample(u1, u2)];
+  }
+  CHECK(counts[1] == 0);
+  CHECK_EQ(counts[0] / float{draws}, doctest::Approx(0.125f).epsilon(0.05));
+  CHECK_EQ(counts[2] / float{draws}, doctest::Approx(0.375f).epsilon(0.05));
+  CHECK_EQ(counts[3] / float{draws}, doctest::Approx(0.5f).epsilon(0.05));
+}
@@ -0,0 +1,200 @@
+#include "shared_framebuffer.h"
+
+#include "doctest.h"
+
+#include "camera.h"
+#include "canvas.h"
+#include "fixtures.h"
+#include "thread_pool.h"
+#include "world.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+using fixtures::Faulty;
+using fixtures::small_camera;
+using raytrace::Canvas;
+using raytrace::Color;
+using raytrace::default_world;
+using raytrace::FramebufferHeader;
+using raytrace::PixelFormat;
+using raytrace::render_shared;
+using raytrace::SharedFramebuffer;
+using raytrace::ThreadPool;
+
+namespace {
+// Unique to this process so parallel test runs don't collide
+auto segment_name() -> std::string {
+  return "/raytrace_test_fb_" + std::to_string(::getpid());
+}
+
+} // namespace
+
+TEST_CASE("Creating a shared framebuffer") {
+  auto fb = SharedFramebuffer::create(segment_name(), 21, 13,
+                                      PixelFormat::rgba8, 8);
+  auto const &h = fb.header();
+  CHECK(h.width == 21);
+  CHECK(h.height == 13);
+  CHECK(h.format == static_cast<std::uint32_t>(PixelFormat::rgba8));
+  CHECK(h.tile_size == 8);
+  CHECK(h.tiles_across == 3);
+  CHECK(h.tiles_down == 2);
+  CHECK(h.stride == 21 * 4);
+  CHECK(h.pixel_offset % 64 == 0);
+  CHECK(fb.canvas().width() == 21);
+  CHECK(fb.canvas().height() == 13);
+  CHECK(fb.canvas().format() == PixelFormat::rgba8);
+  CHECK(fb.tile_count() == 6);
+  for (std::size_t i = 0; i < fb.tile_count(); ++i) {
+    CHECK(fb.generation(i) == 0);
+  }
+}
+
+TEST_CASE("A shared framebuffer needs a size and a tile size") {
+  CHECK_THROWS_AS(SharedFramebuffer::create(segment_name(), 0, 13),
+                  std::out_of_range);
+  CHECK_THROWS_AS(
+      SharedFramebuffer::create(segment_name(), 21, 13, PixelFormat::rgb8, 0),
+      std::invalid_argument);
+}
+
+TEST_CASE("Shared framebuffer tiles are clipped at the edges") {
+  auto fb = SharedFramebuffer::create(segment_name(), 21, 13,
+                                      PixelFormat::rgb8, 8);
+  auto last = fb.tile(5);
+  CHECK(last.x == 16);
+  CHECK(last.y == 8);
+  CHECK(last.width == 5);
+  CHECK(last.height == 5);
+  CHECK(fb.tile_index(0, 0) == 0);
+  CHECK(fb.tile_index(8, 0) == 1);
+  CHECK(fb.tile_index(20, 12) == 5);
+}
+
+TEST_CASE("A tile's generation is odd while it's being written") {
+  auto fb = SharedFramebuffer::create(segment_name(), 21, 13,
+                                      PixelFormat::rgba8, 8);
+  fb.begin_write(2);
+  CHECK(fb.generation(2) == 1);
+  fb.end_write(2);
+  CHECK(fb.generation(2) == 2);
+  CHECK(fb.generation(1) == 0);
+}
+
+TEST_CASE("A viewer sees what the creator writes") {
+  auto fb = SharedFramebuffer::create(segment_name(), 21, 13,
+                                      PixelFormat::rgba8, 8);
+  auto viewer = SharedFramebuffer::open(segment_name());
+  CHECK(viewer.tile_count() == 6);
+
+  auto index = fb.tile_index(17, 9);
+  fb.begin_write(index);
+  fb.canvas().write_pixel(17, 9, Color{1.0f, 0.0f, 0.0f});
+  auto image = Canvas{21, 13, PixelFormat::rgba8};
+  CHECK_FALSE(viewer.read_tile(index, image));
+  fb.end_write(index);
+
+  CHECK(viewer.generation(index) == 2);
+  REQUIRE(viewer.read_tile(index, image));
+  CHECK(image.pixel_at(17, 9) == Color{1.0f, 0.0f, 0.0f});
+  CHECK(image.pixel_at(16, 8) == Color{0.0f, 0.0f, 0.0f});
+
+  auto floats = Canvas{21, 13};
+  REQUIRE(viewer.read_tile(index, floats));
+  CHECK(floats.pixel_at(17, 9) == Color{1.0f, 0.0f, 0.0f});
+}
+
+TEST_CASE("Opening a missing framebuffer fails") {
+  CHECK_THROWS_AS(SharedFramebuffer::open("/raytrace_test_fb_missing"),
+                  std::runtime_error);
+}
+
+TEST_CASE("Opening a framebuffer with a bad header fails") {
+  auto fb = SharedFramebuffer::create(segment_name(), 21, 13,
+                                      PixelFormat::rgba8, 8);
+  // Overwrite one field of the header in the segment, as another process
+  // could
+  auto corrupt = [](std::size_t offset, auto value) {
+    auto fd = ::shm_open(segment_name().c_str(), O_RDWR, 0);
+    REQUIRE(fd >= 0);
+    CHECK(::pwrite(fd, &value, sizeof value, static_cast<off_t>(offset)) ==
+          static_cast<ssize_t>(sizeof value));
+    ::close(fd);
+  };
+  auto const header = fb.header();
+
+  SUBCASE("No tile size") {
+    corrupt(offsetof(FramebufferHeader, tile_size), std::uint32_t{0});
+  }
+  SUBCASE("An unknown pixel format") {
+    corrupt(offsetof(FramebufferHeader, format), std::uint32_t{99});
+  }
+  SUBCASE("More tiles than the segment has counters for") {
+    corrupt(offsetof(FramebufferHeader, tiles_across), std::uint32_t{1u << 30});
+  }
+  SUBCASE("Pixels that start before the counters end") {
+    corrupt(offsetof(FramebufferHeader, pixel_offset), std::uint64_t{8});
+  }
+  SUBCASE("A size that overflows") {
+    corrupt(offsetof(FramebufferHeader, pixel_offset),
+            std::uint64_t{0} - header.stride * 2);
+  }
+  CHECK_THROWS_AS(SharedFramebuffer::open(segment_name()),
+                  std::runtime_error);
+}
+
+TEST_CASE("The name goes away with its creator") {
+  {
+    auto fb = SharedFramebuffer::create(segment_name(), 4, 4);
+  }
+  CHECK_THROWS_AS(SharedFramebuffer::open(segment_name()),
+                  std::runtime_error);
+}
+
+TEST_CASE("Rendering into a shared framebuffer") {
+  auto w = default_world();
+  auto c = small_camera();
+  auto expected = c.render(w).converted(PixelFormat::rgba8);
+
+  auto fb = SharedFramebuffer::create(segment_name(), c.h_size(), c.v_size());
+  auto pool = ThreadPool{3};
+  render_shared(c, w, pool, fb);
+  for (std::size_t i = 0; i < fb.tile_count(); ++i) {
+    CHECK(fb.generation(i) == 2);
+  }
+
+  auto viewer = SharedFramebuffer::open(segment_name());
+  auto image = Canvas{c.h_size(), c.v_size(), PixelFormat::rgba8};
+  for (std::size_t i = 0; i < viewer.tile_count(); ++i) {
+    CHECK(viewer.read_tile(i, image));
+  }
+  CHECK(image.to_ppm() == expected.to_ppm());
+}
+
+TEST_CASE("Rendering into a shared framebuffer of the wrong size fails") {
+  auto w = default_world();
+  auto fb = SharedFramebuffer::create(segment_name(), 10, 10);
+  auto pool = ThreadPool{1};
+  CHECK_THROWS_AS(render_shared(small_camera(), w, pool, fb),
+                  std::invalid_argument);
+}
+
+TEST_CASE("A tile that fails to render is still closed for writing") {
+  auto w = default_world();
+  w.push_back(std::make_unique<Faulty>());
+  auto c = small_camera();
+  auto fb = SharedFramebuffer::create(segment_name(), c.h_size(), c.v_size());
+  auto pool = ThreadPool{2};
+  CHECK_THROWS_AS(render_shared(c, w, pool, fb), std::runtime_error);
+  for (std::size_t i = 0; i < fb.tile_count(); ++i) {
+    CHECK(fb.generation(i) == 2);
+  }
+}
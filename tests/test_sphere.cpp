@@ -268,3 +268,13 @@ TEST_CASE("The hit is always the lowest nonnegative intersection") {
   REQUIRE(i.has_value());
   CHECK(*i == i4);
 }
+
+TEST_CASE("A sphere's bounds follow its transform") {
+  auto s = Sphere{identity_matrix().scaled(2.0f, 2.0f, 2.0f).translated(
+      0.0f, 1.0f, 0.0f)};
+  REQUIRE(s.local_bounds().has_value());
+  REQUIRE(s.bounds().has_value());
+  CHECK(s.bounds()->min == Point{-2.0f, -1.0f, -2.0f});
+  CHECK(s.bounds()->max == Point{2.0f, 3.0f, 2.0f});
+  CHECK(s.bounds(identity_matrix())->max == Point{1.0f, 1.0f, 1.0f});
+}
@@ -0,0 +1,95 @@
+#include "streaming.h"
+
+#include "doctest.h"
+
+#include "camera.h"
+#include "fixtures.h"
+#include "ppm.h"
+#include "primitives.h"
+#include "thread_pool.h"
+#include "world.h"
+
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+
+using fixtures::Faulty;
+using fixtures::small_camera;
+using raytrace::default_world;
+using raytrace::PpmFormat;
+using raytrace::render_pipelined;
+using raytrace::render_to_stream;
+using raytrace::StreamOptions;
+using raytrace::ThreadPool;
+
+TEST_CASE("Streaming a render band by band") {
+  auto w = default_world();
+  auto c = small_camera();
+  auto image = c.render(w);
+  auto pool = ThreadPool{2};
+
+  for (auto band_height : {1, 4, 13, 100}) {
+    auto options = StreamOptions{};
+    options.band_height = band_height;
+
+    auto plain = std::ostringstream{};
+    render_to_stream(c, w, pool, plain, options);
+    CHECK(plain.str() == image.to_ppm());
+
+    options.format = PpmFormat::raw;
+    auto raw = std::ostringstream{};
+    render_to_stream(c, w, pool, raw, options);
+    CHECK(raw.str() == image.to_ppm_binary());
+  }
+
+  auto options = StreamOptions{};
+  options.band_height = 0;
+  auto os = std::ostringstream{};
+  CHECK_THROWS_AS(render_to_stream(c, w, pool, os, options),
+                  std::invalid_argument);
+}
+
+TEST_CASE("Pipelining rendering, encoding and writing") {
+  auto w = default_world();
+  auto c = small_camera();
+  auto image = c.render(w);
+  auto pool = ThreadPool{2};
+
+  for (auto queue_depth : {1, 3}) {
+    auto options = StreamOptions{};
+    options.band_height = 2;
+    options.queue_depth = queue_depth;
+
+    auto plain = std::ostringstream{};
+    auto timing = render_pipelined(c, w, pool, plain, options);
+    CHECK(plain.str() == image.to_ppm());
+    CHECK(timing.rendered <= timing.encoded);
+    CHECK(timing.encoded <= timing.written);
+
+    options.format = PpmFormat::raw;
+    auto raw = std::ostringstream{};
+    render_pipelined(c, w, pool, raw, options);
+    CHECK(raw.str() == image.to_ppm_binary());
+  }
+
+  auto options = StreamOptions{};
+  options.queue_depth = 0;
+  auto os = std::ostringstream{};
+  CHECK_THROWS_AS(render_pipelined(c, w, pool, os, options),
+                  std::invalid_argument);
+}
+
+TEST_CASE("A streaming render that fails stops with its bands settled") {
+  auto w = default_world();
+  w.push_back(std::make_unique<Faulty>());
+  auto c = small_camera();
+  auto pool = ThreadPool{2};
+  auto options = StreamOptions{};
+  options.band_height = 2;
+
+  auto os = std::ostringstream{};
+  CHECK_THROWS_AS(render_to_stream(c, w, pool, os, options),
+                  std::runtime_error);
+  CHECK_THROWS_AS(render_pipelined(c, w, pool, os, options),
+                  std::runtime_error);
+}
@@ -0,0 +1,58 @@
+#include "thread_pool.h"
+
+#include "doctest.h"
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using raytrace::for_each_band;
+using raytrace::ThreadPool;
+
+TEST_CASE("A thread pool has the requested number of threads") {
+  CHECK(ThreadPool{3}.size() == 3);
+  CHECK(ThreadPool{}.size() > 0);
+}
+
+TEST_CASE("Submitted tasks run and return their results") {
+  auto pool = ThreadPool{4};
+  auto results = std::vector<std::future<int>>{};
+  for (int i = 0; i < 100; ++i) {
+    results.push_back(pool.submit([i]() { return i * i; }));
+  }
+  auto all_correct = true;
+  for (int i = 0; i < 100; ++i) {
+    all_correct = all_correct && results[i].get() == i * i;
+  }
+  CHECK(all_correct);
+}
+
+TEST_CASE("Destroying a thread pool finishes the tasks already submitted") {
+  auto count = std::atomic<int>{0};
+  {
+    auto pool = ThreadPool{2};
+    for (int i = 0; i < 50; ++i) {
+      pool.submit([&count]() { ++count; });
+    }
+  }
+  CHECK(count == 50);
+}
+
+TEST_CASE("A band that throws waits for the rest before rethrowing") {
+  auto pool = ThreadPool{2};
+  auto finished = std::atomic<int>{0};
+  CHECK_THROWS_AS(for_each_band(pool, 8,
+                                [&finished](int y0, int) {
+                                  if (y0 == 0) {
+                                    throw std::runtime_error("band failed");
+                                  }
+                                  std::this_thread::sleep_for(
+                                      std::chrono::milliseconds{10});
+                                  ++finished;
+                                }),
+                  std::runtime_error);
+  CHECK(finished == 7);
+}
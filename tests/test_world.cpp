@@ -4,10 +4,13 @@
 
 #include "color.h"
 #include "lights.h"
+#include "plane.h"
 #include "primitives.h"
 #include "ray.h"
 #include "sphere.h"
 
+#include <cmath>
+
 using raytrace::are_about_equal;
 using raytrace::Color;
 using raytrace::default_world;
@@ -16,12 +19,15 @@ using raytrace::identity_matrix;
 using raytrace::Intersection;
 using raytrace::Material;
 using raytrace::Point;
+using raytrace::Plane;
 using raytrace::PointLight;
 using raytrace::PreComps;
+using raytrace::rectangle_light;
 using raytrace::Ray;
 using raytrace::Sphere;
 using raytrace::Vector3;
 using raytrace::World;
+using raytrace::WorldSnapshot;
 
 namespace Colors = raytrace::colors;
 
@@ -134,6 +140,218 @@ TEST_CASE("shade_hit is given an intersection in shadow") {
   CHECK_EQ(c, Color{0.1f, 0.1f, 0.1f});
 }
 
+TEST_CASE("shade_hit with the light behind the surface is ambient only") {
+  auto w = World{};
+  w.light(PointLight{Point{0.0f, 0.0f, 10.0f}, Color{1.0f, 1.0f, 1.0f}});
+  auto s = Sphere{};
+  w.push_back(std::move(std::make_unique<Sphere>(s)));
+  auto r = Ray{Point{0.0f, 0.0f, -5.0f}, Vector3{0.0f, 0.0f, 1.0f}};
+  auto i = Intersection{4, &s};
+  auto comps = PreComps{i, r};
+  CHECK_EQ(w.shade_hit(comps), Color{0.1f, 0.1f, 0.1f});
+}
+
+TEST_CASE("shade_hit accumulates the contribution of every light") {
+  auto w = default_world();
+  auto r = Ray{Point{0.0f, 0.0f, -5.0f}, Vector3{0.0f, 0.0f, 1.0f}};
+  auto i = Intersection{4, &w[0]};
+  auto comps = PreComps{i, r};
+  auto single = w.shade_hit(comps);
+
+  w.lights().push_back(w.light());
+  CHECK(w.lights().size() == 2);
+  CHECK(w.shade_hit(comps) == single + single);
+}
+
+TEST_CASE("shade_hit ignores lights that are out of range") {
+  auto w = default_world();
+  auto r = Ray{Point{0.0f, 0.0f, -5.0f}, Vector3{0.0f, 0.0f, 1.0f}};
+  auto i = Intersection{4, &w[0]};
+  auto comps = PreComps{i, r};
+  auto single = w.shade_hit(comps);
+
+  auto far_light = PointLight{Point{0.0f, 0.0f, -100.0f}, Colors::white, 10.0f};
+  w.lights().push_back(far_light);
+  CHECK(w.shade_hit(comps) == single);
+
+  w.light(far_light);
+  CHECK(w.shade_hit(comps) == Colors::black);
+}
+
+TEST_CASE("Committing a world doesn't change how it shades") {
+  auto w = default_world();
+  w.lights().push_back(
+      PointLight{Point{10.0f, 10.0f, -10.0f}, Color{0.2f, 0.3f, 0.1f}});
+  w[1].material().specular(0.0f);
+  auto r = Ray{Point{0.0f, 0.0f, -5.0f}, Vector3{0.0f, 0.0f, 1.0f}};
+  auto outer = PreComps{Intersection{4, &w[0]}, r};
+  auto inner = PreComps{Intersection{4.5f, &w[1]}, r};
+  auto outer_color = w.shade_hit(outer);
+  auto inner_color = w.shade_hit(inner);
+
+  w.commit();
+  CHECK(w.materials().size() == 2);
+  CHECK(w[0].material_index() != w[1].material_index());
+  CHECK(w.shade_hit(outer) == outer_color);
+  CHECK(w.shade_hit(inner) == inner_color);
+}
+
+TEST_CASE("Edits after a commit are shaded with their new values") {
+  auto w = default_world();
+  w.commit();
+  auto r = Ray{Point{0.0f, 0.0f, -5.0f}, Vector3{0.0f, 0.0f, 1.0f}};
+  auto comps = PreComps{Intersection{4, &w[0]}, r};
+
+  SUBCASE("A material") {
+    w[0].material().color(Color{1.0f, 0.0f, 0.0f});
+    auto edited = w.shade_hit(comps);
+    w.commit();
+    CHECK(edited == w.shade_hit(comps));
+  }
+
+  SUBCASE("A light's intensity") {
+    w.light().intensity = Color{0.5f, 0.5f, 0.5f};
+    auto edited = w.shade_hit(comps);
+    w.commit();
+    CHECK(edited == w.shade_hit(comps));
+  }
+}
+
+TEST_CASE("A shape from outside the world is shaded with its own material") {
+  auto w = default_world();
+  w.commit();
+  auto stranger = Sphere{};
+  auto r = Ray{Point{0.0f, 0.0f, -5.0f}, Vector3{0.0f, 0.0f, 1.0f}};
+  auto comps = PreComps{Intersection{4, &stranger}, r};
+
+  auto fresh = default_world();
+  CHECK(w.shade_hit(comps) == fresh.shade_hit(comps));
+  CHECK(w.shade_hit(comps) != w.shade_hit(PreComps{Intersection{4, &w[0]}, r}));
+}
+
+TEST_CASE("Sampling lights converges to shading with every light") {
+  auto w = default_world();
+  w.lights({PointLight{Point{-10.0f, 10.0f, -10.0f}, Color{0.5f, 0.5f, 0.5f}},
+            PointLight{Point{10.0f, 10.0f, -10.0f}, Color{0.2f, 0.3f, 0.1f}},
+            PointLight{Point{0.0f, -10.0f, -10.0f}, Color{0.1f, 0.1f, 0.4f}},
+            PointLight{Point{0.0f, 0.0f, 10.0f}, Color{0.3f, 0.3f, 0.3f}}});
+  auto r = Ray{Point{0.0f, 0.0f, -5.0f}, Vector3{0.0f, 0.0f, 1.0f}};
+  auto i = Intersection{4, &w[0]};
+  auto comps = PreComps{i, r};
+  auto exhaustive = w.shade_hit(comps);
+
+  w.light_samples(20000).commit();
+  auto sampled = w.shade_hit(comps);
+  CHECK_EQ(sampled.r, doctest::Approx(exhaustive.r).epsilon(0.02));
+  CHECK_EQ(sampled.g, doctest::Approx(exhaustive.g).epsilon(0.02));
+  CHECK_EQ(sampled.b, doctest::Approx(exhaustive.b).epsilon(0.02));
+}
+
+TEST_CASE("Lights edited after a commit are all shaded, not sampled") {
+  // The second light is dark when the sampling table is built, so it has
+  // no chance of being picked
+  auto w = default_world();
+  w.lights({PointLight{Point{-10.0f, 10.0f, -10.0f}, Color{0.5f, 0.5f, 0.5f}},
+            PointLight{Point{10.0f, 10.0f, -10.0f}, Colors::black},
+            PointLight{Point{0.0f, 0.0f, 10.0f}, Color{0.3f, 0.3f, 0.3f}}});
+  w.light_samples(1).commit();
+
+  w.lights()[1].intensity = Color{0.2f, 0.3f, 0.1f};
+  auto r = Ray{Point{0.0f, 0.0f, -5.0f}, Vector3{0.0f, 0.0f, 1.0f}};
+  auto comps = PreComps{Intersection{4, &w[0]}, r};
+  auto sampled = w.shade_hit(comps);
+  w.light_samples(0);
+  CHECK(sampled == w.shade_hit(comps));
+}
+
+TEST_CASE("Light samples must be non-negative") {
+  auto w = World{};
+  CHECK(w.light_samples() == 0);
+  CHECK_THROWS_AS(w.light_samples(-1), std::out_of_range);
+}
+
+TEST_CASE("Area lights cast soft shadows") {
+  // A floor lit from above by a square light, with a sphere hiding the
+  // -x half of the light from the origin
+  auto w = World{};
+  w.lights({});
+  w.push_back(std::make_unique<Plane>(Plane{}));
+  w.push_back(std::make_unique<Sphere>(
+      Sphere{identity_matrix().scaled(3.0f, 3.0f, 3.0f).translated(-3.0f, 5.0f,
+                                                                   0.0f)}));
+  auto light =
+      rectangle_light(Point{-2.0f, 10.0f, -2.0f}, Vector3{4.0f, 0.0f, 0.0f}, 4,
+                      Vector3{0.0f, 0.0f, 4.0f}, 4, Colors::white)
+          .jitter(false);
+
+  auto r = Ray{Point{0.0f, 1.0f, -1.0f},
+               Vector3{0.0f, -1.0f, 1.0f}.normalize()};
+  auto comps = PreComps{Intersection{std::sqrt(2.0f), &w[0]}, r};
+  auto ambient = Color{0.1f, 0.1f, 0.1f};
+
+  w.area_lights({light});
+  auto penumbra = w.shade_hit(comps);
+  CHECK(penumbra.r > 0.4f);
+  CHECK(penumbra.r < 0.6f);
+
+  SUBCASE("Adaptive sampling keeps going when the shadow rays disagree") {
+    w.area_lights({light.adaptive_samples(4)});
+    CHECK(w.shade_hit(comps) == penumbra);
+  }
+
+  SUBCASE("Adaptive sampling stops early in full shadow") {
+    w.push_back(std::make_unique<Sphere>(
+        Sphere{identity_matrix().scaled(3.0f, 3.0f, 3.0f).translated(
+            3.0f, 5.0f, 0.0f)}));
+    w.area_lights({light});
+    CHECK(w.shade_hit(comps) == ambient);
+    w.area_lights({light.adaptive_samples(4)});
+    CHECK(w.shade_hit(comps) == ambient);
+  }
+}
+
+TEST_CASE("A world tracks what changed since a snapshot") {
+  auto w = default_world();
+  CHECK(w.lights_changed(WorldSnapshot{}));
+  CHECK(w.changed_shapes(WorldSnapshot{}).size() == 2);
+
+  auto since = w.snapshot();
+  CHECK(!w.lights_changed(since));
+  CHECK(w.changed_shapes(since).empty());
+
+  auto old_transform = w[1].transform();
+  w[1].transform(old_transform.translated(1.0f, 0.0f, 0.0f));
+  w.push_back(std::make_unique<Sphere>(Sphere{}));
+  auto changes = w.changed_shapes(since);
+  REQUIRE(changes.size() == 2);
+  CHECK(changes[0].shape == &w[1]);
+  CHECK(changes[0].old_transform == old_transform);
+  CHECK(changes[1].shape == &w[2]);
+  CHECK(!changes[1].old_transform.has_value());
+
+  // Each snapshot keeps its own baseline
+  auto later = w.snapshot();
+  CHECK(w.changed_shapes(later).empty());
+  CHECK(w.changed_shapes(since).size() == 2);
+
+  w.light().position = Point{0.0f, 10.0f, 0.0f};
+  CHECK(w.lights_changed(since));
+  CHECK(w.lights_changed(later));
+}
+
+TEST_CASE("A world notices changes too small for operator==") {
+  auto w = default_world();
+  auto since = w.snapshot();
+  auto old_transform = w[0].transform();
+  w[0].transform(old_transform.translated(epsilon / 10, 0.0f, 0.0f));
+  CHECK(w[0].transform() == old_transform);
+  CHECK(w.changed_shapes(since).size() == 1);
+
+  since = w.snapshot();
+  w.light().position.x += epsilon / 10;
+  CHECK(w.lights_changed(since));
+}
+
 TEST_CASE("The color when a ray misses") {
   auto w = default_world();
   auto r = Ray{Point{0.0f, 0.0f, -5.0f}, Vector3{0.0f, 1.0f, 0.0f}};
@@ -0,0 +1,119 @@
+#include "y4m.h"
+
+#include "doctest.h"
+
+#include "canvas.h"
+#include "color.h"
+#include "ppm.h"
+
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+using raytrace::Canvas;
+using raytrace::Color;
+using raytrace::Y4mOptions;
+using raytrace::Y4mWriter;
+
+namespace {
+constexpr auto header = "YUV4MPEG2 W5 H3 F24:1 Ip A1:1 C420jpeg "
+                        "XCOLORRANGE=LIMITED\n";
+
+auto flat(int width, int height, Color color) -> Canvas {
+  auto c = Canvas{width, height};
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      c.write_pixel(x, y, color);
+    }
+  }
+  return c;
+}
+
+auto byte_at(std::string const &s, std::size_t i) -> int {
+  return static_cast<unsigned char>(s[i]);
+}
+
+// BT.601 limited range luma, one pixel at a time
+auto reference_luma(Color c) -> int {
+  auto r = raytrace::ppm_value(c.r);
+  auto g = raytrace::ppm_value(c.g);
+  auto b = raytrace::ppm_value(c.b);
+  return ((66 * r + 129 * g + 25 * b + 128) >> 8) + 16;
+}
+} // namespace
+
+TEST_CASE("A Y4M stream starts with its header") {
+  auto os = std::ostringstream{};
+  auto options = Y4mOptions{};
+  auto writer = Y4mWriter{os, 5, 3, options};
+  CHECK(os.str() == header);
+  CHECK(writer.frames() == 0);
+  CHECK_THROWS_AS(Y4mWriter(os, 0, 3), std::out_of_range);
+}
+
+TEST_CASE("Each frame is a Y plane then quarter size U and V planes") {
+  auto os = std::ostringstream{};
+  auto writer = Y4mWriter{os, 5, 3};
+  writer.write_frame(flat(5, 3, Color{1.0f, 0.0f, 0.0f}));
+  writer.write_frame(flat(5, 3, Color{1.0f, 1.0f, 1.0f}));
+  CHECK(writer.frames() == 2);
+
+  // 5 x 3 has 3 x 2 chroma samples
+  auto frame_size = std::string{"FRAME\n"}.size() + 15 + 2 * 6;
+  auto stream = os.str();
+  auto start = std::string{header}.size();
+  REQUIRE(stream.size() == start + 2 * frame_size);
+  CHECK(stream.substr(start, 6) == "FRAME\n");
+  CHECK(stream.substr(start + frame_size, 6) == "FRAME\n");
+
+  // Pure red, then white
+  auto red = start + 6;
+  CHECK(byte_at(stream, red) == 82);
+  CHECK(byte_at(stream, red + 14) == 82);
+  CHECK(byte_at(stream, red + 15) == 90);
+  CHECK(byte_at(stream, red + 21) == 240);
+  auto white = red + frame_size;
+  CHECK(byte_at(stream, white) == 235);
+  CHECK(byte_at(stream, white + 15) == 128);
+  CHECK(byte_at(stream, white + 21) == 128);
+
+  CHECK_THROWS_AS(writer.write_frame(Canvas{4, 3}), std::invalid_argument);
+}
+
+TEST_CASE("Luma is per pixel and chroma averages 2x2 blocks") {
+  // Wide enough for the vector loop and its tail
+  auto c = Canvas{21, 3};
+  for (int y = 0; y < 3; ++y) {
+    for (int x = 0; x < 21; ++x) {
+      c.write_pixel(x, y, Color{x / 20.0f, y / 2.0f, (x * y % 5) / 4.0f});
+    }
+  }
+  auto os = std::ostringstream{};
+  Y4mWriter{os, 21, 3}.write_frame(c);
+  auto stream = os.str();
+  auto y_plane = std::string{"YUV4MPEG2 W21 H3 F24:1 Ip A1:1 C420jpeg "
+                             "XCOLORRANGE=LIMITED\nFRAME\n"}
+                     .size();
+  for (int y = 0; y < 3; ++y) {
+    for (int x = 0; x < 21; ++x) {
+      CHECK(byte_at(stream, y_plane + static_cast<std::size_t>(y * 21 + x)) ==
+            reference_luma(c.pixel_at(x, y)));
+    }
+  }
+
+  // Black on the left of each 2x2 block and white on the right average
+  // to mid grey, which has no colour
+  auto stripes = Canvas{4, 2};
+  for (int y = 0; y < 2; ++y) {
+    stripes.write_pixel(1, y, Color{1.0f, 1.0f, 1.0f});
+    stripes.write_pixel(3, y, Color{1.0f, 1.0f, 1.0f});
+  }
+  os.str("");
+  Y4mWriter{os, 4, 2}.write_frame(stripes);
+  stream = os.str();
+  auto u_plane = stream.size() - 4;
+  CHECK(byte_at(stream, u_plane) == 128);
+  CHECK(byte_at(stream, u_plane + 3) == 128);
+  CHECK(byte_at(stream, u_plane - 8) == 16);
+  CHECK(byte_at(stream, u_plane - 7) == 235);
+}